@@ -21,29 +21,73 @@ INCLUDEPATH += include \
 
 LIBPATH += /opt/local/lib
 
-HEADERS += src/Common.h \
+HEADERS += src/BrickQuantizer.h \
+           src/CameraController.h \
+           src/CameraPath.h \
+           src/Common.h \
+           src/FrameTimer.h \
            src/ImageLoader.h \
+           src/ImageSaver.h \
            src/KeyboardHelper.h \
            src/Log.h \
+           src/MacrocellGenerator.h \
            src/MainWindow.h \
            src/MathHelper.h \
            src/MetadataLoader.h \
+           src/MipmapGenerator.h \
+           src/OffscreenRenderer.h \
+           src/ParallelHelper.h \
+           src/PathBenchmark.h \
+           src/ProgramBinaryCache.h \
+           src/ProjectionGenerator.h \
+           src/RenderThread.h \
            src/RenderWidget.h \
+           src/ResliceExporter.h \
+           src/ShaderVariantCache.h \
+           src/SliceStreamer.h \
+           src/SliceViews.h \
+           src/SnapshotRenderer.h \
+           src/SoftwareRenderWidget.h \
            src/stdafx.h \
            src/StringUtils.h \
-           src/SysUtils.h
+           src/SysUtils.h \
+           src/TextureCompressor.h \
+           src/VolumeReslicer.h \
+           src/VolumeResource.h
 
 FORMS += src/MainWindow.ui
 
-SOURCES += src/ImageLoader.cpp \
+SOURCES += src/BrickQuantizer.cpp \
+           src/CameraController.cpp \
+           src/CameraPath.cpp \
+           src/FrameTimer.cpp \
+           src/ImageLoader.cpp \
+           src/ImageSaver.cpp \
            src/KeyboardHelper.cpp \
            src/Log.cpp \
+           src/MacrocellGenerator.cpp \
            src/Main.cpp \
            src/MainWindow.cpp \
            src/MathHelper.cpp \
            src/MetadataLoader.cpp \
+           src/MipmapGenerator.cpp \
+           src/OffscreenRenderer.cpp \
+           src/ParallelHelper.cpp \
+           src/PathBenchmark.cpp \
+           src/ProgramBinaryCache.cpp \
+           src/ProjectionGenerator.cpp \
+           src/RenderThread.cpp \
            src/RenderWidget.cpp \
+           src/ResliceExporter.cpp \
+           src/ShaderVariantCache.cpp \
+           src/SliceStreamer.cpp \
+           src/SliceViews.cpp \
+           src/SnapshotRenderer.cpp \
+           src/SoftwareRenderWidget.cpp \
            src/StringUtils.cpp \
-           src/SysUtils.cpp
+           src/SysUtils.cpp \
+           src/TextureCompressor.cpp \
+           src/VolumeReslicer.cpp \
+           src/VolumeResource.cpp
 
 RESOURCES += src/MainWindow.qrc
@@ -4,12 +4,14 @@
 // License: MIT, see the LICENSE file.
 
 in vec2 position;
-in vec3 color;
 
 out vec3 colorVarying;
 
+uniform vec3 bottomColor;
+uniform vec3 topColor;
+
 void main()
 {
 	gl_Position = vec4(position, 0.0f, 1.0f);
-	colorVarying = color;
+	colorVarying = mix(bottomColor, topColor, position.y * 0.5f + 0.5f);
 }
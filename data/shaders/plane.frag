@@ -4,29 +4,85 @@
 // License: MIT, see the LICENSE file.
 
 in vec3 worldPositionVarying;
+flat in vec3 slabNormalVarying;
+flat in int slabSampleCountVarying;
 
 out vec4 color;
 
-uniform sampler3D tex0;
-uniform float scaleY;
-uniform float scaleZ;
+// SLAB_MODE is 0 for the plane only, 1 for a maximum and 2 for a mean slab, SKIP_EMPTY_SPACE is 0 or 1
+
+uniform vec3 displayThreshold;
+uniform float slabThickness;
+uniform vec3 cropMinimum;
+uniform vec3 cropMaximum;
+
+vec3 worldToTexcoord(vec3 worldPosition);
+bool isOutsideVolume(vec3 texcoord);
+vec3 sampleVolume(vec3 texcoord, vec3 dx, vec3 dy);
+vec3 getMacrocellMaximum(vec3 texcoord);
+
+// channels that stay below the threshold in the whole cell are known to be black without touching the volume
+vec3 samplePlane(vec3 texcoord, vec3 dx, vec3 dy)
+{
+#if SKIP_EMPTY_SPACE
+	vec3 visible = vec3(greaterThan(getMacrocellMaximum(texcoord), displayThreshold));
+
+	if (!any(greaterThan(visible, vec3(0.0f))))
+		return vec3(0.0f);
+
+	return sampleVolume(texcoord, dx, dy) * visible;
+#else
+	return sampleVolume(texcoord, dx, dy);
+#endif
+}
 
 void main()
 {
-	vec3 texcoord = worldPositionVarying;
-	
-	texcoord.y /= scaleY;
-	texcoord.z /= scaleZ;
-	
-	texcoord.z = 1.0f - texcoord.z;
-	
-	if (texcoord.x < 0.0f || texcoord.x > 1.0f ||
-	texcoord.y < 0.0f || texcoord.y > 1.0f ||
-	texcoord.z < 0.0f || texcoord.z > 1.0f)
+	vec3 texcoord = worldToTexcoord(worldPositionVarying);
+	vec3 dx = dFdx(texcoord);
+	vec3 dy = dFdy(texcoord);
+	vec3 value = vec3(0.0f);
+
+#if SLAB_MODE == 0
+	if (!isOutsideVolume(texcoord))
+		value = samplePlane(texcoord, dx, dy);
+#else
+	// samples are spread evenly along the plane normal, the ones that fall outside the crop box are not taken or counted
+	vec3 maximum = vec3(0.0f);
+	vec3 sum = vec3(0.0f);
+	int count = 0;
+
+	// the normal and the sample count come with each plane instance
+	for (int i = 0; i < slabSampleCountVarying; ++i)
 	{
-		discard;
+		float offset = (float(i) / float(slabSampleCountVarying - 1) - 0.5f) * slabThickness;
+		vec3 samplePosition = worldPositionVarying + slabNormalVarying * offset;
+
+		if (any(lessThan(samplePosition, cropMinimum)) || any(greaterThan(samplePosition, cropMaximum)))
+			continue;
+
+		vec3 sampleTexcoord = worldToTexcoord(samplePosition);
+
+		if (isOutsideVolume(sampleTexcoord))
+			continue;
+
+		vec3 sampleValue = samplePlane(sampleTexcoord, dx, dy);
+
+#if SLAB_MODE == 1
+		maximum = max(maximum, sampleValue);
+#else
+		sum += sampleValue;
+		++count;
+#endif
 	}
-	
-	color = texture(tex0, texcoord);
-	color.a = 1.0f;
+
+#if SLAB_MODE == 1
+	value = maximum;
+#else
+	value = sum / float(max(count, 1));
+#endif
+#endif
+
+	value *= vec3(greaterThan(value, displayThreshold));
+	color = vec4(value, 1.0f);
 }
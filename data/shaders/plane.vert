@@ -3,15 +3,31 @@
 // Copyright (C) 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
 // License: MIT, see the LICENSE file.
 
-in vec3 position;
+// one instance per plane, every attribute advances per instance and the fan vertex is picked with gl_VertexID
+// the polygon where the plane cuts the box has three to six vertices, shorter ones repeat their last vertex
+
+layout(location = 0) in vec3 polygon0;
+layout(location = 1) in vec3 polygon1;
+layout(location = 2) in vec3 polygon2;
+layout(location = 3) in vec3 polygon3;
+layout(location = 4) in vec3 polygon4;
+layout(location = 5) in vec3 polygon5;
+layout(location = 6) in vec4 slab;
 
 out vec3 worldPositionVarying;
+flat out vec3 slabNormalVarying;
+flat out int slabSampleCountVarying;
 
 uniform mat4 modelMatrix;
 uniform mat4 mvp;
 
 void main()
 {
+	vec3 polygon[6] = vec3[6](polygon0, polygon1, polygon2, polygon3, polygon4, polygon5);
+	vec3 position = polygon[gl_VertexID];
+
 	worldPositionVarying = (modelMatrix * vec4(position, 1.0f)).xyz;
+	slabNormalVarying = slab.xyz;
+	slabSampleCountVarying = int(slab.w);
 	gl_Position = mvp * vec4(position, 1.0f);
 }
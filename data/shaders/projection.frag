@@ -0,0 +1,103 @@
+#version 330
+
+// Copyright (C) 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+in vec3 worldPositionVarying;
+
+out vec4 color;
+
+uniform vec3 cameraPosition;
+uniform vec3 boxMinimum;
+uniform vec3 boxMaximum;
+uniform float stepSize;
+uniform float stepJitter;
+uniform float sampleWeight;
+uniform float projectionScale;
+uniform vec3 channelMask;
+
+// PROJECTION_TYPE is 0 maximum, 1 minimum, 2 mean or 3 sum and SKIP_EMPTY_SPACE is 0 or 1, defined by ShaderVariantCache
+
+vec3 worldToTexcoord(vec3 worldPosition);
+bool isOutsideVolume(vec3 texcoord);
+vec3 sampleVolume(vec3 texcoord, vec3 dx, vec3 dy);
+vec3 getMacrocellMaximum(vec3 texcoord);
+vec3 getMacrocellMinimum(vec3 texcoord);
+float getMacrocellExit(vec3 texcoord, vec3 direction);
+
+// view aligned projections, the ray setup is the same as in volume.frag
+void main()
+{
+	vec3 rayDirection = normalize(worldPositionVarying - cameraPosition);
+	vec3 inverseDirection = 1.0f / rayDirection;
+
+	vec3 t0 = (boxMinimum - cameraPosition) * inverseDirection;
+	vec3 t1 = (boxMaximum - cameraPosition) * inverseDirection;
+	vec3 tMin = min(t0, t1);
+	vec3 tMax = max(t0, t1);
+
+	float tNear = max(max(tMin.x, tMin.y), max(tMin.z, 0.0f));
+	float tFar = min(min(tMax.x, tMax.y), tMax.z);
+
+	if (tNear >= tFar)
+		discard;
+
+	float jitter = fract(sin(dot(gl_FragCoord.xy, vec2(12.9898f, 78.233f))) * 43758.5453f + stepJitter);
+
+	vec3 texcoordOrigin = worldToTexcoord(cameraPosition);
+	vec3 texcoordDirection = worldToTexcoord(cameraPosition + rayDirection) - texcoordOrigin;
+
+#if PROJECTION_TYPE == 1
+	vec3 result = vec3(1.0f);
+#else
+	vec3 result = vec3(0.0f);
+#endif
+	float sampleCount = 0.0f;
+
+	for (float t = tNear + jitter * stepSize; t < tFar; t += stepSize)
+	{
+		vec3 texcoord = texcoordOrigin + t * texcoordDirection;
+
+		if (isOutsideVolume(texcoord))
+			continue;
+
+#if SKIP_EMPTY_SPACE
+		// cells that can't change the result are jumped over, they still count as samples for the mean
+#if PROJECTION_TYPE == 0
+		bool skipCell = all(lessThanEqual(getMacrocellMaximum(texcoord) * channelMask, result));
+#elif PROJECTION_TYPE == 1
+		bool skipCell = all(greaterThanEqual(getMacrocellMinimum(texcoord) + (1.0f - channelMask), result));
+#else
+		bool skipCell = all(equal(getMacrocellMaximum(texcoord) * channelMask, vec3(0.0f)));
+#endif
+
+		if (skipCell)
+		{
+			float skippedSteps = max(ceil(getMacrocellExit(texcoord, texcoordDirection) / stepSize), 1.0f);
+			sampleCount += skippedSteps;
+			t += (skippedSteps - 1.0f) * stepSize;
+			continue;
+		}
+#endif
+
+		vec3 value = sampleVolume(texcoord, vec3(0.0f), vec3(0.0f));
+
+#if PROJECTION_TYPE == 0
+		result = max(result, value);
+#elif PROJECTION_TYPE == 1
+		result = min(result, value);
+#else
+		result += value;
+#endif
+
+		sampleCount += 1.0f;
+	}
+
+#if PROJECTION_TYPE == 2
+	result /= max(sampleCount, 1.0f);
+#elif PROJECTION_TYPE == 3
+	result *= sampleWeight;
+#endif
+
+	color = vec4(result * channelMask * projectionScale, 1.0f);
+}
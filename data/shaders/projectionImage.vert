@@ -0,0 +1,17 @@
+#version 330
+
+// Copyright (C) 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+in vec3 position;
+in vec2 texcoord;
+
+out vec2 texcoordVarying;
+
+uniform mat4 mvp;
+
+void main()
+{
+	texcoordVarying = texcoord;
+	gl_Position = mvp * vec4(position, 1.0f);
+}
@@ -0,0 +1,149 @@
+#version 330
+
+// Copyright (C) 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+// volume sampling shared by all the programs that read the volume, linked in as a separate fragment shader object
+// TEXTURE_FORMAT and the RED_CHANNEL, GREEN_CHANNEL and BLUE_CHANNEL of compressed volumes are defined by ShaderVariantCache
+
+uniform sampler3D tex0;
+uniform sampler2DArray tex1;
+uniform sampler2DArray tex2;
+uniform sampler2DArray tex3;
+uniform sampler3D tex4;
+uniform sampler3D tex5;
+uniform sampler3D tex6;
+uniform sampler3D tex7;
+uniform int brickSize;
+uniform float layerCount;
+uniform int macrocellSize;
+uniform vec3 volumeSize;
+uniform vec3 channelMask;
+uniform vec3 volumeOrigin;
+uniform vec3 volumeExtent;
+uniform float deskewOffset;
+uniform float deskewShear;
+
+// a cropped volume only covers part of the world box
+// stage-scanned stacks are sheared along x, the slices are moved back by an offset that changes linearly with the depth
+vec3 worldToTexcoord(vec3 worldPosition)
+{
+	worldPosition.x -= deskewOffset + deskewShear * worldPosition.z;
+
+	vec3 texcoord = (worldPosition - volumeOrigin) / volumeExtent;
+
+	texcoord.z = 1.0f - texcoord.z;
+
+	return texcoord;
+}
+
+// a deskewed volume leaves the corners of its bounding box empty, sampling there would smear the texture edges into them
+bool isOutsideVolume(vec3 texcoord)
+{
+	return deskewShear != 0.0f && (texcoord.x < 0.0f || texcoord.x > 1.0f);
+}
+
+// compressed channels are stored as texture array layers, so the filtering between slices is done here
+float sampleLayers(sampler2DArray tex, vec3 texcoord, vec2 dx, vec2 dy)
+{
+	float layer = clamp(texcoord.z * layerCount - 0.5f, 0.0f, layerCount - 1.0f);
+	float layer0 = floor(layer);
+	float layer1 = min(layer0 + 1.0f, layerCount - 1.0f);
+
+	float value0 = textureGrad(tex, vec3(texcoord.xy, layer0), dx, dy).r;
+	float value1 = textureGrad(tex, vec3(texcoord.xy, layer1), dx, dy).r;
+
+	return mix(value0, value1, layer - layer0);
+}
+
+vec3 fetchQuantized(ivec3 voxel)
+{
+	ivec3 brick = voxel / brickSize;
+
+	vec3 minimum = texelFetch(tex4, brick, 0).rgb;
+	vec3 scale = texelFetch(tex5, brick, 0).rgb;
+
+	return minimum + texelFetch(tex0, voxel, 0).rgb * 255.0f * scale;
+}
+
+// every voxel has to be dequantized with its own brick parameters before filtering
+vec3 sampleQuantized(vec3 texcoord)
+{
+	ivec3 size = textureSize(tex0, 0);
+	vec3 position = texcoord * vec3(size) - 0.5f;
+	vec3 base = floor(position);
+	vec3 t = position - base;
+
+	ivec3 voxel0 = clamp(ivec3(base), ivec3(0), size - 1);
+	ivec3 voxel1 = clamp(ivec3(base) + 1, ivec3(0), size - 1);
+
+	vec3 c000 = fetchQuantized(ivec3(voxel0.x, voxel0.y, voxel0.z));
+	vec3 c100 = fetchQuantized(ivec3(voxel1.x, voxel0.y, voxel0.z));
+	vec3 c010 = fetchQuantized(ivec3(voxel0.x, voxel1.y, voxel0.z));
+	vec3 c110 = fetchQuantized(ivec3(voxel1.x, voxel1.y, voxel0.z));
+	vec3 c001 = fetchQuantized(ivec3(voxel0.x, voxel0.y, voxel1.z));
+	vec3 c101 = fetchQuantized(ivec3(voxel1.x, voxel0.y, voxel1.z));
+	vec3 c011 = fetchQuantized(ivec3(voxel0.x, voxel1.y, voxel1.z));
+	vec3 c111 = fetchQuantized(ivec3(voxel1.x, voxel1.y, voxel1.z));
+
+	vec3 c00 = mix(c000, c100, t.x);
+	vec3 c10 = mix(c010, c110, t.x);
+	vec3 c01 = mix(c001, c101, t.x);
+	vec3 c11 = mix(c011, c111, t.x);
+
+	return mix(mix(c00, c10, t.y), mix(c01, c11, t.y), t.z);
+}
+
+// explicit gradients select the mip level, so this also works inside loops and other non-uniform control flow
+vec3 sampleVolume(vec3 texcoord, vec3 dx, vec3 dy)
+{
+#if TEXTURE_FORMAT == 1
+	// disabled channels are not sampled at all
+	vec3 value = vec3(0.0f);
+#if RED_CHANNEL
+	value.r = sampleLayers(tex1, texcoord, dx.xy, dy.xy);
+#endif
+#if GREEN_CHANNEL
+	value.g = sampleLayers(tex2, texcoord, dx.xy, dy.xy);
+#endif
+#if BLUE_CHANNEL
+	value.b = sampleLayers(tex3, texcoord, dx.xy, dy.xy);
+#endif
+	return value;
+#elif TEXTURE_FORMAT == 2
+	return sampleQuantized(texcoord);
+#else
+	return textureGrad(tex0, texcoord, dx, dy).rgb;
+#endif
+}
+
+ivec3 getMacrocell(vec3 texcoord)
+{
+	ivec3 voxel = min(ivec3(clamp(texcoord, 0.0f, 1.0f) * volumeSize), ivec3(volumeSize) - 1);
+
+	return voxel / macrocellSize;
+}
+
+// value ranges include the neighbouring voxels, so nothing filtered inside the cell can be outside them
+vec3 getMacrocellMaximum(vec3 texcoord)
+{
+	return texelFetch(tex6, getMacrocell(texcoord), 0).rgb;
+}
+
+vec3 getMacrocellMinimum(vec3 texcoord)
+{
+	return texelFetch(tex7, getMacrocell(texcoord), 0).rgb;
+}
+
+// distance along the direction to where the ray leaves the cell containing the texcoord, in units of the direction length
+float getMacrocellExit(vec3 texcoord, vec3 direction)
+{
+	direction += vec3(equal(direction, vec3(0.0f))) * 1.0e-8f;
+
+	vec3 cellSize = float(macrocellSize) / volumeSize;
+	vec3 cellStart = vec3(getMacrocell(texcoord)) * cellSize;
+	vec3 exitPlanes = cellStart + step(0.0f, direction) * cellSize;
+	vec3 t = (exitPlanes - texcoord) / direction;
+
+	return max(min(min(t.x, t.y), t.z), 0.0f);
+}
@@ -0,0 +1,20 @@
+#version 330
+
+// Copyright (C) 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+in vec2 texcoordVarying;
+
+out vec4 color;
+
+uniform sampler2D tex0;
+uniform vec3 displayThreshold;
+
+// one z slice of a streamed image, the disabled channels are already zero in the texture
+void main()
+{
+	vec3 value = texture(tex0, texcoordVarying).rgb;
+	value *= vec3(greaterThan(value, displayThreshold));
+
+	color = vec4(value, 1.0f);
+}
@@ -0,0 +1,16 @@
+#version 330
+
+// Copyright (C) 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+in vec2 texcoordVarying;
+
+out vec4 color;
+
+uniform sampler2D tex0;
+uniform float sampleWeight;
+
+void main()
+{
+	color = vec4(texture(tex0, texcoordVarying).rgb * sampleWeight, 1.0f);
+}
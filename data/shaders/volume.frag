@@ -0,0 +1,90 @@
+#version 330
+
+// Copyright (C) 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+in vec3 worldPositionVarying;
+
+out vec4 color;
+
+uniform vec3 cameraPosition;
+uniform vec3 boxMinimum;
+uniform vec3 boxMaximum;
+uniform float stepSize;
+uniform float stepJitter;
+uniform float opacityCorrection;
+uniform vec3 transferLow;
+uniform vec3 transferHigh;
+uniform vec3 transferOpacity;
+uniform vec3 channelMask;
+
+// SKIP_EMPTY_SPACE is 0 or 1, defined by ShaderVariantCache
+
+vec3 worldToTexcoord(vec3 worldPosition);
+bool isOutsideVolume(vec3 texcoord);
+vec3 sampleVolume(vec3 texcoord, vec3 dx, vec3 dy);
+vec3 getMacrocellMaximum(vec3 texcoord);
+float getMacrocellExit(vec3 texcoord, vec3 direction);
+
+// only the back faces of the box are drawn, so the ray is clipped against the box here and the camera can also be inside it
+// the box is the crop box, which is the whole volume until it is moved
+void main()
+{
+	vec3 rayDirection = normalize(worldPositionVarying - cameraPosition);
+	vec3 inverseDirection = 1.0f / rayDirection;
+
+	vec3 t0 = (boxMinimum - cameraPosition) * inverseDirection;
+	vec3 t1 = (boxMaximum - cameraPosition) * inverseDirection;
+	vec3 tMin = min(t0, t1);
+	vec3 tMax = max(t0, t1);
+
+	float tNear = max(max(tMin.x, tMin.y), max(tMin.z, 0.0f));
+	float tFar = min(min(tMax.x, tMax.y), tMax.z);
+
+	if (tNear >= tFar)
+		discard;
+
+	// per pixel start offset turns the wood grain artifacts of a fixed step into noise, the per frame offset lets accumulation average it out
+	float jitter = fract(sin(dot(gl_FragCoord.xy, vec2(12.9898f, 78.233f))) * 43758.5453f + stepJitter);
+	vec4 accumulated = vec4(0.0f);
+
+	// the texcoord transform is affine, so the ray can be stepped directly in texture space
+	vec3 texcoordOrigin = worldToTexcoord(cameraPosition);
+	vec3 texcoordDirection = worldToTexcoord(cameraPosition + rayDirection) - texcoordOrigin;
+
+	for (float t = tNear + jitter * stepSize; t < tFar; t += stepSize)
+	{
+		vec3 texcoord = texcoordOrigin + t * texcoordDirection;
+
+		if (isOutsideVolume(texcoord))
+			continue;
+
+#if SKIP_EMPTY_SPACE
+		// nothing in a cell below the transfer function ramp contributes, so jump to the first step after its exit
+		if (all(lessThanEqual(getMacrocellMaximum(texcoord) * channelMask, transferLow)))
+		{
+			float exitDistance = getMacrocellExit(texcoord, texcoordDirection);
+			t += (max(ceil(exitDistance / stepSize), 1.0f) - 1.0f) * stepSize;
+			continue;
+		}
+#endif
+
+		vec3 value = sampleVolume(texcoord, vec3(0.0f), vec3(0.0f));
+		vec3 alpha = smoothstep(transferLow, transferHigh, value) * transferOpacity * channelMask;
+
+		// transfer function opacities are defined per voxel, correct them for the actual step length
+		alpha = 1.0f - pow(1.0f - min(alpha, 0.999f), vec3(opacityCorrection));
+
+		// every channel emits its own color and absorbs independently
+		vec3 transparency = 1.0f - alpha;
+		float sampleAlpha = 1.0f - transparency.r * transparency.g * transparency.b;
+
+		accumulated.rgb += (1.0f - accumulated.a) * alpha * value;
+		accumulated.a += (1.0f - accumulated.a) * sampleAlpha;
+
+		if (accumulated.a > 0.99f)
+			break;
+	}
+
+	color = vec4(accumulated.rgb / max(accumulated.a, 0.0001f), accumulated.a);
+}
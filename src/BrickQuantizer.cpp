@@ -0,0 +1,163 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#include "stdafx.h"
+
+#include "BrickQuantizer.h"
+#include "ParallelHelper.h"
+#include "MainWindow.h"
+#include "Log.h"
+
+using namespace CellVision;
+
+QuantizedVolume BrickQuantizer::quantizeVolume(const ImageLoaderResult16& source, uint32_t brickSize)
+{
+	Log& log = MainWindow::getLog();
+
+	QuantizedVolume result;
+	result.brickSize = brickSize;
+	result.bricksX = (source.width + brickSize - 1) / brickSize;
+	result.bricksY = (source.height + brickSize - 1) / brickSize;
+	result.bricksZ = (source.depth + brickSize - 1) / brickSize;
+	result.volume.width = source.width;
+	result.volume.height = source.height;
+	result.volume.depth = source.depth;
+	result.volume.data.resize(uint64_t(source.width) * source.height * source.depth);
+
+	uint64_t brickCount = uint64_t(result.bricksX) * result.bricksY * result.bricksZ;
+	result.brickMinimums.resize(brickCount * 3);
+	result.brickScales.resize(brickCount * 3);
+
+	log.logInfo("Quantizing %dx%dx%d volume to 8-bit with %d bricks of %d^3 voxels", source.width, source.height, source.depth, brickCount, brickSize);
+
+	uint64_t sliceSize = uint64_t(source.width) * source.height;
+
+	ParallelHelper::parallelFor(brickCount, [&](uint64_t brickIndex)
+	{
+		uint32_t startX = uint32_t(brickIndex % result.bricksX) * brickSize;
+		uint32_t startY = uint32_t((brickIndex / result.bricksX) % result.bricksY) * brickSize;
+		uint32_t startZ = uint32_t(brickIndex / (uint64_t(result.bricksX) * result.bricksY)) * brickSize;
+		uint32_t endX = std::min(startX + brickSize, source.width);
+		uint32_t endY = std::min(startY + brickSize, source.height);
+		uint32_t endZ = std::min(startZ + brickSize, source.depth);
+
+		uint32_t quantized[3] = { 0, 0, 0 };
+		float inverseScales[3] = { 0.0f, 0.0f, 0.0f };
+		uint16_t minimums[3] = { 0, 0, 0 };
+
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			const std::vector<uint16_t>& channel = source.channelData[c];
+
+			if (channel.empty())
+				continue;
+
+			uint16_t minimum = std::numeric_limits<uint16_t>::max();
+			uint16_t maximum = 0;
+
+			for (uint32_t z = startZ; z < endZ; ++z)
+			{
+				for (uint32_t y = startY; y < endY; ++y)
+				{
+					const uint16_t* row = &channel[z * sliceSize + uint64_t(y) * source.width];
+
+					for (uint32_t x = startX; x < endX; ++x)
+					{
+						minimum = std::min(minimum, row[x]);
+						maximum = std::max(maximum, row[x]);
+					}
+				}
+			}
+
+			float scale = float(maximum - minimum) / 255.0f;
+
+			minimums[c] = minimum;
+			inverseScales[c] = (scale > 0.0f) ? 1.0f / scale : 0.0f;
+
+			result.brickMinimums[brickIndex * 3 + c] = float(minimum) / 65535.0f;
+			result.brickScales[brickIndex * 3 + c] = scale / 65535.0f;
+		}
+
+		for (uint32_t z = startZ; z < endZ; ++z)
+		{
+			for (uint32_t y = startY; y < endY; ++y)
+			{
+				uint64_t rowStart = z * sliceSize + uint64_t(y) * source.width;
+
+				for (uint32_t x = startX; x < endX; ++x)
+				{
+					for (uint32_t c = 0; c < 3; ++c)
+					{
+						if (!source.channelData[c].empty())
+							quantized[c] = uint32_t(float(source.channelData[c][rowStart + x] - minimums[c]) * inverseScales[c] + 0.5f);
+					}
+
+					result.volume.data[rowStart + x] = 0xff000000 | quantized[0] | (quantized[1] << 8) | (quantized[2] << 16);
+				}
+			}
+		}
+	});
+
+	result.peakSignalToNoiseRatios = calculatePeakSignalToNoiseRatios(source, result);
+
+	const char* channelNames[] = { "red", "green", "blue" };
+
+	for (uint32_t c = 0; c < 3; ++c)
+	{
+		if (!source.channelData[c].empty())
+			log.logInfo("Quantized %s channel: PSNR %.2f dB", channelNames[c], result.peakSignalToNoiseRatios[c]);
+	}
+
+	return result;
+}
+
+std::array<double, 3> BrickQuantizer::calculatePeakSignalToNoiseRatios(const ImageLoaderResult16& source, const QuantizedVolume& quantized)
+{
+	uint64_t sliceSize = uint64_t(source.width) * source.height;
+	std::vector<double> sliceErrors(uint64_t(source.depth) * 3, 0.0);
+
+	ParallelHelper::parallelFor(source.depth, [&](uint64_t z)
+	{
+		uint64_t brickZ = z / quantized.brickSize;
+
+		for (uint32_t y = 0; y < source.height; ++y)
+		{
+			uint64_t brickY = y / quantized.brickSize;
+			uint64_t rowStart = z * sliceSize + uint64_t(y) * source.width;
+
+			for (uint32_t x = 0; x < source.width; ++x)
+			{
+				uint64_t brickIndex = (brickZ * quantized.bricksY + brickY) * quantized.bricksX + x / quantized.brickSize;
+				uint32_t value = quantized.volume.data[rowStart + x];
+
+				for (uint32_t c = 0; c < 3; ++c)
+				{
+					if (source.channelData[c].empty())
+						continue;
+
+					// same reconstruction as fetchQuantized in sampling.frag, in 16-bit units
+					double dequantized = (quantized.brickMinimums[brickIndex * 3 + c] + double((value >> (c * 8)) & 0xff) * quantized.brickScales[brickIndex * 3 + c]) * 65535.0;
+					double error = dequantized - double(source.channelData[c][rowStart + x]);
+
+					sliceErrors[z * 3 + c] += error * error;
+				}
+			}
+		}
+	});
+
+	std::array<double, 3> result = {};
+	uint64_t voxelCount = sliceSize * source.depth;
+
+	for (uint32_t c = 0; c < 3; ++c)
+	{
+		double squaredErrorSum = 0.0;
+
+		for (uint32_t z = 0; z < source.depth; ++z)
+			squaredErrorSum += sliceErrors[z * 3 + c];
+
+		double meanSquaredError = (voxelCount > 0) ? squaredErrorSum / double(voxelCount) : 0.0;
+		result[c] = (meanSquaredError > 0.0) ? 10.0 * std::log10(65535.0 * 65535.0 / meanSquaredError) : std::numeric_limits<double>::infinity();
+	}
+
+	return result;
+}
@@ -0,0 +1,37 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "ImageLoader.h"
+
+namespace CellVision
+{
+	struct QuantizedVolume
+	{
+		ImageLoaderResult volume;
+		uint32_t brickSize = 0;
+		uint32_t bricksX = 0;
+		uint32_t bricksY = 0;
+		uint32_t bricksZ = 0;
+		std::vector<float> brickMinimums;
+		std::vector<float> brickScales;
+		std::array<double, 3> peakSignalToNoiseRatios = {};
+	};
+
+	class BrickQuantizer
+	{
+	public:
+
+		// every brick of every channel is stored as 8-bit values with its own offset and scale
+		// offsets and scales are normalized to [0, 1] of the 16-bit range and stored as RGB triplets per brick
+		static QuantizedVolume quantizeVolume(const ImageLoaderResult16& source, uint32_t brickSize);
+
+		// compares the dequantized volume against the source, 65535 is the peak value
+		static std::array<double, 3> calculatePeakSignalToNoiseRatios(const ImageLoaderResult16& source, const QuantizedVolume& quantized);
+	};
+}
@@ -0,0 +1,199 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#include "stdafx.h"
+
+#include "CameraController.h"
+#include "MathHelper.h"
+
+using namespace CellVision;
+
+void CameraController::resetPosition(const QVector3D& boxMaximum)
+{
+	float distance = 2.3f;
+
+	position = QVector3D(0.5f * boxMaximum.x(), 0.5f, distance);
+	orientationMatrix.setToIdentity();
+	orientationInvMatrix.setToIdentity();
+	planeDistance = distance - boxMaximum.z() / 2.0f;
+}
+
+void CameraController::resetSpeeds()
+{
+	moveSpeedModifier = 0.8f;
+	mouseMoveSpeedModifier = 0.001f;
+	mouseRotateSpeedModifier = 0.2f;
+	mouseWheelStepSizeModifier = 0.05f;
+}
+
+void CameraController::loadSpeeds()
+{
+	QSettings settings("cellvision.ini", QSettings::IniFormat);
+
+	moveSpeedModifier = settings.value("moveSpeedModifier", 0.8f).toFloat();
+	mouseMoveSpeedModifier = settings.value("mouseMoveSpeedModifier", 0.001f).toFloat();
+	mouseRotateSpeedModifier = settings.value("mouseRotateSpeedModifier", 0.2f).toFloat();
+	mouseWheelStepSizeModifier = settings.value("mouseWheelStepSizeModifier", 0.05f).toFloat();
+}
+
+void CameraController::saveSpeeds() const
+{
+	QSettings settings("cellvision.ini", QSettings::IniFormat);
+
+	settings.setValue("moveSpeedModifier", double(moveSpeedModifier));
+	settings.setValue("mouseMoveSpeedModifier", double(mouseMoveSpeedModifier));
+	settings.setValue("mouseRotateSpeedModifier", double(mouseRotateSpeedModifier));
+	settings.setValue("mouseWheelStepSizeModifier", double(mouseWheelStepSizeModifier));
+}
+
+void CameraController::updateKeys(KeyboardHelper& keyboardHelper, float timeStep)
+{
+	if (keyboardHelper.keyIsDownOnce(Qt::Key_Y))
+		moveSpeedModifier *= 2.0f;
+
+	if (keyboardHelper.keyIsDownOnce(Qt::Key_H))
+		moveSpeedModifier *= 0.5f;
+
+	if (keyboardHelper.keyIsDownOnce(Qt::Key_U))
+		mouseMoveSpeedModifier *= 2.0f;
+
+	if (keyboardHelper.keyIsDownOnce(Qt::Key_J))
+		mouseMoveSpeedModifier *= 0.5f;
+
+	if (keyboardHelper.keyIsDownOnce(Qt::Key_I))
+		mouseRotateSpeedModifier *= 2.0f;
+
+	if (keyboardHelper.keyIsDownOnce(Qt::Key_K))
+		mouseRotateSpeedModifier *= 0.5f;
+
+	if (keyboardHelper.keyIsDownOnce(Qt::Key_O))
+		mouseWheelStepSizeModifier *= 2.0f;
+
+	if (keyboardHelper.keyIsDownOnce(Qt::Key_L))
+		mouseWheelStepSizeModifier *= 0.5f;
+
+	float moveSpeed = getMoveSpeed(keyboardHelper);
+
+	if (keyboardHelper.keyIsDown(Qt::Key_W) || keyboardHelper.keyIsDown(Qt::Key_Up))
+		position += forward * moveSpeed * timeStep;
+
+	if (keyboardHelper.keyIsDown(Qt::Key_S) || keyboardHelper.keyIsDown(Qt::Key_Down))
+		position -= forward * moveSpeed * timeStep;
+
+	if (keyboardHelper.keyIsDown(Qt::Key_D) || keyboardHelper.keyIsDown(Qt::Key_Right))
+		position += right * moveSpeed * timeStep;
+
+	if (keyboardHelper.keyIsDown(Qt::Key_A) || keyboardHelper.keyIsDown(Qt::Key_Left))
+		position -= right * moveSpeed * timeStep;
+
+	if (keyboardHelper.keyIsDown(Qt::Key_E))
+		position += up * moveSpeed * timeStep;
+
+	if (keyboardHelper.keyIsDown(Qt::Key_Q))
+		position -= up * moveSpeed * timeStep;
+}
+
+void CameraController::updateMatrices()
+{
+	cameraMatrix = orientationMatrix;
+	cameraMatrix.setColumn(3, QVector4D(position.x(), position.y(), position.z(), 1.0f));
+	viewMatrix = cameraMatrix.inverted();
+
+	right = orientationMatrix.column(0).toVector3D();
+	up = orientationMatrix.column(1).toVector3D();
+	forward = -orientationMatrix.column(2).toVector3D();
+}
+
+float CameraController::getSpeedModifier(KeyboardHelper& keyboardHelper)
+{
+	float speedModifier = 1.0f;
+
+	if (keyboardHelper.keyIsDown(Qt::Key_Shift))
+		speedModifier *= 2.0f;
+
+	if (keyboardHelper.keyIsDown(Qt::Key_Control))
+		speedModifier *= 0.5f;
+
+	return speedModifier;
+}
+
+float CameraController::getMoveSpeed(KeyboardHelper& keyboardHelper) const
+{
+	return moveSpeedModifier * getSpeedModifier(keyboardHelper);
+}
+
+void CameraController::mousePress(Qt::MouseButtons buttons, const QPoint& globalPosition, KeyboardHelper& keyboardHelper)
+{
+	mouseButtons = buttons;
+	updateMouseMode(keyboardHelper);
+
+	previousMousePosition = globalPosition;
+}
+
+void CameraController::mouseRelease(Qt::MouseButtons buttons, KeyboardHelper& keyboardHelper)
+{
+	mouseButtons = buttons;
+	updateMouseMode(keyboardHelper);
+}
+
+void CameraController::mouseMove(const QPoint& globalPosition, KeyboardHelper& keyboardHelper)
+{
+	QPoint mouseDelta = globalPosition - previousMousePosition;
+	previousMousePosition = globalPosition;
+
+	float yawAmount = -mouseDelta.x() * mouseRotateSpeedModifier;
+	float pitchAmount = -mouseDelta.y() * mouseRotateSpeedModifier;
+	float moveSpeed = mouseMoveSpeedModifier * getSpeedModifier(keyboardHelper);
+
+	if (mouseMode == MouseMode::ROTATE || mouseMode == MouseMode::ORBIT)
+	{
+		if (mouseMode == MouseMode::ORBIT)
+			orbitPointCamera = viewMatrix * orbitPointWorld;
+
+		// space rolls instead, but only when rotating in place
+		if (mouseMode == MouseMode::ROTATE && keyboardHelper.keyIsDown(Qt::Key_Space))
+			orientationMatrix = orientationMatrix * MathHelper::rotationMatrix(yawAmount, QVector3D(0, 0, 1));
+		else
+		{
+			orientationMatrix = orientationMatrix * MathHelper::rotationMatrix(yawAmount, QVector3D(0, 1, 0));
+			orientationMatrix = orientationMatrix * MathHelper::rotationMatrix(pitchAmount, QVector3D(1, 0, 0));
+		}
+
+		MathHelper::orthonormalize(orientationMatrix);
+		orientationInvMatrix = orientationMatrix.inverted();
+
+		if (mouseMode == MouseMode::ORBIT)
+			position = orbitPointWorld - orientationMatrix * orbitPointCamera;
+	}
+	else if (mouseMode == MouseMode::PAN)
+		position += (right * -mouseDelta.x() * moveSpeed + up * mouseDelta.y() * moveSpeed) * planeDistance;
+	else if (mouseMode == MouseMode::ZOOM)
+		position += forward * -mouseDelta.y() * moveSpeed;
+}
+
+void CameraController::wheel(float wheelSteps, KeyboardHelper& keyboardHelper)
+{
+	float moveAmount = wheelSteps * mouseWheelStepSizeModifier * getSpeedModifier(keyboardHelper);
+
+	position += forward * moveAmount;
+	planeDistance -= moveAmount;
+}
+
+void CameraController::updateMouseMode(KeyboardHelper& keyboardHelper)
+{
+	if (mouseButtons == Qt::LeftButton)
+		mouseMode = MouseMode::ROTATE;
+	else if (mouseButtons == Qt::RightButton)
+		mouseMode = MouseMode::ORBIT;
+	else if (mouseButtons == Qt::MidButton)
+	{
+		if (keyboardHelper.keyIsDown(Qt::Key_Space))
+			mouseMode = MouseMode::ZOOM;
+		else
+			mouseMode = MouseMode::PAN;
+	}
+	else if (mouseButtons == (Qt::LeftButton | Qt::RightButton))
+		mouseMode = MouseMode::MEASURE;
+	else
+		mouseMode = MouseMode::NONE;
+}
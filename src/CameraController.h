@@ -0,0 +1,67 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#pragma once
+
+#include <QMatrix4x4>
+#include <QPoint>
+#include <QVector3D>
+
+#include "KeyboardHelper.h"
+
+namespace CellVision
+{
+	enum class MouseMode { NONE, ROTATE, ORBIT, PAN, ZOOM, MEASURE };
+
+	// the fly camera with its key and mouse bindings and speeds, shared by the OpenGL and the software render widgets
+	// the speeds are saved to cellvision.ini, the widgets handle the rest of the keys and whatever the mouse modes hit
+	class CameraController
+	{
+	public:
+
+		// looks at the middle of the box from the front, with the plane in the middle of its depth
+		void resetPosition(const QVector3D& boxMaximum);
+		void resetSpeeds();
+		void loadSpeeds();
+		void saveSpeeds() const;
+
+		// the speed keys (Y/H, U/J, I/K, O/L) and the movement keys (W/A/S/D/Q/E and the arrows)
+		void updateKeys(KeyboardHelper& keyboardHelper, float timeStep);
+		// the view matrix and the camera axes from the position and the orientation
+		void updateMatrices();
+
+		// shift doubles and control halves every speed and step
+		static float getSpeedModifier(KeyboardHelper& keyboardHelper);
+		float getMoveSpeed(KeyboardHelper& keyboardHelper) const;
+
+		void mousePress(Qt::MouseButtons buttons, const QPoint& globalPosition, KeyboardHelper& keyboardHelper);
+		void mouseRelease(Qt::MouseButtons buttons, KeyboardHelper& keyboardHelper);
+		// rotates, orbits around orbitPointWorld, pans or zooms depending on the mouse mode
+		void mouseMove(const QPoint& globalPosition, KeyboardHelper& keyboardHelper);
+		// moves the camera and keeps the plane where it is
+		void wheel(float wheelSteps, KeyboardHelper& keyboardHelper);
+		// space changes the mode of the middle button
+		void updateMouseMode(KeyboardHelper& keyboardHelper);
+
+		QVector3D position;
+		QMatrix4x4 orientationMatrix;
+		QMatrix4x4 orientationInvMatrix;
+		QMatrix4x4 cameraMatrix;
+		QMatrix4x4 viewMatrix;
+		QVector3D right;
+		QVector3D up;
+		QVector3D forward;
+		float planeDistance = 1.0f;
+
+		Qt::MouseButtons mouseButtons;
+		MouseMode mouseMode = MouseMode::NONE;
+		QPoint previousMousePosition;
+		QVector3D orbitPointWorld;
+		QVector3D orbitPointCamera;
+
+		float moveSpeedModifier = 0.0f;
+		float mouseMoveSpeedModifier = 0.0f;
+		float mouseRotateSpeedModifier = 0.0f;
+		float mouseWheelStepSizeModifier = 0.0f;
+	};
+}
@@ -0,0 +1,136 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#include "stdafx.h"
+
+#include "CameraPath.h"
+#include "MainWindow.h"
+#include "Log.h"
+#include "StringUtils.h"
+
+using namespace CellVision;
+
+void CameraPath::clear()
+{
+	poses.clear();
+}
+
+void CameraPath::addPose(const CameraPose& pose)
+{
+	poses.push_back(pose);
+}
+
+CameraPose CameraPath::getPose(float time) const
+{
+	if (poses.empty())
+		return CameraPose();
+
+	if (time <= poses.front().time)
+		return poses.front();
+
+	if (time >= poses.back().time)
+		return poses.back();
+
+	auto next = std::upper_bound(poses.begin(), poses.end(), time, [](float t, const CameraPose& pose) { return t < pose.time; });
+	const CameraPose& pose1 = *next;
+	const CameraPose& pose0 = *(next - 1);
+
+	float alpha = (pose1.time > pose0.time) ? (time - pose0.time) / (pose1.time - pose0.time) : 0.0f;
+
+	CameraPose result;
+	result.time = time;
+	result.position = pose0.position + alpha * (pose1.position - pose0.position);
+	result.orientation = QQuaternion::slerp(pose0.orientation, pose1.orientation, alpha);
+	result.planeDistance = pose0.planeDistance + alpha * (pose1.planeDistance - pose0.planeDistance);
+
+	return result;
+}
+
+const std::vector<CameraPose>& CameraPath::getPoses() const
+{
+	return poses;
+}
+
+float CameraPath::getDuration() const
+{
+	return poses.empty() ? 0.0f : poses.back().time - poses.front().time;
+}
+
+bool CameraPath::isEmpty() const
+{
+	return poses.empty();
+}
+
+bool CameraPath::loadFromFile(const std::string& fileName)
+{
+	Log& log = MainWindow::getLog();
+	log.logInfo("Loading camera path from %s", fileName);
+
+	std::ifstream file(fileName);
+
+	if (!file.good())
+	{
+		log.logWarning("Could not open camera path file");
+		return false;
+	}
+
+	poses.clear();
+	std::string line;
+
+	while (StringUtils::safeGetline(file, line))
+	{
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		std::stringstream ss(line);
+		CameraPose pose;
+		float px, py, pz, qw, qx, qy, qz;
+
+		if (!(ss >> pose.time >> px >> py >> pz >> qw >> qx >> qy >> qz >> pose.planeDistance))
+		{
+			log.logWarning("Skipping invalid camera path line: %s", line);
+			continue;
+		}
+
+		pose.position = QVector3D(px, py, pz);
+		pose.orientation = QQuaternion(qw, qx, qy, qz).normalized();
+
+		// the poses have to be in time order for the interpolation
+		if (!poses.empty() && pose.time < poses.back().time)
+		{
+			log.logWarning("Skipping camera path line that goes back in time: %s", line);
+			continue;
+		}
+
+		poses.push_back(pose);
+	}
+
+	log.logInfo("Loaded %d camera poses (%.2f s)", poses.size(), getDuration());
+
+	return !poses.empty();
+}
+
+bool CameraPath::saveToFile(const std::string& fileName) const
+{
+	std::ofstream file(fileName);
+
+	if (!file.good())
+	{
+		MainWindow::getLog().logWarning("Could not open camera path file for writing: %s", fileName);
+		return false;
+	}
+
+	file << "# time position_x position_y position_z orientation_w orientation_x orientation_y orientation_z plane_distance\n";
+	file.precision(9);
+
+	for (const CameraPose& pose : poses)
+	{
+		file << pose.time << " " << pose.position.x() << " " << pose.position.y() << " " << pose.position.z() << " ";
+		file << pose.orientation.scalar() << " " << pose.orientation.x() << " " << pose.orientation.y() << " " << pose.orientation.z() << " ";
+		file << pose.planeDistance << "\n";
+	}
+
+	MainWindow::getLog().logInfo("Saved %d camera poses to %s", poses.size(), fileName);
+
+	return true;
+}
@@ -0,0 +1,44 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <QVector3D>
+#include <QQuaternion>
+
+namespace CellVision
+{
+	// positions and distances are in world units, time is in seconds from the start of the path
+	struct CameraPose
+	{
+		float time = 0.0f;
+		QVector3D position;
+		QQuaternion orientation;
+		float planeDistance = 1.0f;
+	};
+
+	class CameraPath
+	{
+	public:
+
+		void clear();
+		void addPose(const CameraPose& pose);
+
+		// interpolated between the recorded poses, clamped to the ends of the path
+		CameraPose getPose(float time) const;
+		const std::vector<CameraPose>& getPoses() const;
+		float getDuration() const;
+		bool isEmpty() const;
+
+		// one pose per line: time, position xyz, orientation quaternion wxyz and plane distance, lines starting with # are skipped
+		bool loadFromFile(const std::string& fileName);
+		bool saveToFile(const std::string& fileName) const;
+
+	private:
+
+		std::vector<CameraPose> poses;
+	};
+}
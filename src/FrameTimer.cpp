@@ -0,0 +1,287 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#include "stdafx.h"
+
+#include "FrameTimer.h"
+#include "MainWindow.h"
+#include "Log.h"
+
+using namespace CellVision;
+
+void FrameTimer::initialize()
+{
+	for (QuerySet& querySet : querySets)
+	{
+		for (std::unique_ptr<QOpenGLTimerQuery>& query : querySet.queries)
+		{
+			query.reset(new QOpenGLTimerQuery());
+
+			if (!query->create())
+			{
+				MainWindow::getLog().logWarning("Could not create GPU timer queries, only CPU times are measured");
+				release();
+				return;
+			}
+		}
+
+		querySet.issued.fill(false);
+		querySet.pending = false;
+	}
+
+	initialized = true;
+}
+
+void FrameTimer::release()
+{
+	for (QuerySet& querySet : querySets)
+	{
+		for (std::unique_ptr<QOpenGLTimerQuery>& query : querySet.queries)
+			query.reset();
+
+		querySet.pending = false;
+	}
+
+	initialized = false;
+}
+
+void FrameTimer::beginFrame()
+{
+	if (initialized)
+	{
+		for (QuerySet& querySet : querySets)
+			collectResults(querySet);
+
+		// results that are still not available when the set comes around again are dropped instead of waited for
+		QuerySet& querySet = querySets[frameIndex % QUERY_SET_COUNT];
+		querySet.issued.fill(false);
+		querySet.frameIndex = frameIndex;
+		querySet.pending = true;
+	}
+
+	FrameTimes frameTimes;
+	frameTimes.frameIndex = frameIndex;
+	frameTimes.gpuTimes.fill(-1.0f);
+	frameTimes.cpuTimes.fill(-1.0f);
+
+	frames.push_back(frameTimes);
+
+	if (frames.size() > MAX_FRAME_COUNT)
+		frames.pop_front();
+
+	beginCpu(CpuTimer::FRAME);
+}
+
+void FrameTimer::endFrame()
+{
+	endCpu(CpuTimer::FRAME);
+
+	++frameIndex;
+}
+
+void FrameTimer::setRenderScale(float renderScale)
+{
+	if (!frames.empty())
+		frames.back().renderScale = renderScale;
+}
+
+void FrameTimer::beginGpu(GpuTimer timer)
+{
+	if (!initialized)
+		return;
+
+	QuerySet& querySet = querySets[frameIndex % QUERY_SET_COUNT];
+	querySet.queries[size_t(timer)]->begin();
+	querySet.issued[size_t(timer)] = true;
+}
+
+void FrameTimer::endGpu(GpuTimer timer)
+{
+	if (!initialized)
+		return;
+
+	querySets[frameIndex % QUERY_SET_COUNT].queries[size_t(timer)]->end();
+}
+
+void FrameTimer::beginCpu(CpuTimer timer)
+{
+	cpuTimers[size_t(timer)].start();
+}
+
+void FrameTimer::endCpu(CpuTimer timer)
+{
+	if (!frames.empty() && cpuTimers[size_t(timer)].isValid())
+		frames.back().cpuTimes[size_t(timer)] = cpuTimers[size_t(timer)].nsecsElapsed() / 1000000.0f;
+}
+
+bool FrameTimer::getLatestSceneTime(float& sceneTime, float& renderScale) const
+{
+	if (!hasLatestCompleteFrame)
+		return false;
+
+	for (auto frame = frames.rbegin(); frame != frames.rend(); ++frame)
+	{
+		if (frame->frameIndex != latestCompleteFrameIndex)
+			continue;
+
+		const GpuTimer sceneTimers[] = { GpuTimer::BACKGROUND, GpuTimer::COORDINATES, GpuTimer::CUBE, GpuTimer::VOLUME, GpuTimer::PLANE };
+		sceneTime = 0.0f;
+
+		for (GpuTimer timer : sceneTimers)
+			sceneTime += std::max(frame->gpuTimes[size_t(timer)], 0.0f);
+
+		renderScale = frame->renderScale;
+		return true;
+	}
+
+	return false;
+}
+
+float FrameTimer::getGpuPercentile(GpuTimer timer, float percentile) const
+{
+	std::vector<float> values;
+	size_t start = (frames.size() > PERCENTILE_FRAME_COUNT) ? frames.size() - PERCENTILE_FRAME_COUNT : 0;
+
+	for (size_t i = start; i < frames.size(); ++i)
+	{
+		if (frames[i].gpuTimes[size_t(timer)] >= 0.0f)
+			values.push_back(frames[i].gpuTimes[size_t(timer)]);
+	}
+
+	return getPercentile(values, percentile);
+}
+
+float FrameTimer::getCpuPercentile(CpuTimer timer, float percentile) const
+{
+	std::vector<float> values;
+	size_t start = (frames.size() > PERCENTILE_FRAME_COUNT) ? frames.size() - PERCENTILE_FRAME_COUNT : 0;
+
+	for (size_t i = start; i < frames.size(); ++i)
+	{
+		if (frames[i].cpuTimes[size_t(timer)] >= 0.0f)
+			values.push_back(frames[i].cpuTimes[size_t(timer)]);
+	}
+
+	return getPercentile(values, percentile);
+}
+
+bool FrameTimer::saveToCsv(const std::string& fileName) const
+{
+	std::ofstream file(fileName);
+
+	if (!file.is_open())
+	{
+		MainWindow::getLog().logWarning("Could not open file for writing: %s", fileName);
+		return false;
+	}
+
+	file << "frame,render_scale";
+
+	for (size_t i = 0; i < size_t(GpuTimer::COUNT); ++i)
+		file << ",gpu_" << getName(GpuTimer(i));
+
+	for (size_t i = 0; i < size_t(CpuTimer::COUNT); ++i)
+		file << ",cpu_" << getName(CpuTimer(i));
+
+	file << "\n";
+
+	// missing times are left empty
+	for (const FrameTimes& frame : frames)
+	{
+		file << frame.frameIndex << "," << frame.renderScale;
+
+		for (float time : frame.gpuTimes)
+		{
+			file << ",";
+
+			if (time >= 0.0f)
+				file << time;
+		}
+
+		for (float time : frame.cpuTimes)
+		{
+			file << ",";
+
+			if (time >= 0.0f)
+				file << time;
+		}
+
+		file << "\n";
+	}
+
+	MainWindow::getLog().logInfo("Saved %d frames of timings to %s", frames.size(), fileName);
+
+	return true;
+}
+
+const char* FrameTimer::getName(GpuTimer timer)
+{
+	const char* names[] = { "background", "coordinates", "cube", "volume", "plane", "composite", "mini_coordinates", "measurement", "text" };
+	return names[size_t(timer)];
+}
+
+const char* FrameTimer::getName(CpuTimer timer)
+{
+	const char* names[] = { "frame", "logic", "text_paint", "text_upload" };
+	return names[size_t(timer)];
+}
+
+void FrameTimer::collectResults(QuerySet& querySet)
+{
+	if (!querySet.pending)
+		return;
+
+	for (size_t i = 0; i < size_t(GpuTimer::COUNT); ++i)
+	{
+		if (querySet.issued[i] && !querySet.queries[i]->isResultAvailable())
+			return;
+	}
+
+	querySet.pending = false;
+	FrameTimes* frame = findFrame(querySet.frameIndex);
+
+	if (frame == nullptr)
+		return;
+
+	bool hasSceneTimes = false;
+
+	for (size_t i = 0; i < size_t(GpuTimer::COUNT); ++i)
+	{
+		if (!querySet.issued[i])
+			continue;
+
+		// the result is available, so this does not wait
+		frame->gpuTimes[i] = querySet.queries[i]->waitForResult() / 1000000.0f;
+
+		if (i <= size_t(GpuTimer::PLANE))
+			hasSceneTimes = true;
+	}
+
+	if (hasSceneTimes && (!hasLatestCompleteFrame || querySet.frameIndex > latestCompleteFrameIndex))
+	{
+		latestCompleteFrameIndex = querySet.frameIndex;
+		hasLatestCompleteFrame = true;
+	}
+}
+
+FrameTimes* FrameTimer::findFrame(uint64_t frameIndex_)
+{
+	for (auto frame = frames.rbegin(); frame != frames.rend(); ++frame)
+	{
+		if (frame->frameIndex == frameIndex_)
+			return &(*frame);
+	}
+
+	return nullptr;
+}
+
+float FrameTimer::getPercentile(std::vector<float>& values, float percentile)
+{
+	if (values.empty())
+		return 0.0f;
+
+	size_t index = std::min(size_t(percentile / 100.0f * values.size()), values.size() - 1);
+	std::nth_element(values.begin(), values.begin() + index, values.end());
+
+	return values[index];
+}
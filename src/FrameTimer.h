@@ -0,0 +1,86 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+
+#include <QElapsedTimer>
+#include <QOpenGLTimerQuery>
+
+namespace CellVision
+{
+	enum class GpuTimer { BACKGROUND, COORDINATES, CUBE, VOLUME, PLANE, COMPOSITE, MINI_COORDINATES, MEASUREMENT, TEXT, COUNT };
+	enum class CpuTimer { FRAME, LOGIC, TEXT_PAINT, TEXT_UPLOAD, COUNT };
+
+	// times are in milliseconds, negative if the pass was not run or its GPU result was never available
+	struct FrameTimes
+	{
+		uint64_t frameIndex = 0;
+		float renderScale = 1.0f;
+		std::array<float, size_t(GpuTimer::COUNT)> gpuTimes;
+		std::array<float, size_t(CpuTimer::COUNT)> cpuTimes;
+	};
+
+	class FrameTimer
+	{
+	public:
+
+		// needs a current context
+		void initialize();
+		void release();
+
+		// the GPU results of earlier frames are collected here when they are ready, the pipeline is never waited on
+		void beginFrame();
+		void endFrame();
+		void setRenderScale(float renderScale);
+
+		void beginGpu(GpuTimer timer);
+		void endGpu(GpuTimer timer);
+		void beginCpu(CpuTimer timer);
+		void endCpu(CpuTimer timer);
+
+		// total GPU time of the scene passes of the latest frame that has all its results, returns false if there is none yet
+		bool getLatestSceneTime(float& sceneTime, float& renderScale) const;
+
+		// over the frames in the rolling window that ran the timer
+		float getGpuPercentile(GpuTimer timer, float percentile) const;
+		float getCpuPercentile(CpuTimer timer, float percentile) const;
+
+		bool saveToCsv(const std::string& fileName) const;
+
+		static const char* getName(GpuTimer timer);
+		static const char* getName(CpuTimer timer);
+
+	private:
+
+		// GPU results arrive a few frames late, so the queries are cycled through multiple sets
+		static const size_t QUERY_SET_COUNT = 3;
+		static const size_t MAX_FRAME_COUNT = 1000;
+		static const size_t PERCENTILE_FRAME_COUNT = 300;
+
+		struct QuerySet
+		{
+			std::array<std::unique_ptr<QOpenGLTimerQuery>, size_t(GpuTimer::COUNT)> queries;
+			std::array<bool, size_t(GpuTimer::COUNT)> issued;
+			uint64_t frameIndex = 0;
+			bool pending = false;
+		};
+
+		void collectResults(QuerySet& querySet);
+		FrameTimes* findFrame(uint64_t frameIndex);
+		static float getPercentile(std::vector<float>& values, float percentile);
+
+		std::array<QuerySet, QUERY_SET_COUNT> querySets;
+		std::array<QElapsedTimer, size_t(CpuTimer::COUNT)> cpuTimers;
+		std::deque<FrameTimes> frames;
+		uint64_t frameIndex = 0;
+		uint64_t latestCompleteFrameIndex = 0;
+		bool hasLatestCompleteFrame = false;
+		bool initialized = false;
+	};
+}
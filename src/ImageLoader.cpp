@@ -9,6 +9,24 @@
 
 using namespace CellVision;
 
+bool ImageLoaderInfo::operator==(const ImageLoaderInfo& other) const
+{
+	return fileName == other.fileName &&
+		channelCount == other.channelCount &&
+		imagesPerChannel == other.imagesPerChannel &&
+		redChannelEnabled == other.redChannelEnabled &&
+		greenChannelEnabled == other.greenChannelEnabled &&
+		blueChannelEnabled == other.blueChannelEnabled &&
+		redChannelIndex == other.redChannelIndex &&
+		greenChannelIndex == other.greenChannelIndex &&
+		blueChannelIndex == other.blueChannelIndex;
+}
+
+bool ImageLoaderInfo::operator!=(const ImageLoaderInfo& other) const
+{
+	return !(*this == other);
+}
+
 ImageLoaderResult ImageLoader::loadFromMultipageTiff(const ImageLoaderInfo& info)
 {
 	Log& log = MainWindow::getLog();
@@ -28,58 +46,63 @@ ImageLoaderResult ImageLoader::loadFromMultipageTiff(const ImageLoaderInfo& info
 	TIFFGetField(tiffFile, TIFFTAG_IMAGELENGTH, &result.height);
 
 	result.depth = info.imagesPerChannel;
-	result.data.reserve(result.width * result.height * result.depth);
+	result.data.resize(uint64_t(result.width) * result.height * result.depth);
 
-	std::vector<uint32_t> tempRedData(result.width * result.height);
-	std::vector<uint32_t> tempGreenData(result.width * result.height);
-	std::vector<uint32_t> tempBlueData(result.width * result.height);
-	std::vector<uint32_t> tempData(result.width * result.height);
-
-	std::fill(tempRedData.begin(), tempRedData.end(), 0);
-	std::fill(tempGreenData.begin(), tempGreenData.end(), 0);
-	std::fill(tempBlueData.begin(), tempBlueData.end(), 0);
+	uint64_t sliceSize = uint64_t(result.width) * result.height;
 
 	for (uint16_t i = 0; i < info.imagesPerChannel; ++i)
 	{
-		if (info.redChannelEnabled)
-		{
-			uint16_t directoryIndex = i * info.channelCount + info.redChannelIndex - 1;
+		if (!readSlice(tiffFile, info, result.width, result.height, i, &result.data[i * sliceSize]))
+			return ImageLoaderResult();
+	}
 
-			if (!readImageData(tiffFile, directoryIndex, result.width, result.height, &tempRedData[0]))
-				return ImageLoaderResult();
-		}
+	TIFFClose(tiffFile);
 
-		if (info.greenChannelEnabled)
-		{
-			uint16_t directoryIndex = i * info.channelCount + info.greenChannelIndex - 1;
+	return result;
+}
 
-			if (!readImageData(tiffFile, directoryIndex, result.width, result.height, &tempGreenData[0]))
-				return ImageLoaderResult();
-		}
-		
-		if (info.blueChannelEnabled)
-		{
-			uint16_t directoryIndex = i * info.channelCount + info.blueChannelIndex - 1;
+ImageLoaderResult16 ImageLoader::loadFromMultipageTiff16(const ImageLoaderInfo& info)
+{
+	Log& log = MainWindow::getLog();
+	log.logInfo("Loading 16-bit multipage TIFF image from %s", info.fileName);
 
-			if (!readImageData(tiffFile, directoryIndex, result.width, result.height, &tempBlueData[0]))
-				return ImageLoaderResult();
-		}
+	TIFF* tiffFile = TIFFOpen(info.fileName.c_str(), "r");
+
+	if (tiffFile == nullptr)
+	{
+		log.logWarning("Could not open image file");
+		return ImageLoaderResult16();
+	}
+
+	ImageLoaderResult16 result;
+
+	TIFFGetField(tiffFile, TIFFTAG_IMAGEWIDTH, &result.width);
+	TIFFGetField(tiffFile, TIFFTAG_IMAGELENGTH, &result.height);
+
+	result.depth = info.imagesPerChannel;
+
+	const bool channelEnabled[3] = { info.redChannelEnabled, info.greenChannelEnabled, info.blueChannelEnabled };
+	const uint16_t channelIndex[3] = { info.redChannelIndex, info.greenChannelIndex, info.blueChannelIndex };
+	uint64_t sliceSize = uint64_t(result.width) * result.height;
+
+	for (uint32_t c = 0; c < 3; ++c)
+	{
+		if (channelEnabled[c])
+			result.channelData[c].resize(sliceSize * result.depth);
+	}
 
-		for (uint64_t j = 0; j < result.width * result.height; ++j)
+	for (uint16_t i = 0; i < info.imagesPerChannel; ++i)
+	{
+		for (uint32_t c = 0; c < 3; ++c)
 		{
-			uint32_t red = tempRedData[j];
-			uint32_t green = tempGreenData[j];
-			uint32_t blue = tempBlueData[j];
-			uint32_t combined = 0xff000000;
+			if (!channelEnabled[c])
+				continue;
 
-			combined |= red & 0x000000ff;
-			combined |= (green & 0x000000ff) << 8;
-			combined |= (blue & 0x000000ff) << 16;
+			uint16_t directoryIndex = i * info.channelCount + channelIndex[c] - 1;
 
-			tempData[j] = combined;
+			if (!readImageData16(tiffFile, directoryIndex, result.width, result.height, &result.channelData[c][i * sliceSize]))
+				return ImageLoaderResult16();
 		}
-
-		result.data.insert(result.data.end(), tempData.begin(), tempData.end());
 	}
 
 	TIFFClose(tiffFile);
@@ -87,6 +110,55 @@ ImageLoaderResult ImageLoader::loadFromMultipageTiff(const ImageLoaderInfo& info
 	return result;
 }
 
+bool ImageLoader::readSlice(TIFF* tiffFile, const ImageLoaderInfo& info, uint32_t width, uint32_t height, uint16_t slice, uint32_t* data)
+{
+	uint64_t sliceSize = uint64_t(width) * height;
+
+	std::vector<uint32_t> tempRedData(sliceSize, 0);
+	std::vector<uint32_t> tempGreenData(sliceSize, 0);
+	std::vector<uint32_t> tempBlueData(sliceSize, 0);
+
+	if (info.redChannelEnabled)
+	{
+		uint16_t directoryIndex = slice * info.channelCount + info.redChannelIndex - 1;
+
+		if (!readImageData(tiffFile, directoryIndex, width, height, &tempRedData[0]))
+			return false;
+	}
+
+	if (info.greenChannelEnabled)
+	{
+		uint16_t directoryIndex = slice * info.channelCount + info.greenChannelIndex - 1;
+
+		if (!readImageData(tiffFile, directoryIndex, width, height, &tempGreenData[0]))
+			return false;
+	}
+
+	if (info.blueChannelEnabled)
+	{
+		uint16_t directoryIndex = slice * info.channelCount + info.blueChannelIndex - 1;
+
+		if (!readImageData(tiffFile, directoryIndex, width, height, &tempBlueData[0]))
+			return false;
+	}
+
+	for (uint64_t j = 0; j < sliceSize; ++j)
+	{
+		uint32_t red = tempRedData[j];
+		uint32_t green = tempGreenData[j];
+		uint32_t blue = tempBlueData[j];
+		uint32_t combined = 0xff000000;
+
+		combined |= red & 0x000000ff;
+		combined |= (green & 0x000000ff) << 8;
+		combined |= (blue & 0x000000ff) << 16;
+
+		data[j] = combined;
+	}
+
+	return true;
+}
+
 bool ImageLoader::readImageData(TIFF* tiffFile, uint16_t directoryIndex, uint32_t width, uint32_t height, uint32_t* data)
 {
 	Log& log = MainWindow::getLog();
@@ -107,3 +179,53 @@ bool ImageLoader::readImageData(TIFF* tiffFile, uint16_t directoryIndex, uint32_
 	
 	return true;
 }
+
+bool ImageLoader::readImageData16(TIFF* tiffFile, uint16_t directoryIndex, uint32_t width, uint32_t height, uint16_t* data)
+{
+	Log& log = MainWindow::getLog();
+
+	if (!TIFFSetDirectory(tiffFile, directoryIndex))
+	{
+		log.logWarning("Could not set TIFF directory");
+		TIFFClose(tiffFile);
+		return false;
+	}
+
+	uint16_t bitsPerSample = 0;
+	uint16_t samplesPerPixel = 1;
+
+	TIFFGetField(tiffFile, TIFFTAG_BITSPERSAMPLE, &bitsPerSample);
+	TIFFGetFieldDefaulted(tiffFile, TIFFTAG_SAMPLESPERPIXEL, &samplesPerPixel);
+
+	if ((bitsPerSample != 8 && bitsPerSample != 16) || samplesPerPixel != 1 || TIFFIsTiled(tiffFile))
+	{
+		log.logWarning("Only 8-bit and 16-bit single sample stripped TIFF images can be loaded as 16-bit data");
+		TIFFClose(tiffFile);
+		return false;
+	}
+
+	std::vector<uint8_t> scanline(TIFFScanlineSize(tiffFile));
+
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		if (TIFFReadScanline(tiffFile, &scanline[0], y, 0) < 0)
+		{
+			log.logWarning("Could not read TIFF scanline data");
+			TIFFClose(tiffFile);
+			return false;
+		}
+
+		// rows are stored bottom-up to match the orientation of TIFFReadRGBAImage
+		uint16_t* row = &data[uint64_t(height - 1 - y) * width];
+
+		if (bitsPerSample == 16)
+			std::copy(reinterpret_cast<const uint16_t*>(&scanline[0]), reinterpret_cast<const uint16_t*>(&scanline[0]) + width, row);
+		else
+		{
+			for (uint32_t x = 0; x < width; ++x)
+				row[x] = uint16_t(scanline[x]) * 257;
+		}
+	}
+
+	return true;
+}
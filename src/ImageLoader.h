@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <array>
 #include <cstdint>
 #include <vector>
 
@@ -13,14 +14,17 @@ namespace CellVision
 	struct ImageLoaderInfo
 	{
 		std::string fileName;
-		uint16_t channelCount;
-		uint16_t imagesPerChannel;
-		bool redChannelEnabled;
-		bool greenChannelEnabled;
-		bool blueChannelEnabled;
-		uint16_t redChannelIndex;
-		uint16_t greenChannelIndex;
-		uint16_t blueChannelIndex;
+		uint16_t channelCount = 1;
+		uint16_t imagesPerChannel = 1;
+		bool redChannelEnabled = false;
+		bool greenChannelEnabled = false;
+		bool blueChannelEnabled = false;
+		uint16_t redChannelIndex = 1;
+		uint16_t greenChannelIndex = 1;
+		uint16_t blueChannelIndex = 1;
+
+		bool operator==(const ImageLoaderInfo& other) const;
+		bool operator!=(const ImageLoaderInfo& other) const;
 	};
 
 	struct ImageLoaderResult
@@ -31,15 +35,30 @@ namespace CellVision
 		std::vector<uint32_t> data;
 	};
 
+	// one 16-bit plane per color (red, green, blue), disabled colors are left empty
+	struct ImageLoaderResult16
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t depth = 0;
+		std::array<std::vector<uint16_t>, 3> channelData;
+	};
+
 	class ImageLoader
 	{
 		
 	public:
 
 		static ImageLoaderResult loadFromMultipageTiff(const ImageLoaderInfo& info);
+		static ImageLoaderResult16 loadFromMultipageTiff16(const ImageLoaderInfo& info);
+
+		// the enabled channels of one z slice packed like in loadFromMultipageTiff, for reading single slices from a file that is kept open
+		// the file is closed if the reading fails
+		static bool readSlice(TIFF* tiffFile, const ImageLoaderInfo& info, uint32_t width, uint32_t height, uint16_t slice, uint32_t* data);
 
 	private:
 
 		static bool readImageData(TIFF* tiffFile, uint16_t directoryIndex, uint32_t width, uint32_t height, uint32_t* data);
+		static bool readImageData16(TIFF* tiffFile, uint16_t directoryIndex, uint32_t width, uint32_t height, uint16_t* data);
 	};
 }
@@ -0,0 +1,92 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#include "stdafx.h"
+
+#include "ImageSaver.h"
+#include "MainWindow.h"
+#include "Log.h"
+
+using namespace CellVision;
+
+bool ImageSaver::saveToFloatTiff(const std::string& fileName, uint32_t width, uint32_t height, const std::vector<float>& data)
+{
+	Log& log = MainWindow::getLog();
+	log.logInfo("Saving 32-bit float TIFF image to %s", fileName);
+
+	TIFF* tiffFile = TIFFOpen(fileName.c_str(), "w");
+
+	if (tiffFile == nullptr)
+	{
+		log.logWarning("Could not open image file for writing");
+		return false;
+	}
+
+	TIFFSetField(tiffFile, TIFFTAG_IMAGEWIDTH, width);
+	TIFFSetField(tiffFile, TIFFTAG_IMAGELENGTH, height);
+	TIFFSetField(tiffFile, TIFFTAG_SAMPLESPERPIXEL, 3);
+	TIFFSetField(tiffFile, TIFFTAG_BITSPERSAMPLE, 32);
+	TIFFSetField(tiffFile, TIFFTAG_SAMPLEFORMAT, SAMPLEFORMAT_IEEEFP);
+	TIFFSetField(tiffFile, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
+	TIFFSetField(tiffFile, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+	TIFFSetField(tiffFile, TIFFTAG_ORIENTATION, ORIENTATION_TOPLEFT);
+	TIFFSetField(tiffFile, TIFFTAG_COMPRESSION, COMPRESSION_NONE);
+	TIFFSetField(tiffFile, TIFFTAG_ROWSPERSTRIP, TIFFDefaultStripSize(tiffFile, 0));
+
+	std::vector<float> scanline(uint64_t(width) * 3);
+
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		const float* row = &data[uint64_t(height - 1 - y) * width * 3];
+		std::copy(row, row + uint64_t(width) * 3, scanline.begin());
+
+		if (TIFFWriteScanline(tiffFile, &scanline[0], y, 0) < 0)
+		{
+			log.logWarning("Could not write TIFF scanline");
+			TIFFClose(tiffFile);
+			return false;
+		}
+	}
+
+	TIFFClose(tiffFile);
+
+	return true;
+}
+
+bool ImageSaver::saveToTiff(const std::string& fileName, const QImage& image)
+{
+	Log& log = MainWindow::getLog();
+	TIFF* tiffFile = TIFFOpen(fileName.c_str(), "w");
+
+	if (tiffFile == nullptr)
+	{
+		log.logWarning("Could not open image file for writing: %s", fileName);
+		return false;
+	}
+
+	QImage rgbImage = image.convertToFormat(QImage::Format_RGB888);
+
+	TIFFSetField(tiffFile, TIFFTAG_IMAGEWIDTH, uint32_t(rgbImage.width()));
+	TIFFSetField(tiffFile, TIFFTAG_IMAGELENGTH, uint32_t(rgbImage.height()));
+	TIFFSetField(tiffFile, TIFFTAG_SAMPLESPERPIXEL, 3);
+	TIFFSetField(tiffFile, TIFFTAG_BITSPERSAMPLE, 8);
+	TIFFSetField(tiffFile, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
+	TIFFSetField(tiffFile, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+	TIFFSetField(tiffFile, TIFFTAG_ORIENTATION, ORIENTATION_TOPLEFT);
+	TIFFSetField(tiffFile, TIFFTAG_COMPRESSION, COMPRESSION_LZW);
+	TIFFSetField(tiffFile, TIFFTAG_ROWSPERSTRIP, TIFFDefaultStripSize(tiffFile, 0));
+
+	for (int y = 0; y < rgbImage.height(); ++y)
+	{
+		if (TIFFWriteScanline(tiffFile, rgbImage.scanLine(y), uint32_t(y), 0) < 0)
+		{
+			log.logWarning("Could not write TIFF scanline: %s", fileName);
+			TIFFClose(tiffFile);
+			return false;
+		}
+	}
+
+	TIFFClose(tiffFile);
+
+	return true;
+}
@@ -0,0 +1,24 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <QImage>
+
+namespace CellVision
+{
+	class ImageSaver
+	{
+	public:
+
+		// interleaved RGB data with the bottom row first, like the loaded volumes
+		static bool saveToFloatTiff(const std::string& fileName, uint32_t width, uint32_t height, const std::vector<float>& data);
+
+		// 8-bit RGB, meant for saving many rendered images in a row so only failures are logged
+		static bool saveToTiff(const std::string& fileName, const QImage& image);
+	};
+}
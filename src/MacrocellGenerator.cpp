@@ -0,0 +1,213 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#include "stdafx.h"
+
+#include "MacrocellGenerator.h"
+#include "ParallelHelper.h"
+
+using namespace CellVision;
+
+MacrocellGrid MacrocellGenerator::generateGrid(const ImageLoaderResult& volume, uint32_t cellSize)
+{
+	MacrocellGrid grid = createGrid(volume.width, volume.height, volume.depth, cellSize);
+	uint64_t sliceSize = uint64_t(volume.width) * volume.height;
+
+	// one row of cells per work item, the voxels of a row are contiguous in memory
+	ParallelHelper::parallelFor(uint64_t(grid.cellsY) * grid.cellsZ, [&](uint64_t rowIndex)
+	{
+		uint32_t cellY = uint32_t(rowIndex % grid.cellsY);
+		uint32_t cellZ = uint32_t(rowIndex / grid.cellsY);
+		uint32_t startY, endY, startZ, endZ;
+		getCellRange(cellY, cellSize, volume.height, startY, endY);
+		getCellRange(cellZ, cellSize, volume.depth, startZ, endZ);
+
+		for (uint32_t cellX = 0; cellX < grid.cellsX; ++cellX)
+		{
+			uint32_t startX, endX;
+			getCellRange(cellX, cellSize, volume.width, startX, endX);
+
+			uint32_t minimums[3] = { 255, 255, 255 };
+			uint32_t maximums[3] = { 0, 0, 0 };
+
+			for (uint32_t z = startZ; z < endZ; ++z)
+			{
+				for (uint32_t y = startY; y < endY; ++y)
+				{
+					const uint32_t* row = &volume.data[z * sliceSize + uint64_t(y) * volume.width];
+
+					for (uint32_t x = startX; x < endX; ++x)
+					{
+						for (uint32_t c = 0; c < 3; ++c)
+						{
+							uint32_t value = (row[x] >> (c * 8)) & 0xff;
+
+							minimums[c] = std::min(minimums[c], value);
+							maximums[c] = std::max(maximums[c], value);
+						}
+					}
+				}
+			}
+
+			uint64_t cellIndex = rowIndex * grid.cellsX + cellX;
+
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				grid.minimums[cellIndex * 3 + c] = minimums[c] / 255.0f;
+				grid.maximums[cellIndex * 3 + c] = maximums[c] / 255.0f;
+			}
+		}
+	});
+
+	return grid;
+}
+
+MacrocellGrid MacrocellGenerator::generateGrid(const ImageLoaderResult16& volume, uint32_t cellSize)
+{
+	MacrocellGrid grid = createGrid(volume.width, volume.height, volume.depth, cellSize);
+	uint64_t sliceSize = uint64_t(volume.width) * volume.height;
+
+	ParallelHelper::parallelFor(uint64_t(grid.cellsY) * grid.cellsZ, [&](uint64_t rowIndex)
+	{
+		uint32_t cellY = uint32_t(rowIndex % grid.cellsY);
+		uint32_t cellZ = uint32_t(rowIndex / grid.cellsY);
+		uint32_t startY, endY, startZ, endZ;
+		getCellRange(cellY, cellSize, volume.height, startY, endY);
+		getCellRange(cellZ, cellSize, volume.depth, startZ, endZ);
+
+		for (uint32_t cellX = 0; cellX < grid.cellsX; ++cellX)
+		{
+			uint32_t startX, endX;
+			getCellRange(cellX, cellSize, volume.width, startX, endX);
+
+			uint64_t cellIndex = rowIndex * grid.cellsX + cellX;
+
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				const std::vector<uint16_t>& channel = volume.channelData[c];
+
+				// disabled channels read as zero
+				uint16_t minimum = channel.empty() ? 0 : std::numeric_limits<uint16_t>::max();
+				uint16_t maximum = 0;
+
+				for (uint32_t z = startZ; z < endZ && !channel.empty(); ++z)
+				{
+					for (uint32_t y = startY; y < endY; ++y)
+					{
+						const uint16_t* row = &channel[z * sliceSize + uint64_t(y) * volume.width];
+
+						for (uint32_t x = startX; x < endX; ++x)
+						{
+							minimum = std::min(minimum, row[x]);
+							maximum = std::max(maximum, row[x]);
+						}
+					}
+				}
+
+				grid.minimums[cellIndex * 3 + c] = minimum / 65535.0f;
+				grid.maximums[cellIndex * 3 + c] = maximum / 65535.0f;
+			}
+		}
+	});
+
+	return grid;
+}
+
+bool MacrocellGenerator::getOccupiedBounds(const MacrocellGrid& grid, const std::array<float, 3>& thresholds, std::array<float, 3>& minimum, std::array<float, 3>& maximum)
+{
+	uint32_t minimumCell[3] = { grid.cellsX, grid.cellsY, grid.cellsZ };
+	uint32_t maximumCell[3] = { 0, 0, 0 };
+	bool isOccupied = false;
+
+	for (uint32_t z = 0; z < grid.cellsZ; ++z)
+	{
+		for (uint32_t y = 0; y < grid.cellsY; ++y)
+		{
+			for (uint32_t x = 0; x < grid.cellsX; ++x)
+			{
+				uint64_t cellIndex = (uint64_t(z) * grid.cellsY + y) * grid.cellsX + x;
+
+				if (isCellEmpty(grid, cellIndex, thresholds))
+					continue;
+
+				const uint32_t cell[3] = { x, y, z };
+
+				for (uint32_t i = 0; i < 3; ++i)
+				{
+					minimumCell[i] = std::min(minimumCell[i], cell[i]);
+					maximumCell[i] = std::max(maximumCell[i], cell[i]);
+				}
+
+				isOccupied = true;
+			}
+		}
+	}
+
+	if (!isOccupied)
+		return false;
+
+	const uint32_t sizes[3] = { grid.width, grid.height, grid.depth };
+
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		minimum[i] = float(minimumCell[i] * grid.cellSize) / float(sizes[i]);
+		maximum[i] = float(std::min((maximumCell[i] + 1) * grid.cellSize, sizes[i])) / float(sizes[i]);
+	}
+
+	return true;
+}
+
+float MacrocellGenerator::getEmptyFraction(const MacrocellGrid& grid, const std::array<float, 3>& thresholds)
+{
+	uint64_t cellCount = uint64_t(grid.cellsX) * grid.cellsY * grid.cellsZ;
+	uint64_t emptyCount = 0;
+
+	if (cellCount == 0)
+		return 0.0f;
+
+	for (uint64_t i = 0; i < cellCount; ++i)
+	{
+		if (isCellEmpty(grid, i, thresholds))
+			emptyCount++;
+	}
+
+	return float(double(emptyCount) / double(cellCount));
+}
+
+MacrocellGrid MacrocellGenerator::createGrid(uint32_t width, uint32_t height, uint32_t depth, uint32_t cellSize)
+{
+	MacrocellGrid grid;
+	grid.cellSize = cellSize;
+	grid.cellsX = (width + cellSize - 1) / cellSize;
+	grid.cellsY = (height + cellSize - 1) / cellSize;
+	grid.cellsZ = (depth + cellSize - 1) / cellSize;
+	grid.width = width;
+	grid.height = height;
+	grid.depth = depth;
+
+	uint64_t cellCount = uint64_t(grid.cellsX) * grid.cellsY * grid.cellsZ;
+	grid.minimums.resize(cellCount * 3);
+	grid.maximums.resize(cellCount * 3);
+
+	return grid;
+}
+
+void MacrocellGenerator::getCellRange(uint32_t cell, uint32_t cellSize, uint32_t size, uint32_t& start, uint32_t& end)
+{
+	start = cell * cellSize;
+	end = std::min(start + cellSize + 1, size);
+
+	if (start > 0)
+		start--;
+}
+
+bool MacrocellGenerator::isCellEmpty(const MacrocellGrid& grid, uint64_t cellIndex, const std::array<float, 3>& thresholds)
+{
+	for (uint32_t c = 0; c < 3; ++c)
+	{
+		if (grid.maximums[cellIndex * 3 + c] > thresholds[c])
+			return false;
+	}
+
+	return true;
+}
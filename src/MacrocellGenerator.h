@@ -0,0 +1,48 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "ImageLoader.h"
+
+namespace CellVision
+{
+	// per-cell, per-channel value range of a volume, used to skip sampling where nothing can be visible
+	struct MacrocellGrid
+	{
+		uint32_t cellSize = 0;
+		uint32_t cellsX = 0;
+		uint32_t cellsY = 0;
+		uint32_t cellsZ = 0;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t depth = 0;
+		std::vector<float> minimums;
+		std::vector<float> maximums;
+	};
+
+	class MacrocellGenerator
+	{
+	public:
+
+		// values are normalized to [0, 1] and stored as RGB triplets per cell
+		// every cell also covers the first voxel of its neighbours, so linear filtering anywhere inside it stays within the range
+		static MacrocellGrid generateGrid(const ImageLoaderResult& volume, uint32_t cellSize);
+		static MacrocellGrid generateGrid(const ImageLoaderResult16& volume, uint32_t cellSize);
+
+		// cells are empty if no channel exceeds its threshold
+		// bounds are the normalized texture coordinates of the box around all non-empty cells, returns false if there are none
+		static bool getOccupiedBounds(const MacrocellGrid& grid, const std::array<float, 3>& thresholds, std::array<float, 3>& minimum, std::array<float, 3>& maximum);
+		static float getEmptyFraction(const MacrocellGrid& grid, const std::array<float, 3>& thresholds);
+
+	private:
+
+		static MacrocellGrid createGrid(uint32_t width, uint32_t height, uint32_t depth, uint32_t cellSize);
+		static void getCellRange(uint32_t cell, uint32_t cellSize, uint32_t size, uint32_t& start, uint32_t& end);
+		static bool isCellEmpty(const MacrocellGrid& grid, uint64_t cellIndex, const std::array<float, 3>& thresholds);
+	};
+}
@@ -4,6 +4,10 @@
 #include "stdafx.h"
 
 #include "MainWindow.h"
+#include "VolumeResource.h"
+#include "PathBenchmark.h"
+#include "SnapshotRenderer.h"
+#include "ResliceExporter.h"
 #include "Log.h"
 #include "Common.h"
 
@@ -35,6 +39,19 @@ namespace
 			default: break;
 		}
 	}
+
+	// the main window needs at least an OpenGL 3.3 context with the default format, otherwise it falls back to software rendering
+	bool openGLIsAvailable()
+	{
+		QOpenGLContext context;
+		context.setFormat(QSurfaceFormat::defaultFormat());
+
+		if (!context.create())
+			return false;
+
+		QSurfaceFormat format = context.format();
+		return format.majorVersion() > 3 || (format.majorVersion() == 3 && format.minorVersion() >= 3);
+	}
 }
 
 int main(int argc, char *argv[])
@@ -59,19 +76,147 @@ int main(int argc, char *argv[])
 	format.setProfile(QSurfaceFormat::CompatibilityProfile);
 #endif
 	QSurfaceFormat::setDefaultFormat(format);
+	QCoreApplication::setAttribute(Qt::AA_ShareOpenGLContexts);
 
 	QApplication app(argc, argv);
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("A 3D volume image visualizer.");
+	parser.addHelpOption();
+
+	QCommandLineOption benchmarkOption("benchmark", "Replay a camera path offscreen with the dataset and report the frame times.", "dataset.ini");
+	QCommandLineOption pathOption("path", "Camera path file recorded with F3.", "file");
+	QCommandLineOption sizeOption("size", "Frame size in pixels, 1920x1080 by default.", "WxH", "1920x1080");
+	QCommandLineOption timeStepOption("time-step", "Path time between frames in seconds, 1/60 by default.", "seconds");
+	QCommandLineOption outputOption("output", "CSV file for the individual frame times.", "file");
+	QCommandLineOption snapshotsOption("snapshots", "Render an image of the dataset for every pose in the pose file without opening a window.", "dataset.ini");
+	QCommandLineOption posesOption("poses", "Pose file in the camera path format, one image is rendered per line.", "file");
+	QCommandLineOption outputDirectoryOption("output-dir", "Directory for the snapshot images, the current directory by default.", "directory", ".");
+	QCommandLineOption formatOption("format", "Snapshot image format, png or tif.", "format", "png");
+	QCommandLineOption resliceOption("reslice", "Resample the plane of every pose in the pose file on the CPU and save them as float TIFFs.", "dataset.ini");
+	QCommandLineOption spacingOption("spacing", "Reslice pixel spacing in the physical units of the dataset, the smallest voxel size by default.", "size");
+	QCommandLineOption interpolationOption("interpolation", "Reslice interpolation, nearest or linear.", "mode", "linear");
+	QCommandLineOption softwareOption("software", "Use the software slice view even if OpenGL 3.3 is available.");
+
+	parser.addOptions({ benchmarkOption, pathOption, sizeOption, timeStepOption, outputOption, snapshotsOption, posesOption, outputDirectoryOption, formatOption, resliceOption, spacingOption, interpolationOption, softwareOption });
+	parser.process(app);
+
+	// the given paths are relative to where the program was started from, not to the data directory
+	auto getAbsolutePath = [&](const QCommandLineOption& option)
+	{
+		return parser.value(option).isEmpty() ? QString() : QFileInfo(parser.value(option)).absoluteFilePath();
+	};
+
+	PathBenchmarkSettings benchmarkSettings;
+	benchmarkSettings.datasetFileName = getAbsolutePath(benchmarkOption);
+	benchmarkSettings.cameraPathFileName = getAbsolutePath(pathOption);
+	benchmarkSettings.outputFileName = getAbsolutePath(outputOption);
+
+	QStringList sizeParts = parser.value(sizeOption).split('x');
+
+	if (sizeParts.size() == 2)
+		benchmarkSettings.frameSize = QSize(std::max(sizeParts[0].toInt(), 1), std::max(sizeParts[1].toInt(), 1));
+
+	if (parser.isSet(timeStepOption))
+		benchmarkSettings.timeStep = std::max(parser.value(timeStepOption).toFloat(), 0.0001f);
+
+	SnapshotSettings snapshotSettings;
+	snapshotSettings.datasetFileName = getAbsolutePath(snapshotsOption);
+	snapshotSettings.poseFileName = getAbsolutePath(posesOption);
+	snapshotSettings.outputDirectory = getAbsolutePath(outputDirectoryOption);
+	snapshotSettings.imageFormat = parser.value(formatOption);
+	snapshotSettings.frameSize = benchmarkSettings.frameSize;
+
+	ResliceExporterSettings resliceSettings;
+	resliceSettings.datasetFileName = getAbsolutePath(resliceOption);
+	resliceSettings.poseFileName = snapshotSettings.poseFileName;
+	resliceSettings.outputDirectory = snapshotSettings.outputDirectory;
+	resliceSettings.frameSize = benchmarkSettings.frameSize;
+	resliceSettings.interpolation = (parser.value(interpolationOption).toLower() == "nearest") ? ResliceInterpolation::NEAREST : ResliceInterpolation::TRILINEAR;
+	resliceSettings.spacing = parser.value(spacingOption).toFloat();
 	
 	QDir::setCurrent(QCoreApplication::applicationDirPath());
 	QFontDatabase::addApplicationFont("data/fonts/RobotoMono-Regular.ttf");
 
-	MainWindow mainWindow;
-	Log& log = mainWindow.getLog();
+	Log& log = MainWindow::getLog();
 	log.logInfo("CellVision v%s", CELLVISION_VERSION);
 
 	staticLog = &log;
 	qInstallMessageHandler(messageHandler);
 
+	if (parser.isSet(benchmarkOption))
+	{
+		if (!parser.isSet(pathOption))
+		{
+			log.logError("The benchmark needs a camera path (--path)");
+			return -1;
+		}
+
+		try
+		{
+			return PathBenchmark::run(benchmarkSettings);
+		}
+		catch (...)
+		{
+			log.logException(std::current_exception());
+			return -1;
+		}
+	}
+
+	if (parser.isSet(snapshotsOption))
+	{
+		if (!parser.isSet(posesOption))
+		{
+			log.logError("Snapshots need a pose file (--poses)");
+			return -1;
+		}
+
+		try
+		{
+			return SnapshotRenderer::run(snapshotSettings);
+		}
+		catch (...)
+		{
+			log.logException(std::current_exception());
+			return -1;
+		}
+	}
+
+	if (parser.isSet(resliceOption))
+	{
+		if (!parser.isSet(posesOption))
+		{
+			log.logError("Reslicing needs a pose file (--poses)");
+			return -1;
+		}
+
+		try
+		{
+			return ResliceExporter::run(resliceSettings);
+		}
+		catch (...)
+		{
+			log.logException(std::current_exception());
+			return -1;
+		}
+	}
+
+	bool useSoftwareRendering = parser.isSet(softwareOption);
+
+	if (!useSoftwareRendering && !openGLIsAvailable())
+	{
+		log.logWarning("Could not create an OpenGL 3.3 context, using the software slice view");
+		useSoftwareRendering = true;
+	}
+
+	// volumes can be freed on any thread, the surface for that has to be created here
+	QOffscreenSurface releaseSurface;
+	releaseSurface.setFormat(QSurfaceFormat::defaultFormat());
+	releaseSurface.create();
+	VolumeResource::setReleaseSurface(&releaseSurface);
+
+	MainWindow mainWindow(useSoftwareRendering);
+
 	try
 	{
 		mainWindow.show();
@@ -7,13 +7,25 @@
 #include "Log.h"
 #include "MetadataLoader.h"
 #include "ImageLoader.h"
+#include "SoftwareRenderWidget.h"
 
 using namespace CellVision;
 
-MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent)
+MainWindow::MainWindow(bool useSoftwareRendering, QWidget* parent) : QMainWindow(parent)
 {
 	ui.setupUi(this);
 
+	// the OpenGL widget is never shown, so it never tries to create its context
+	if (useSoftwareRendering)
+	{
+		softwareRenderWidget = new SoftwareRenderWidget();
+		softwareRenderWidget->setSizePolicy(ui.renderWidget->sizePolicy());
+		ui.splitterMain->insertWidget(0, softwareRenderWidget);
+
+		delete ui.renderWidget;
+		ui.renderWidget = nullptr;
+	}
+
 	QLocale locale(QLocale::English);
 
 	doubleValueValidator.setLocale(locale);
@@ -21,6 +33,8 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent)
 	ui.lineEditImageWidth->setValidator(&doubleValueValidator);
 	ui.lineEditImageHeight->setValidator(&doubleValueValidator);
 	ui.lineEditImageDepth->setValidator(&doubleValueValidator);
+	ui.lineEditDeskewAngle->setValidator(&doubleValueValidator);
+	ui.lineEditScanStep->setValidator(&doubleValueValidator);
 
 	QSettings settings("cellvision.ini", QSettings::IniFormat);
 
@@ -34,12 +48,15 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent)
 	ui.lineEditImageWidth->setText(locale.toString(settings.value("imageWidth", 1.0).toDouble(), 'e', 6));
 	ui.lineEditImageHeight->setText(locale.toString(settings.value("imageHeight", 1.0).toDouble(), 'e', 6));
 	ui.lineEditImageDepth->setText(locale.toString(settings.value("imageDepth", 1.0).toDouble(), 'e', 6));
+	ui.lineEditDeskewAngle->setText(locale.toString(settings.value("deskewAngle", 0.0).toDouble(), 'f', 2));
+	ui.lineEditScanStep->setText(locale.toString(settings.value("scanStep", 0.0).toDouble(), 'e', 6));
 	ui.spinBoxRedChannel->setValue(settings.value("redChannel", 1).toInt());
 	ui.spinBoxGreenChannel->setValue(settings.value("greenChannel", 1).toInt());
 	ui.spinBoxBlueChannel->setValue(settings.value("blueChannel", 1).toInt());
 	ui.checkBoxRedChannelEnabled->setChecked(settings.value("redChannelEnabled", false).toBool());
 	ui.checkBoxGreenChannelEnabled->setChecked(settings.value("greenChannelEnabled", false).toBool());
 	ui.checkBoxBlueChannelEnabled->setChecked(settings.value("blueChannelEnabled", false).toBool());
+	ui.comboBoxTextureFormat->setCurrentIndex(settings.value("textureFormat", 0).toInt());
 	backgroundColor = settings.value("backgroundColor", QColor(100, 100, 100, 255)).value<QColor>();
 	lineColor = settings.value("lineColor", QColor(255, 255, 255, 128)).value<QColor>();
 
@@ -86,12 +103,15 @@ void MainWindow::closeEvent(QCloseEvent* ce)
 	settings.setValue("imageWidth", ui.lineEditImageWidth->text());
 	settings.setValue("imageHeight", ui.lineEditImageHeight->text());
 	settings.setValue("imageDepth", ui.lineEditImageDepth->text());
+	settings.setValue("deskewAngle", ui.lineEditDeskewAngle->text());
+	settings.setValue("scanStep", ui.lineEditScanStep->text());
 	settings.setValue("redChannel", ui.spinBoxRedChannel->value());
 	settings.setValue("greenChannel", ui.spinBoxGreenChannel->value());
 	settings.setValue("blueChannel", ui.spinBoxBlueChannel->value());
 	settings.setValue("redChannelEnabled", ui.checkBoxRedChannelEnabled->isChecked());
 	settings.setValue("greenChannelEnabled", ui.checkBoxGreenChannelEnabled->isChecked());
 	settings.setValue("blueChannelEnabled", ui.checkBoxBlueChannelEnabled->isChecked());
+	settings.setValue("textureFormat", ui.comboBoxTextureFormat->currentIndex());
 	settings.setValue("backgroundColor", backgroundColor);
 	settings.setValue("lineColor", lineColor);
 
@@ -135,6 +155,8 @@ void MainWindow::on_pushButtonLoadFromMetadata_clicked()
 	ui.lineEditImageWidth->setText(locale.toString(result.imageWidth, 'e', 6));
 	ui.lineEditImageHeight->setText(locale.toString(result.imageHeight, 'e', 6));
 	ui.lineEditImageDepth->setText(locale.toString(result.imageDepth, 'e', 6));
+	ui.lineEditDeskewAngle->setText(locale.toString(result.deskewAngle, 'f', 2));
+	ui.lineEditScanStep->setText(locale.toString(result.scanStep, 'e', 6));
 
 	this->setCursor(Qt::ArrowCursor);
 }
@@ -143,29 +165,18 @@ void MainWindow::on_pushButtonLoadWindowed_clicked()
 {
 	this->setCursor(Qt::WaitCursor);
 
-	QLocale locale(QLocale::English);
-
-	ImageLoaderInfo info;
-	info.fileName = ui.lineEditTiffImageFileName->text().toStdString();
-	info.channelCount = ui.spinBoxChannelCount->value();
-	info.imagesPerChannel = ui.spinBoxImagesPerChannel->value();
-	info.redChannelEnabled = ui.checkBoxRedChannelEnabled->isChecked();
-	info.greenChannelEnabled = ui.checkBoxGreenChannelEnabled->isChecked();
-	info.blueChannelEnabled = ui.checkBoxBlueChannelEnabled->isChecked();
-	info.redChannelIndex = ui.spinBoxRedChannel->value();
-	info.greenChannelIndex = ui.spinBoxGreenChannel->value();
-	info.blueChannelIndex = ui.spinBoxBlueChannel->value();
-
-	RenderWidgetSettings settings;
-	settings.imageLoaderInfo = info;
-	settings.backgroundColor = backgroundColor;
-	settings.lineColor = lineColor;
-	settings.imageWidth = locale.toFloat(ui.lineEditImageWidth->text());
-	settings.imageHeight = locale.toFloat(ui.lineEditImageHeight->text());
-	settings.imageDepth = locale.toFloat(ui.lineEditImageDepth->text());
+	RenderWidgetSettings settings = getRenderWidgetSettings();
 
-	ui.renderWidget->initialize(settings);
-	ui.renderWidget->setFocus();
+	if (softwareRenderWidget != nullptr)
+	{
+		softwareRenderWidget->initialize(settings);
+		softwareRenderWidget->setFocus();
+	}
+	else
+	{
+		ui.renderWidget->initialize(settings, nullptr, true);
+		ui.renderWidget->setFocus();
+	}
 
 	this->setCursor(Qt::ArrowCursor);
 }
@@ -175,13 +186,25 @@ void MainWindow::on_pushButtonLoadFullscreen_clicked()
 	this->setCursor(Qt::WaitCursor);
 
 	QDialog* dialog = new QDialog(this);
+	dialog->setAttribute(Qt::WA_DeleteOnClose);
 	QHBoxLayout* layout = new QHBoxLayout(dialog);
-	RenderWidget* renderWidget = new RenderWidget(dialog);
+	RenderWidget* renderWidget = nullptr;
+	SoftwareRenderWidget* fullscreenSoftwareRenderWidget = nullptr;
 
-	ui.renderWidget->hide();
+	if (softwareRenderWidget != nullptr)
+	{
+		fullscreenSoftwareRenderWidget = new SoftwareRenderWidget(dialog);
+		softwareRenderWidget->hide();
+		layout->addWidget(fullscreenSoftwareRenderWidget);
+	}
+	else
+	{
+		renderWidget = new RenderWidget(dialog);
+		ui.renderWidget->hide();
+		layout->addWidget(renderWidget);
+	}
 
 	layout->setContentsMargins(0, 0, 0, 0);
-	layout->addWidget(renderWidget);
 	dialog->setLayout(layout);
     dialog->resize(100, 100);
 	dialog->showFullScreen();
@@ -189,29 +212,18 @@ void MainWindow::on_pushButtonLoadFullscreen_clicked()
 	connect(dialog, SIGNAL(rejected()), this, SLOT(fullscreenDialogClosed()));
 	connect(dialog, SIGNAL(accepted()), this, SLOT(fullscreenDialogClosed()));
 
-	QLocale locale(QLocale::English);
-
-	ImageLoaderInfo info;
-	info.fileName = ui.lineEditTiffImageFileName->text().toStdString();
-	info.channelCount = ui.spinBoxChannelCount->value();
-	info.imagesPerChannel = ui.spinBoxImagesPerChannel->value();
-	info.redChannelEnabled = ui.checkBoxRedChannelEnabled->isChecked();
-	info.greenChannelEnabled = ui.checkBoxGreenChannelEnabled->isChecked();
-	info.blueChannelEnabled = ui.checkBoxBlueChannelEnabled->isChecked();
-	info.redChannelIndex = ui.spinBoxRedChannel->value();
-	info.greenChannelIndex = ui.spinBoxGreenChannel->value();
-	info.blueChannelIndex = ui.spinBoxBlueChannel->value();
-
-	RenderWidgetSettings settings;
-	settings.imageLoaderInfo = info;
-	settings.backgroundColor = backgroundColor;
-	settings.lineColor = lineColor;
-	settings.imageWidth = locale.toFloat(ui.lineEditImageWidth->text());
-	settings.imageHeight = locale.toFloat(ui.lineEditImageHeight->text());
-	settings.imageDepth = locale.toFloat(ui.lineEditImageDepth->text());
+	RenderWidgetSettings settings = getRenderWidgetSettings();
 
-	renderWidget->initialize(settings);
-	renderWidget->setFocus();
+	if (fullscreenSoftwareRenderWidget != nullptr)
+	{
+		fullscreenSoftwareRenderWidget->initialize(settings, softwareRenderWidget->getVolume());
+		fullscreenSoftwareRenderWidget->setFocus();
+	}
+	else
+	{
+		renderWidget->initialize(settings, ui.renderWidget->getVolume());
+		renderWidget->setFocus();
+	}
 
 	this->setCursor(Qt::ArrowCursor);
 }
@@ -225,6 +237,7 @@ void MainWindow::on_pushButtonPickBackgroundColor_clicked()
 	{
 		backgroundColor = color;
 		updateFrameColors();
+		updateRenderWidgetColors();
 	}
 }
 
@@ -237,9 +250,39 @@ void MainWindow::on_pushButtonPickLineColor_clicked()
 	{
 		lineColor = color;
 		updateFrameColors();
+		updateRenderWidgetColors();
 	}
 }
 
+RenderWidgetSettings MainWindow::getRenderWidgetSettings()
+{
+	QLocale locale(QLocale::English);
+
+	ImageLoaderInfo info;
+	info.fileName = ui.lineEditTiffImageFileName->text().toStdString();
+	info.channelCount = ui.spinBoxChannelCount->value();
+	info.imagesPerChannel = ui.spinBoxImagesPerChannel->value();
+	info.redChannelEnabled = ui.checkBoxRedChannelEnabled->isChecked();
+	info.greenChannelEnabled = ui.checkBoxGreenChannelEnabled->isChecked();
+	info.blueChannelEnabled = ui.checkBoxBlueChannelEnabled->isChecked();
+	info.redChannelIndex = ui.spinBoxRedChannel->value();
+	info.greenChannelIndex = ui.spinBoxGreenChannel->value();
+	info.blueChannelIndex = ui.spinBoxBlueChannel->value();
+
+	RenderWidgetSettings settings;
+	settings.imageLoaderInfo = info;
+	settings.backgroundColor = backgroundColor;
+	settings.lineColor = lineColor;
+	settings.imageWidth = locale.toFloat(ui.lineEditImageWidth->text());
+	settings.imageHeight = locale.toFloat(ui.lineEditImageHeight->text());
+	settings.imageDepth = locale.toFloat(ui.lineEditImageDepth->text());
+	settings.deskewAngle = locale.toFloat(ui.lineEditDeskewAngle->text());
+	settings.scanStep = locale.toFloat(ui.lineEditScanStep->text());
+	settings.textureFormat = TextureFormat(ui.comboBoxTextureFormat->currentIndex());
+
+	return settings;
+}
+
 void MainWindow::updateChannelSelectors()
 {
 	ui.spinBoxRedChannel->setEnabled(ui.checkBoxRedChannelEnabled->isChecked());
@@ -257,7 +300,35 @@ void MainWindow::updateFrameColors()
 	ui.frameLineColor->setStyleSheet(QString("background-color: rgb(%1, %2, %3, %4);").arg(QString::number(lineColor.red()), QString::number(lineColor.green()), QString::number(lineColor.blue()), QString::number(lineColor.alpha())));
 }
 
+void MainWindow::updateRenderWidgetColors()
+{
+	if (softwareRenderWidget != nullptr)
+	{
+		if (softwareRenderWidget->getVolume() == nullptr)
+			return;
+
+		RenderWidgetSettings settings = softwareRenderWidget->getSettings();
+		settings.backgroundColor = backgroundColor;
+		settings.lineColor = lineColor;
+
+		softwareRenderWidget->initialize(settings);
+		return;
+	}
+
+	if (!ui.renderWidget->isLoaded())
+		return;
+
+	RenderWidgetSettings settings = ui.renderWidget->getSettings();
+	settings.backgroundColor = backgroundColor;
+	settings.lineColor = lineColor;
+
+	ui.renderWidget->initialize(settings);
+}
+
 void MainWindow::fullscreenDialogClosed()
 {
-	ui.renderWidget->show();
+	if (softwareRenderWidget != nullptr)
+		softwareRenderWidget->show();
+	else
+		ui.renderWidget->show();
 }
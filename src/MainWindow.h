@@ -8,6 +8,7 @@
 namespace CellVision
 {
 	class Log;
+	class SoftwareRenderWidget;
 
 	class MainWindow : public QMainWindow
 	{
@@ -15,7 +16,7 @@ namespace CellVision
 
 	public:
 
-		explicit MainWindow(QWidget* parent = nullptr);
+		explicit MainWindow(bool useSoftwareRendering = false, QWidget* parent = nullptr);
 
 		static Log& getLog();
 
@@ -36,15 +37,21 @@ namespace CellVision
 
 		void updateChannelSelectors();
 		void updateFrameColors();
+		void updateRenderWidgetColors();
 		void fullscreenDialogClosed();
 
 	private:
 
+		RenderWidgetSettings getRenderWidgetSettings();
+
 		Ui::MainWindow ui;
 
 		QDoubleValidator doubleValueValidator;
 
 		QColor backgroundColor;
 		QColor lineColor;
+
+		// replaces ui.renderWidget when OpenGL 3.3 is not available
+		SoftwareRenderWidget* softwareRenderWidget = nullptr;
 	};
 }
@@ -63,3 +63,85 @@ QMatrix4x4 MathHelper::rotationMatrix(float angle, const QVector3D& axis)
 
 	return result;
 }
+
+QVector3D MathHelper::clamp(const QVector3D& vector, float minimum, float maximum)
+{
+	float x = std::max(minimum, std::min(maximum, vector.x()));
+	float y = std::max(minimum, std::min(maximum, vector.y()));
+	float z = std::max(minimum, std::min(maximum, vector.z()));
+
+	return QVector3D(x, y, z);
+}
+
+int MathHelper::intersectPlaneWithBox(std::array<QVector3D, 6>& planeVertexData, const QVector3D& planePosition, const QVector3D& planeNormal, const QVector3D& boxMinimum, const QVector3D& boxMaximum, const QVector3D& right, const QVector3D& up)
+{
+	const QVector3D corners[8] =
+	{
+		QVector3D(boxMinimum.x(), boxMinimum.y(), boxMinimum.z()),
+		QVector3D(boxMaximum.x(), boxMinimum.y(), boxMinimum.z()),
+		QVector3D(boxMinimum.x(), boxMaximum.y(), boxMinimum.z()),
+		QVector3D(boxMaximum.x(), boxMaximum.y(), boxMinimum.z()),
+		QVector3D(boxMinimum.x(), boxMinimum.y(), boxMaximum.z()),
+		QVector3D(boxMaximum.x(), boxMinimum.y(), boxMaximum.z()),
+		QVector3D(boxMinimum.x(), boxMaximum.y(), boxMaximum.z()),
+		QVector3D(boxMaximum.x(), boxMaximum.y(), boxMaximum.z())
+	};
+
+	const int edges[12][2] =
+	{
+		{ 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 },
+		{ 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 },
+		{ 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 }
+	};
+
+	// a plane cuts a box into a convex polygon of at most six vertices, one per crossed edge
+	int vertexCount = 0;
+
+	for (const auto& edge : edges)
+	{
+		QVector3D start = corners[edge[0]];
+		QVector3D end = corners[edge[1]];
+
+		float startDistance = QVector3D::dotProduct(start - planePosition, planeNormal);
+		float endDistance = QVector3D::dotProduct(end - planePosition, planeNormal);
+
+		if ((startDistance < 0.0f) == (endDistance < 0.0f) || startDistance == endDistance)
+			continue;
+
+		float t = startDistance / (startDistance - endDistance);
+		QVector3D vertex = start + t * (end - start);
+		bool isDuplicate = false;
+
+		for (int i = 0; i < vertexCount; ++i)
+		{
+			if ((planeVertexData[i] - vertex).lengthSquared() < 1.0e-12f)
+				isDuplicate = true;
+		}
+
+		if (!isDuplicate && vertexCount < 6)
+			planeVertexData[vertexCount++] = vertex;
+	}
+
+	if (vertexCount < 3)
+		return 0;
+
+	QVector3D center;
+
+	for (int i = 0; i < vertexCount; ++i)
+		center += planeVertexData[i];
+
+	center /= float(vertexCount);
+
+	std::sort(planeVertexData.begin(), planeVertexData.begin() + vertexCount, [&](const QVector3D& v1, const QVector3D& v2)
+	{
+		QVector3D d1 = v1 - center;
+		QVector3D d2 = v2 - center;
+
+		float angle1 = std::atan2(QVector3D::dotProduct(d1, up), QVector3D::dotProduct(d1, right));
+		float angle2 = std::atan2(QVector3D::dotProduct(d2, up), QVector3D::dotProduct(d2, right));
+
+		return angle1 < angle2;
+	});
+
+	return vertexCount;
+}
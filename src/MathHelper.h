@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include <array>
+
 #include <QMatrix4x4>
 
 namespace CellVision
@@ -13,5 +15,9 @@ namespace CellVision
 
 		static void orthonormalize(QMatrix4x4& matrix);
 		static QMatrix4x4 rotationMatrix(float angle, const QVector3D& axis);
+		static QVector3D clamp(const QVector3D& vector, float minimum, float maximum);
+
+		// returns the vertex count (zero or 3-6), the vertices are sorted by their angle around the center in the right/up basis
+		static int intersectPlaneWithBox(std::array<QVector3D, 6>& planeVertexData, const QVector3D& planePosition, const QVector3D& planeNormal, const QVector3D& boxMinimum, const QVector3D& boxMaximum, const QVector3D& right, const QVector3D& up);
 	};
 }
@@ -52,6 +52,10 @@ MetadataLoaderResult MetadataLoader::loadFromFile(const std::string& fileName)
 			ss >> part;
 			ss >> result.imageDepth;
 		}
+		else if (part == "DeskewAngle")
+			ss >> result.deskewAngle;
+		else if (part == "ScanStep")
+			ss >> result.scanStep;
 	}
 
 	return result;
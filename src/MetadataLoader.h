@@ -14,6 +14,8 @@ namespace CellVision
 		float imageWidth = 0.0f;
 		float imageHeight = 0.0f;
 		float imageDepth = 0.0f;
+		float deskewAngle = 0.0f;
+		float scanStep = 0.0f;
 	};
 
 	class MetadataLoader
@@ -0,0 +1,146 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#include "stdafx.h"
+
+#include "MipmapGenerator.h"
+#include "ParallelHelper.h"
+
+using namespace CellVision;
+
+std::vector<ImageLoaderResult> MipmapGenerator::generateMipmaps(const ImageLoaderResult& base, float spacingX, float spacingY, float spacingZ)
+{
+	std::vector<ImageLoaderResult> levels;
+	uint32_t levelCount = getMipLevelCount(base.width, base.height, base.depth);
+
+	if (levelCount <= 1 || base.data.empty())
+		return levels;
+
+	const ImageLoaderResult* source = &base;
+
+	for (uint32_t level = 1; level < levelCount; ++level)
+	{
+		levels.push_back(reduce(*source, spacingX, spacingY, spacingZ));
+
+		spacingX *= float(source->width) / float(levels.back().width);
+		spacingY *= float(source->height) / float(levels.back().height);
+		spacingZ *= float(source->depth) / float(levels.back().depth);
+
+		source = &levels.back();
+	}
+
+	return levels;
+}
+
+uint32_t MipmapGenerator::getMipLevelCount(uint32_t width, uint32_t height, uint32_t depth)
+{
+	uint32_t size = std::max(width, std::max(height, depth));
+	uint32_t levelCount = 1;
+
+	while (size > 1)
+	{
+		size /= 2;
+		levelCount++;
+	}
+
+	return levelCount;
+}
+
+ImageLoaderResult MipmapGenerator::reduce(const ImageLoaderResult& source, float spacingX, float spacingY, float spacingZ)
+{
+	ImageLoaderResult result;
+	result.width = std::max(1u, source.width / 2);
+	result.height = std::max(1u, source.height / 2);
+	result.depth = std::max(1u, source.depth / 2);
+	result.data.resize(uint64_t(result.width) * result.height * result.depth);
+
+	float targetSpacingX = spacingX * float(source.width) / float(result.width);
+	float targetSpacingY = spacingY * float(source.height) / float(result.height);
+	float targetSpacingZ = spacingZ * float(source.depth) / float(result.depth);
+
+	// OpenGL halves every axis per level, so with anisotropic voxels the coarse axes would be blurred much wider than
+	// the footprint that selects this level (which is driven by the finest axis). The box along each axis is therefore
+	// only as wide as the finest target spacing, clamped between one source voxel and one target voxel.
+	float footprint = std::min(targetSpacingX, std::min(targetSpacingY, targetSpacingZ));
+
+	float filterWidthX = std::max(spacingX, std::min(targetSpacingX, footprint)) / spacingX;
+	float filterWidthY = std::max(spacingY, std::min(targetSpacingY, footprint)) / spacingY;
+	float filterWidthZ = std::max(spacingZ, std::min(targetSpacingZ, footprint)) / spacingZ;
+
+	std::vector<std::vector<FilterTap>> tapsX = generateFilterTaps(source.width, result.width, filterWidthX);
+	std::vector<std::vector<FilterTap>> tapsY = generateFilterTaps(source.height, result.height, filterWidthY);
+	std::vector<std::vector<FilterTap>> tapsZ = generateFilterTaps(source.depth, result.depth, filterWidthZ);
+
+	uint64_t sourceSliceSize = uint64_t(source.width) * source.height;
+	uint64_t resultSliceSize = uint64_t(result.width) * result.height;
+
+	ParallelHelper::parallelFor(result.depth, [&](uint64_t z)
+	{
+		for (uint32_t y = 0; y < result.height; ++y)
+		{
+			for (uint32_t x = 0; x < result.width; ++x)
+			{
+				float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+				for (const FilterTap& tapZ : tapsZ[z])
+				{
+					for (const FilterTap& tapY : tapsY[y])
+					{
+						const uint32_t* sourceRow = &source.data[tapZ.index * sourceSliceSize + uint64_t(tapY.index) * source.width];
+						float weightZY = tapZ.weight * tapY.weight;
+
+						for (const FilterTap& tapX : tapsX[x])
+						{
+							uint32_t value = sourceRow[tapX.index];
+							float weight = weightZY * tapX.weight;
+
+							sum[0] += weight * float(value & 0xff);
+							sum[1] += weight * float((value >> 8) & 0xff);
+							sum[2] += weight * float((value >> 16) & 0xff);
+							sum[3] += weight * float((value >> 24) & 0xff);
+						}
+					}
+				}
+
+				uint32_t combined = 0;
+
+				for (uint32_t c = 0; c < 4; ++c)
+					combined |= uint32_t(std::min(255.0f, sum[c] + 0.5f)) << (c * 8);
+
+				result.data[z * resultSliceSize + uint64_t(y) * result.width + x] = combined;
+			}
+		}
+	});
+
+	return result;
+}
+
+std::vector<std::vector<MipmapGenerator::FilterTap>> MipmapGenerator::generateFilterTaps(uint32_t sourceSize, uint32_t targetSize, float filterWidth)
+{
+	std::vector<std::vector<FilterTap>> taps(targetSize);
+	float scale = float(sourceSize) / float(targetSize);
+
+	for (uint32_t i = 0; i < targetSize; ++i)
+	{
+		float center = (float(i) + 0.5f) * scale;
+		float start = std::max(0.0f, center - filterWidth / 2.0f);
+		float end = std::min(float(sourceSize), center + filterWidth / 2.0f);
+		float totalWeight = 0.0f;
+
+		for (uint32_t j = uint32_t(start); j < sourceSize && float(j) < end; ++j)
+		{
+			float overlap = std::min(end, float(j + 1)) - std::max(start, float(j));
+
+			if (overlap > 0.0f)
+			{
+				taps[i].push_back({ j, overlap });
+				totalWeight += overlap;
+			}
+		}
+
+		for (FilterTap& tap : taps[i])
+			tap.weight /= totalWeight;
+	}
+
+	return taps;
+}
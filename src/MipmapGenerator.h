@@ -0,0 +1,33 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "ImageLoader.h"
+
+namespace CellVision
+{
+	class MipmapGenerator
+	{
+	public:
+
+		// returns levels 1..n of the full mip chain, the base level is not copied
+		// spacing is the physical size of one voxel of the base level along each axis
+		static std::vector<ImageLoaderResult> generateMipmaps(const ImageLoaderResult& base, float spacingX, float spacingY, float spacingZ);
+		static uint32_t getMipLevelCount(uint32_t width, uint32_t height, uint32_t depth);
+
+	private:
+
+		struct FilterTap
+		{
+			uint32_t index;
+			float weight;
+		};
+
+		static ImageLoaderResult reduce(const ImageLoaderResult& source, float spacingX, float spacingY, float spacingZ);
+		static std::vector<std::vector<FilterTap>> generateFilterTaps(uint32_t sourceSize, uint32_t targetSize, float filterWidth);
+	};
+}
@@ -0,0 +1,135 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#include "stdafx.h"
+
+#include "OffscreenRenderer.h"
+#include "MainWindow.h"
+#include "Log.h"
+
+using namespace CellVision;
+
+OffscreenRenderer::~OffscreenRenderer()
+{
+	// the widget frees its GL objects with whatever context is current
+	if (context != nullptr && context->makeCurrent(&surface))
+	{
+		renderWidget.reset();
+		framebuffer.reset();
+		context->doneCurrent();
+	}
+}
+
+bool OffscreenRenderer::initialize(const RenderWidgetSettings& settings, const QSize& size)
+{
+	Log& log = MainWindow::getLog();
+
+	// the benchmark and the snapshots need the whole volume
+	if (settings.textureFormat == TextureFormat::STREAMED_SLICES)
+	{
+		log.logError("Streamed 2D slices can't be rendered offscreen, select another texture format in the dataset file");
+		return false;
+	}
+
+	context.reset(new QOpenGLContext());
+	context->setFormat(QSurfaceFormat::defaultFormat());
+
+	// software drivers like Mesa llvmpipe may only give 3.3 with the core profile
+	if (!context->create() || context->format().version() < qMakePair(3, 3))
+	{
+		QSurfaceFormat coreFormat = QSurfaceFormat::defaultFormat();
+		coreFormat.setProfile(QSurfaceFormat::CoreProfile);
+
+		context.reset(new QOpenGLContext());
+		context->setFormat(coreFormat);
+
+		if (!context->create() || context->format().version() < qMakePair(3, 3))
+		{
+			log.logError("Could not create an OpenGL 3.3 context");
+			return false;
+		}
+	}
+
+	log.logInfo("Offscreen OpenGL context: %d.%d", context->format().majorVersion(), context->format().minorVersion());
+
+	surface.setFormat(context->format());
+	surface.create();
+
+	if (!surface.isValid() || !context->makeCurrent(&surface))
+	{
+		log.logError("Could not create an offscreen surface");
+		return false;
+	}
+
+	QOpenGLFramebufferObjectFormat framebufferFormat;
+	framebufferFormat.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+	framebufferFormat.setSamples(QSurfaceFormat::defaultFormat().samples());
+
+	framebuffer.reset(new QOpenGLFramebufferObject(size, framebufferFormat));
+
+	if (!framebuffer->isValid())
+	{
+		log.logError("Could not create a %dx%d framebuffer", size.width(), size.height());
+		return false;
+	}
+
+	renderWidget.reset(new RenderWidget());
+	renderWidget->initialize(settings);
+	renderWidget->initializeOffscreen(framebuffer->handle(), size.width(), size.height());
+
+	if (renderWidget->getVolume() == nullptr)
+	{
+		log.logError("Could not load the volume");
+		return false;
+	}
+
+	return true;
+}
+
+void OffscreenRenderer::render(const CameraPose& pose)
+{
+	renderWidget->setCameraPose(pose);
+	renderWidget->renderOffscreen();
+}
+
+void OffscreenRenderer::finish()
+{
+	context->functions()->glFinish();
+}
+
+// multisampled framebuffers are resolved by the copy
+QImage OffscreenRenderer::getImage()
+{
+	return framebuffer->toImage();
+}
+
+bool OffscreenRenderer::loadSettingsFromFile(const QString& fileName, RenderWidgetSettings& settings)
+{
+	if (!QFileInfo(fileName).isFile())
+	{
+		MainWindow::getLog().logError("Could not find dataset file: %s", fileName.toStdString());
+		return false;
+	}
+
+	QSettings datasetSettings(fileName, QSettings::IniFormat);
+
+	settings.imageLoaderInfo.fileName = datasetSettings.value("tiffImageFileName", "").toString().toStdString();
+	settings.imageLoaderInfo.channelCount = datasetSettings.value("channelCount", 1).toInt();
+	settings.imageLoaderInfo.imagesPerChannel = datasetSettings.value("imagesPerChannel", 1).toInt();
+	settings.imageLoaderInfo.redChannelEnabled = datasetSettings.value("redChannelEnabled", false).toBool();
+	settings.imageLoaderInfo.greenChannelEnabled = datasetSettings.value("greenChannelEnabled", false).toBool();
+	settings.imageLoaderInfo.blueChannelEnabled = datasetSettings.value("blueChannelEnabled", false).toBool();
+	settings.imageLoaderInfo.redChannelIndex = datasetSettings.value("redChannel", 1).toInt();
+	settings.imageLoaderInfo.greenChannelIndex = datasetSettings.value("greenChannel", 1).toInt();
+	settings.imageLoaderInfo.blueChannelIndex = datasetSettings.value("blueChannel", 1).toInt();
+	settings.imageWidth = datasetSettings.value("imageWidth", 1.0).toFloat();
+	settings.imageHeight = datasetSettings.value("imageHeight", 1.0).toFloat();
+	settings.imageDepth = datasetSettings.value("imageDepth", 1.0).toFloat();
+	settings.deskewAngle = datasetSettings.value("deskewAngle", 0.0).toFloat();
+	settings.scanStep = datasetSettings.value("scanStep", 0.0).toFloat();
+	settings.textureFormat = TextureFormat(datasetSettings.value("textureFormat", 0).toInt());
+	settings.backgroundColor = datasetSettings.value("backgroundColor", QColor(100, 100, 100, 255)).value<QColor>();
+	settings.lineColor = datasetSettings.value("lineColor", QColor(255, 255, 255, 128)).value<QColor>();
+
+	return true;
+}
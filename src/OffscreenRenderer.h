@@ -0,0 +1,41 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#pragma once
+
+#include <memory>
+
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+
+#include "RenderWidget.h"
+#include "CameraPath.h"
+
+namespace CellVision
+{
+	// drives a never shown render widget with its own context and framebuffer, so nothing needs a window or a display
+	class OffscreenRenderer
+	{
+	public:
+
+		~OffscreenRenderer();
+
+		// loads the volume once, any number of frames can then be rendered from it
+		bool initialize(const RenderWidgetSettings& settings, const QSize& size);
+
+		void render(const CameraPose& pose);
+		void finish();
+		QImage getImage();
+
+		// same keys as the ones the main window stores in cellvision.ini
+		static bool loadSettingsFromFile(const QString& fileName, RenderWidgetSettings& settings);
+
+	private:
+
+		QOffscreenSurface surface;
+		std::unique_ptr<QOpenGLContext> context;
+		std::unique_ptr<QOpenGLFramebufferObject> framebuffer;
+		std::unique_ptr<RenderWidget> renderWidget;
+	};
+}
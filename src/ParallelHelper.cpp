@@ -0,0 +1,46 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#include "stdafx.h"
+
+#include <atomic>
+#include <thread>
+
+#include "ParallelHelper.h"
+
+using namespace CellVision;
+
+uint32_t ParallelHelper::getThreadCount()
+{
+	return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void ParallelHelper::parallelFor(uint64_t count, const std::function<void(uint64_t)>& function)
+{
+	uint64_t threadCount = std::min(uint64_t(getThreadCount()), count);
+
+	if (threadCount <= 1)
+	{
+		for (uint64_t i = 0; i < count; ++i)
+			function(i);
+
+		return;
+	}
+
+	// work items are handed out one at a time so that uneven items (e.g. slices cut by a plane) balance out
+	std::atomic<uint64_t> nextIndex(0);
+	std::vector<std::thread> threads;
+	threads.reserve(threadCount);
+
+	for (uint64_t t = 0; t < threadCount; ++t)
+	{
+		threads.emplace_back([&]()
+		{
+			for (uint64_t i = nextIndex++; i < count; i = nextIndex++)
+				function(i);
+		});
+	}
+
+	for (std::thread& thread : threads)
+		thread.join();
+}
@@ -0,0 +1,18 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+namespace CellVision
+{
+	class ParallelHelper
+	{
+	public:
+
+		static uint32_t getThreadCount();
+		static void parallelFor(uint64_t count, const std::function<void(uint64_t)>& function);
+	};
+}
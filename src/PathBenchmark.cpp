@@ -0,0 +1,102 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#include "stdafx.h"
+
+#include "PathBenchmark.h"
+#include "OffscreenRenderer.h"
+#include "CameraPath.h"
+#include "MainWindow.h"
+#include "Log.h"
+#include "SysUtils.h"
+
+using namespace CellVision;
+
+namespace
+{
+	float getPercentile(const std::vector<float>& sortedValues, float percentile)
+	{
+		size_t index = std::min(size_t(percentile / 100.0f * sortedValues.size()), sortedValues.size() - 1);
+		return sortedValues[index];
+	}
+}
+
+int PathBenchmark::run(const PathBenchmarkSettings& settings)
+{
+	Log& log = MainWindow::getLog();
+
+	RenderWidgetSettings renderWidgetSettings;
+	CameraPath cameraPath;
+
+	if (!OffscreenRenderer::loadSettingsFromFile(settings.datasetFileName, renderWidgetSettings) || !cameraPath.loadFromFile(settings.cameraPathFileName.toStdString()))
+		return -1;
+
+	OffscreenRenderer renderer;
+
+	if (!renderer.initialize(renderWidgetSettings, settings.frameSize))
+		return -1;
+
+	// the same frames are rendered on every run, whatever the speed of the machine
+	float startTime = cameraPath.getPoses().front().time;
+	int frameCount = int(std::floor(cameraPath.getDuration() / settings.timeStep)) + 1;
+
+	for (int i = 0; i < settings.warmupFrameCount; ++i)
+		renderer.render(cameraPath.getPose(startTime));
+
+	renderer.finish();
+
+	std::vector<float> frameTimes(frameCount);
+	QElapsedTimer totalTimer;
+	totalTimer.start();
+
+	// every frame is waited for, so the times include all the GPU work of the frame
+	for (int i = 0; i < frameCount; ++i)
+	{
+		QElapsedTimer frameTimer;
+		frameTimer.start();
+
+		renderer.render(cameraPath.getPose(startTime + i * settings.timeStep));
+		renderer.finish();
+
+		frameTimes[i] = frameTimer.nsecsElapsed() / 1000000.0f;
+	}
+
+	float totalTime = totalTimer.nsecsElapsed() / 1000000000.0f;
+
+	std::vector<float> sortedFrameTimes = frameTimes;
+	std::sort(sortedFrameTimes.begin(), sortedFrameTimes.end());
+
+	float meanFrameTime = 0.0f;
+
+	for (float frameTime : frameTimes)
+		meanFrameTime += frameTime / frameCount;
+
+	float framesPerSecond = frameCount / totalTime;
+	float megapixelsPerSecond = framesPerSecond * settings.frameSize.width() * settings.frameSize.height() / 1000000.0f;
+	float peakMemory = SysUtils::getPeakMemoryUsage() / (1024.0f * 1024.0f);
+
+	log.logInfo("Benchmark: %d frames at %dx%d, %.3f s of path in %.3f s", frameCount, settings.frameSize.width(), settings.frameSize.height(), cameraPath.getDuration(), totalTime);
+	log.logInfo("Frame time (ms): min %.2f | mean %.2f | p50 %.2f | p95 %.2f | p99 %.2f | max %.2f", sortedFrameTimes.front(), meanFrameTime, getPercentile(sortedFrameTimes, 50.0f), getPercentile(sortedFrameTimes, 95.0f), getPercentile(sortedFrameTimes, 99.0f), sortedFrameTimes.back());
+	log.logInfo("Throughput: %.1f frames/s | %.1f Mpixels/s", framesPerSecond, megapixelsPerSecond);
+	log.logInfo("Peak memory: %.1f MB", peakMemory);
+
+	if (!settings.outputFileName.isEmpty())
+	{
+		std::ofstream file(settings.outputFileName.toStdString());
+
+		if (!file.good())
+		{
+			log.logError("Could not open benchmark output file: %s", settings.outputFileName.toStdString());
+			return -1;
+		}
+
+		file << "frame,time,frame_time_ms\n";
+
+		for (int i = 0; i < frameCount; ++i)
+			file << i << "," << (startTime + i * settings.timeStep) << "," << frameTimes[i] << "\n";
+
+		log.logInfo("Saved frame times to %s", settings.outputFileName.toStdString());
+	}
+
+	return 0;
+}
@@ -0,0 +1,29 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#pragma once
+
+#include <QString>
+#include <QSize>
+
+namespace CellVision
+{
+	struct PathBenchmarkSettings
+	{
+		QString datasetFileName;
+		QString cameraPathFileName;
+		QString outputFileName;
+		QSize frameSize = QSize(1920, 1080);
+		float timeStep = 1.0f / 60.0f;
+		int warmupFrameCount = 10;
+	};
+
+	// replays a recorded camera path at fixed time steps offscreen and reports how long the frames took
+	class PathBenchmark
+	{
+	public:
+
+		// returns the process exit code
+		static int run(const PathBenchmarkSettings& settings);
+	};
+}
@@ -0,0 +1,215 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#include "stdafx.h"
+
+#include "ProgramBinaryCache.h"
+#include "MainWindow.h"
+#include "Log.h"
+
+using namespace CellVision;
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+namespace
+{
+	// core since 4.1, so they are resolved at runtime instead of through the 3.3 functions
+	typedef void (QOPENGLF_APIENTRYP GetProgramBinaryFunction)(GLuint program, GLsizei bufferSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+	typedef void (QOPENGLF_APIENTRYP ProgramBinaryFunction)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+	typedef void (QOPENGLF_APIENTRYP ProgramParameteriFunction)(GLuint program, GLenum name, GLint value);
+}
+
+bool ProgramBinaryCache::link(QOpenGLShaderProgram& program, const QByteArray& vertexShaderSource, const std::vector<QByteArray>& fragmentShaderSources)
+{
+	QString fileName;
+
+	if (isSupported())
+	{
+		fileName = getFileName(vertexShaderSource, fragmentShaderSources);
+
+		if (loadBinary(program, fileName))
+		{
+			++loadedCount;
+			return true;
+		}
+	}
+
+	bool linked = program.addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShaderSource);
+
+	for (const QByteArray& source : fragmentShaderSources)
+		linked = linked && program.addShaderFromSourceCode(QOpenGLShader::Fragment, source);
+
+	if (supported)
+	{
+		ProgramParameteriFunction programParameteri = reinterpret_cast<ProgramParameteriFunction>(QOpenGLContext::currentContext()->getProcAddress("glProgramParameteri"));
+		programParameteri(program.programId(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+
+	linked = linked && program.link();
+	++compiledCount;
+
+	if (linked && supported)
+		saveBinary(program, fileName);
+
+	return linked;
+}
+
+bool ProgramBinaryCache::linkFiles(QOpenGLShaderProgram& program, const std::string& vertexShaderFileName, const std::vector<std::string>& fragmentShaderFileNames)
+{
+	std::vector<QByteArray> fragmentShaderSources;
+
+	for (const std::string& fileName : fragmentShaderFileNames)
+		fragmentShaderSources.push_back(readSource(fileName));
+
+	return link(program, readSource(vertexShaderFileName), fragmentShaderSources);
+}
+
+int ProgramBinaryCache::getLoadedCount() const
+{
+	return loadedCount;
+}
+
+int ProgramBinaryCache::getCompiledCount() const
+{
+	return compiledCount;
+}
+
+QByteArray ProgramBinaryCache::readSource(const std::string& fileName)
+{
+	QFile file(QString::fromStdString(fileName));
+
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		MainWindow::getLog().logWarning("Could not open shader file: %s", fileName);
+		return QByteArray();
+	}
+
+	return file.readAll();
+}
+
+// some drivers expose the functions but no formats, in which case nothing could ever be loaded
+bool ProgramBinaryCache::isSupported()
+{
+	if (supportChecked)
+		return supported;
+
+	supportChecked = true;
+
+	QOpenGLContext* context = QOpenGLContext::currentContext();
+	QSurfaceFormat format = context->format();
+
+	if (format.version() < qMakePair(4, 1) && !context->hasExtension("GL_ARB_get_program_binary"))
+		return false;
+
+	GLint formatCount = 0;
+	context->functions()->glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+
+	if (formatCount <= 0)
+		return false;
+
+	// the application directory is often not writable once installed
+	QString cacheLocation = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+
+	if (cacheLocation.isEmpty())
+	{
+		MainWindow::getLog().logWarning("Could not find a cache location for the shader cache");
+		return false;
+	}
+
+	directory = cacheLocation + "/shadercache";
+
+	if (!QDir().mkpath(directory))
+	{
+		MainWindow::getLog().logWarning("Could not create shader cache directory: %s", directory.toStdString());
+		return false;
+	}
+
+	supported = true;
+
+	return true;
+}
+
+// a driver update or any change to the sources gives a different file
+QString ProgramBinaryCache::getFileName(const QByteArray& vertexShaderSource, const std::vector<QByteArray>& fragmentShaderSources) const
+{
+	QOpenGLFunctions* functions = QOpenGLContext::currentContext()->functions();
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+
+	hash.addData(QByteArray(reinterpret_cast<const char*>(functions->glGetString(GL_VENDOR))));
+	hash.addData(QByteArray(reinterpret_cast<const char*>(functions->glGetString(GL_RENDERER))));
+	hash.addData(QByteArray(reinterpret_cast<const char*>(functions->glGetString(GL_VERSION))));
+	hash.addData(vertexShaderSource);
+
+	for (const QByteArray& source : fragmentShaderSources)
+		hash.addData(source);
+
+	return QString("%1/%2.bin").arg(directory, QString(hash.result().toHex()));
+}
+
+bool ProgramBinaryCache::loadBinary(QOpenGLShaderProgram& program, const QString& fileName)
+{
+	QFile file(fileName);
+
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+
+	QByteArray data = file.readAll();
+	file.close();
+
+	// the binary format comes first
+	if (data.size() <= int(sizeof(GLenum)))
+		return false;
+
+	GLenum binaryFormat;
+	memcpy(&binaryFormat, data.constData(), sizeof(GLenum));
+
+	ProgramBinaryFunction programBinary = reinterpret_cast<ProgramBinaryFunction>(QOpenGLContext::currentContext()->getProcAddress("glProgramBinary"));
+
+	program.create();
+	programBinary(program.programId(), binaryFormat, data.constData() + sizeof(GLenum), GLsizei(data.size() - sizeof(GLenum)));
+
+	// without any shaders added, link only checks the status that the binary left
+	if (program.link())
+		return true;
+
+	MainWindow::getLog().logWarning("Shader cache binary was rejected by the driver, compiling instead: %s", fileName.toStdString());
+	QFile::remove(fileName);
+
+	return false;
+}
+
+void ProgramBinaryCache::saveBinary(QOpenGLShaderProgram& program, const QString& fileName)
+{
+	QOpenGLFunctions* functions = QOpenGLContext::currentContext()->functions();
+	GetProgramBinaryFunction getProgramBinary = reinterpret_cast<GetProgramBinaryFunction>(QOpenGLContext::currentContext()->getProcAddress("glGetProgramBinary"));
+
+	GLint binaryLength = 0;
+	functions->glGetProgramiv(program.programId(), GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+
+	if (binaryLength <= 0)
+		return;
+
+	QByteArray data(int(sizeof(GLenum)) + binaryLength, 0);
+	GLenum binaryFormat = 0;
+	GLsizei writtenLength = 0;
+
+	getProgramBinary(program.programId(), binaryLength, &writtenLength, &binaryFormat, data.data() + sizeof(GLenum));
+	memcpy(data.data(), &binaryFormat, sizeof(GLenum));
+	data.resize(int(sizeof(GLenum)) + writtenLength);
+
+	// another widget may be writing the same program at the same time
+	QSaveFile file(fileName);
+
+	if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit())
+		MainWindow::getLog().logWarning("Could not write shader cache file: %s", fileName.toStdString());
+}
@@ -0,0 +1,42 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <QByteArray>
+#include <QOpenGLShaderProgram>
+
+namespace CellVision
+{
+	// linked programs are saved with glGetProgramBinary and loaded back instead of compiling the same sources again
+	// the files are keyed by the driver and the sources, a binary that the driver rejects is deleted and the program is compiled
+	// needs a current context, without program binary support everything is simply compiled
+	class ProgramBinaryCache
+	{
+	public:
+
+		bool link(QOpenGLShaderProgram& program, const QByteArray& vertexShaderSource, const std::vector<QByteArray>& fragmentShaderSources);
+		bool linkFiles(QOpenGLShaderProgram& program, const std::string& vertexShaderFileName, const std::vector<std::string>& fragmentShaderFileNames);
+
+		int getLoadedCount() const;
+		int getCompiledCount() const;
+
+		static QByteArray readSource(const std::string& fileName);
+
+	private:
+
+		bool isSupported();
+		QString getFileName(const QByteArray& vertexShaderSource, const std::vector<QByteArray>& fragmentShaderSources) const;
+		bool loadBinary(QOpenGLShaderProgram& program, const QString& fileName);
+		void saveBinary(QOpenGLShaderProgram& program, const QString& fileName);
+
+		QString directory;
+		int loadedCount = 0;
+		int compiledCount = 0;
+		bool supportChecked = false;
+		bool supported = false;
+	};
+}
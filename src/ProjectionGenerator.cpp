@@ -0,0 +1,157 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#include "stdafx.h"
+
+#include "ProjectionGenerator.h"
+#include "ParallelHelper.h"
+
+using namespace CellVision;
+
+ProjectionImage ProjectionGenerator::generateProjection(const ImageLoaderResult& volume, ProjectionAxis axis, ProjectionType type, uint32_t channel)
+{
+	uint64_t sliceSize = uint64_t(volume.width) * volume.height;
+	uint32_t shift = channel * 8;
+
+	return project(volume.width, volume.height, volume.depth, axis, type, [&](uint32_t y, uint32_t z, float* row)
+	{
+		const uint32_t* source = &volume.data[z * sliceSize + uint64_t(y) * volume.width];
+
+		for (uint32_t x = 0; x < volume.width; ++x)
+			row[x] = float((source[x] >> shift) & 0xff) * (1.0f / 255.0f);
+	});
+}
+
+ProjectionImage ProjectionGenerator::generateProjection(const ImageLoaderResult16& volume, ProjectionAxis axis, ProjectionType type, uint32_t channel)
+{
+	uint64_t sliceSize = uint64_t(volume.width) * volume.height;
+	const std::vector<uint16_t>& channelData = volume.channelData[channel];
+
+	return project(volume.width, volume.height, volume.depth, axis, type, [&](uint32_t y, uint32_t z, float* row)
+	{
+		if (channelData.empty())
+		{
+			std::fill(row, row + volume.width, 0.0f);
+			return;
+		}
+
+		const uint16_t* source = &channelData[z * sliceSize + uint64_t(y) * volume.width];
+
+		for (uint32_t x = 0; x < volume.width; ++x)
+			row[x] = float(source[x]) * (1.0f / 65535.0f);
+	});
+}
+
+void ProjectionGenerator::getProjectionSize(uint32_t width, uint32_t height, uint32_t depth, ProjectionAxis axis, uint32_t& projectionWidth, uint32_t& projectionHeight)
+{
+	projectionWidth = (axis == ProjectionAxis::X) ? height : width;
+	projectionHeight = (axis == ProjectionAxis::Z) ? height : depth;
+}
+
+// every work item owns whole output rows, and every volume row is read once as a contiguous run of x
+// the inner loops are plain elementwise float operations so that the compiler can vectorize them
+ProjectionImage ProjectionGenerator::project(uint32_t width, uint32_t height, uint32_t depth, ProjectionAxis axis, ProjectionType type, const RowReader& readRow)
+{
+	ProjectionImage result;
+	getProjectionSize(width, height, depth, axis, result.width, result.height);
+	result.data.resize(uint64_t(result.width) * result.height);
+
+	if (axis == ProjectionAxis::VIEW || result.data.empty())
+		return result;
+
+	uint32_t rayLength = (axis == ProjectionAxis::X) ? width : ((axis == ProjectionAxis::Y) ? height : depth);
+
+	ParallelHelper::parallelFor(result.height, [&](uint64_t outputRow)
+	{
+		std::vector<float> row(width);
+		float* output = &result.data[outputRow * result.width];
+
+		if (axis == ProjectionAxis::Z)
+		{
+			uint32_t y = uint32_t(outputRow);
+			readRow(y, 0, output);
+
+			for (uint32_t z = 1; z < depth; ++z)
+			{
+				readRow(y, z, &row[0]);
+				combineRows(output, &row[0], width, type);
+			}
+		}
+		else if (axis == ProjectionAxis::Y)
+		{
+			uint32_t z = uint32_t(outputRow);
+			readRow(0, z, output);
+
+			for (uint32_t y = 1; y < height; ++y)
+			{
+				readRow(y, z, &row[0]);
+				combineRows(output, &row[0], width, type);
+			}
+		}
+		else
+		{
+			uint32_t z = uint32_t(outputRow);
+
+			for (uint32_t y = 0; y < height; ++y)
+			{
+				readRow(y, z, &row[0]);
+				output[y] = reduceRow(&row[0], width, type);
+			}
+		}
+
+		if (type == ProjectionType::MEAN && axis != ProjectionAxis::X)
+		{
+			for (uint32_t i = 0; i < result.width; ++i)
+				output[i] /= float(rayLength);
+		}
+	});
+
+	return result;
+}
+
+void ProjectionGenerator::combineRows(float* result, const float* row, uint32_t count, ProjectionType type)
+{
+	if (type == ProjectionType::MAXIMUM)
+	{
+		for (uint32_t i = 0; i < count; ++i)
+			result[i] = (row[i] > result[i]) ? row[i] : result[i];
+	}
+	else if (type == ProjectionType::MINIMUM)
+	{
+		for (uint32_t i = 0; i < count; ++i)
+			result[i] = (row[i] < result[i]) ? row[i] : result[i];
+	}
+	else
+	{
+		for (uint32_t i = 0; i < count; ++i)
+			result[i] += row[i];
+	}
+}
+
+float ProjectionGenerator::reduceRow(const float* row, uint32_t count, ProjectionType type)
+{
+	float result = row[0];
+
+	if (type == ProjectionType::MAXIMUM)
+	{
+		for (uint32_t i = 1; i < count; ++i)
+			result = (row[i] > result) ? row[i] : result;
+	}
+	else if (type == ProjectionType::MINIMUM)
+	{
+		for (uint32_t i = 1; i < count; ++i)
+			result = (row[i] < result) ? row[i] : result;
+	}
+	else
+	{
+		// sums of whole rows are accumulated in double so that long rays don't lose the small values
+		double sum = 0.0;
+
+		for (uint32_t i = 0; i < count; ++i)
+			sum += row[i];
+
+		result = float((type == ProjectionType::MEAN) ? sum / count : sum);
+	}
+
+	return result;
+}
@@ -0,0 +1,45 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "ImageLoader.h"
+
+namespace CellVision
+{
+	enum class ProjectionType { MAXIMUM, MINIMUM, MEAN, SUM };
+	enum class ProjectionAxis { VIEW, X, Y, Z };
+
+	// one channel of a projection, rows are stored bottom-up like the volumes
+	// x projections are (y, z) images, y projections are (x, z) images and z projections are (x, y) images
+	struct ProjectionImage
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		std::vector<float> data;
+	};
+
+	class ProjectionGenerator
+	{
+	public:
+
+		// exact projections of one channel along a volume axis, values are normalized to [0, 1] per voxel
+		// sums are not normalized by the ray length, so they are in units of fully bright voxels
+		static ProjectionImage generateProjection(const ImageLoaderResult& volume, ProjectionAxis axis, ProjectionType type, uint32_t channel);
+		static ProjectionImage generateProjection(const ImageLoaderResult16& volume, ProjectionAxis axis, ProjectionType type, uint32_t channel);
+
+		static void getProjectionSize(uint32_t width, uint32_t height, uint32_t depth, ProjectionAxis axis, uint32_t& projectionWidth, uint32_t& projectionHeight);
+
+	private:
+
+		typedef std::function<void(uint32_t y, uint32_t z, float* row)> RowReader;
+
+		static ProjectionImage project(uint32_t width, uint32_t height, uint32_t depth, ProjectionAxis axis, ProjectionType type, const RowReader& readRow);
+		static void combineRows(float* result, const float* row, uint32_t count, ProjectionType type);
+		static float reduceRow(const float* row, uint32_t count, ProjectionType type);
+	};
+}
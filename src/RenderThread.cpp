@@ -0,0 +1,70 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#include "stdafx.h"
+
+#include "RenderThread.h"
+
+using namespace CellVision;
+
+bool InputQueue::push(const InputEvent& event)
+{
+	size_t write = writeIndex.load(std::memory_order_relaxed);
+	size_t nextWrite = (write + 1) % CAPACITY;
+
+	if (nextWrite == readIndex.load(std::memory_order_acquire))
+		return false;
+
+	events[write] = event;
+	writeIndex.store(nextWrite, std::memory_order_release);
+
+	return true;
+}
+
+bool InputQueue::pop(InputEvent& event)
+{
+	size_t read = readIndex.load(std::memory_order_relaxed);
+
+	if (read == writeIndex.load(std::memory_order_acquire))
+		return false;
+
+	event = events[read];
+	readIndex.store((read + 1) % CAPACITY, std::memory_order_release);
+
+	return true;
+}
+
+int FrameExchange::getBackIndex() const
+{
+	return backIndex;
+}
+
+// the finished back frame becomes the middle one, and the old middle frame (shown or not) is written next
+void FrameExchange::publish()
+{
+	backIndex = middleIndex.exchange(backIndex | FRESH_BIT, std::memory_order_acq_rel) & ~FRESH_BIT;
+}
+
+bool FrameExchange::acquire()
+{
+	if ((middleIndex.load(std::memory_order_relaxed) & FRESH_BIT) == 0)
+		return false;
+
+	frontIndex = middleIndex.exchange(frontIndex, std::memory_order_acq_rel) & ~FRESH_BIT;
+
+	return true;
+}
+
+int FrameExchange::getFrontIndex() const
+{
+	return frontIndex;
+}
+
+RenderThread::RenderThread(const std::function<void()>& function_) : function(function_)
+{
+}
+
+void RenderThread::run()
+{
+	function();
+}
@@ -0,0 +1,84 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <functional>
+
+#include <QThread>
+#include <QEvent>
+#include <QPoint>
+#include <QPointF>
+
+namespace CellVision
+{
+	// the parts of the key, mouse and wheel events that the render thread needs
+	struct InputEvent
+	{
+		QEvent::Type type = QEvent::None;
+		int key = 0;
+		bool isAutoRepeat = false;
+		Qt::MouseButtons buttons = Qt::NoButton;
+		QPoint globalPosition;
+		QPointF localPosition;
+		QPoint angleDelta;
+	};
+
+	// single producer (the GUI thread) and single consumer (the render thread), neither side ever blocks
+	class InputQueue
+	{
+	public:
+
+		// returns false if the queue is full, the event is then dropped
+		bool push(const InputEvent& event);
+		bool pop(InputEvent& event);
+
+	private:
+
+		static const size_t CAPACITY = 1024;
+
+		std::array<InputEvent, CAPACITY> events;
+		std::atomic<size_t> readIndex{ 0 };
+		std::atomic<size_t> writeIndex{ 0 };
+	};
+
+	// triple buffered frame indices, the render thread writes the back frame and the GUI thread shows the front frame
+	// the third one is the latest finished frame, the indices are swapped with a single atomic exchange on either side
+	class FrameExchange
+	{
+	public:
+
+		// render thread
+		int getBackIndex() const;
+		void publish();
+
+		// GUI thread, returns true if a newer frame became the front frame
+		bool acquire();
+		int getFrontIndex() const;
+
+	private:
+
+		static const int FRESH_BIT = 4;
+
+		std::atomic<int> middleIndex{ 2 };
+		int backIndex = 0;
+		int frontIndex = 1;
+	};
+
+	class RenderThread : public QThread
+	{
+	public:
+
+		explicit RenderThread(const std::function<void()>& function);
+
+	protected:
+
+		void run() override;
+
+	private:
+
+		std::function<void()> function;
+	};
+}
@@ -8,822 +8,3062 @@
 #include "Log.h"
 #include "ImageLoader.h"
 #include "MathHelper.h"
+#include "MacrocellGenerator.h"
+#include "ImageSaver.h"
 
 using namespace CellVision;
 
-RenderWidget::RenderWidget(QWidget* parent) : QOpenGLWidget(parent), volumeTexture(QOpenGLTexture::Target3D), textTexture(QOpenGLTexture::Target2D)
+namespace
+{
+	// two triangles over the whole viewport with their texcoords
+	const float screenQuadVertexData[] =
+	{
+		-1.0f, -1.0f, 0.0f, 0.0f,
+		1.0f, -1.0f, 1.0f, 0.0f,
+		1.0f, 1.0f, 1.0f, 1.0f,
+
+		-1.0f, -1.0f, 0.0f, 0.0f,
+		1.0f, 1.0f, 1.0f, 1.0f,
+		-1.0f, 1.0f, 0.0f, 1.0f
+	};
+
+	QVector3D getAxisVector(int axis)
+	{
+		QVector3D result;
+		result[axis] = 1.0f;
+		return result;
+	}
+
+	// the per-instance attributes of plane.vert, the six polygon vertices are at consecutive locations
+	struct PlaneInstance
+	{
+		QVector3D vertices[6];
+		QVector3D slabNormal;
+		float slabSampleCount;
+	};
+
+	const GLuint PLANE_POLYGON_LOCATION = 0;
+	const GLuint PLANE_SLAB_LOCATION = 6;
+
+	float halton(int index, int base)
+	{
+		float result = 0.0f;
+		float fraction = 1.0f / base;
+
+		for (; index > 0; index /= base, fraction /= base)
+			result += fraction * (index % base);
+
+		return result;
+	}
+}
+
+RenderWidget::RenderWidget(QWidget* parent) : QOpenGLWidget(parent), textTexture(QOpenGLTexture::Target2D), projectionTexture(QOpenGLTexture::Target2D)
 {
 	connect(this, SIGNAL(frameSwapped()), this, SLOT(update()));
 
+	planeLinesVertexCounts.fill(0);
+	streamedSliceIndices.fill(-1);
 	setFocus();
 }
 
 RenderWidget::~RenderWidget()
 {
-	QSettings settings("cellvision.ini", QSettings::IniFormat);
+	// the render thread releases everything it created with its own context before it exits
+	if (renderThread != nullptr)
+	{
+		renderThreadExiting = true;
+		renderThread->wait();
+	}
+
+	// the speeds are loaded in initializeGL, a widget that never got a context (software rendering) has nothing to save
+	if (timeStepTimer.isValid())
+		camera.saveSpeeds();
+
+	// the last widget referencing the volume frees its textures, which needs a context from the shared group
+	makeCurrent();
 
-	settings.setValue("moveSpeedModifier", double(moveSpeedModifier));
-	settings.setValue("mouseMoveSpeedModifier", double(mouseMoveSpeedModifier));
-	settings.setValue("mouseRotateSpeedModifier", double(mouseRotateSpeedModifier));
-	settings.setValue("mouseWheelStepSizeModifier", double(mouseWheelStepSizeModifier));
+	if (renderThread == nullptr)
+		releaseScene();
+
+	requestedVolume.reset();
+	publishedVolume.reset();
+	present.vao.destroy();
+	present.vbo.destroy();
+	doneCurrent();
+
+	renderThread.reset();
+	renderContext.reset();
+	renderSurface.reset();
 }
 
-void RenderWidget::initialize(const RenderWidgetSettings& settings_)
+void RenderWidget::initialize(const RenderWidgetSettings& settings_, const std::shared_ptr<VolumeResource>& sharedVolume, bool forceReload_)
 {
-	settings = settings_;
+	// the render thread picks the request up at the start of its next frame
+	{
+		std::lock_guard<std::mutex> lock(settingsMutex);
+		requestedSettings = settings_;
 
-	ImageLoaderResult result = ImageLoader::loadFromMultipageTiff(settings.imageLoaderInfo);
+		if (renderThread != nullptr)
+		{
+			requestedVolume = sharedVolume;
+			requestedForceReload = requestedForceReload || forceReload_;
+			hasRequestedSettings = true;
+			return;
+		}
+	}
+
+	// colors are read every frame, so only image and size changes need any GL work
+	settings = settings_;
+	pendingVolume = sharedVolume;
+	forceReload = forceReload || forceReload_;
 
-	if (result.data.size() > 0)
+	if (!volumeChanged() && !sizeChanged())
 	{
-		volumeTexture.destroy();
-		volumeTexture.create();
-		volumeTexture.bind();
-		volumeTexture.setFormat(QOpenGLTexture::RGBA8_UNorm);
-		volumeTexture.setMinMagFilters(QOpenGLTexture::Linear, QOpenGLTexture::Linear);
-		volumeTexture.setWrapMode(QOpenGLTexture::ClampToBorder);
-		volumeTexture.setBorderColor(0.0f, 0.0f, 0.0f, 1.0f);
-		volumeTexture.setMipLevels(1);
-		volumeTexture.setSize(result.width, result.height, result.depth);
-		volumeTexture.allocateStorage();
-		volumeTexture.setData(QOpenGLTexture::RGBA, QOpenGLTexture::UInt8, &result.data[0]);
-		volumeTexture.release();
+		pendingVolume.reset();
+		return;
 	}
 
-	std::array<QVector3D, 72> cubeVertexData;
-	std::array<QVector3D, 24> cubeLinesVertexData;
-	generateCubeVertices(cubeVertexData, cubeLinesVertexData, settings.imageWidth, settings.imageHeight, settings.imageDepth);
-
-	cube.vbo.bind();
-	cube.vbo.write(0, cubeLinesVertexData.data(), sizeof(cubeLinesVertexData));
-	cube.vbo.release();
+	// the widget may not have a context yet if it was just created, the rest is then done at the end of initializeGL
+	if (!isValid())
+	{
+		hasPendingInitialize = true;
+		return;
+	}
 
-	std::array<float, 30> backgroundVertexData;
-	generateBackgroundVertices(backgroundVertexData, settings.backgroundColor);
+	makeCurrent();
+	applySettings();
+	doneCurrent();
+}
 
-	background.vbo.bind();
-	background.vbo.write(0, backgroundVertexData.data(), sizeof(backgroundVertexData));
-	background.vbo.release();
+// renders into the given framebuffer with the context that is current, without the widget ever being shown
+void RenderWidget::initializeOffscreen(GLuint framebuffer, int width, int height)
+{
+	targetFramebuffer = framebuffer;
+	isOffscreen = true;
+	renderText = false;
 
-	resetCameraPosition();
-	loadCameraSpeeds();
+	resize(width, height);
+	initializeGL();
+	resizeGL(width, height);
 }
 
-bool RenderWidget::event(QEvent* e)
+void RenderWidget::renderOffscreen()
 {
-	keyboardHelper.event(e);
+	glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+	glViewport(0, 0, frameSize.width(), frameSize.height());
 
-	if (e->type() == QEvent::KeyPress || e->type() == QEvent::KeyRelease)
-	{
-		QKeyEvent* ke = static_cast<QKeyEvent*>(e);
+	renderFrame();
+}
 
-		if (ke->key() == Qt::Key_Space)
-			setMouseMode();
-	}
+CameraPose RenderWidget::getCameraPose() const
+{
+	CameraPose pose;
+	pose.position = camera.position;
+	pose.orientation = QQuaternion::fromRotationMatrix(camera.orientationMatrix.toGenericMatrix<3, 3>());
+	pose.planeDistance = camera.planeDistance;
 
-	return QOpenGLWidget::event(e);
+	return pose;
 }
 
-void RenderWidget::mousePressEvent(QMouseEvent* me)
+void RenderWidget::setCameraPose(const CameraPose& pose)
 {
-	setFocus();
-
-	mouseButtons = me->buttons();
-	setMouseMode();
+	camera.position = pose.position;
+	camera.orientationMatrix.setToIdentity();
+	camera.orientationMatrix.rotate(pose.orientation);
+	camera.orientationInvMatrix = camera.orientationMatrix.inverted();
+	camera.planeDistance = pose.planeDistance;
+}
 
-	previousMousePosition = me->globalPos();
-	
-	if (mouseMode == MouseMode::ORBIT)
-		orbitPointWorld = getPlaneIntersection(me->localPos());
-	else if (mouseMode == MouseMode::MEASURE)
-		measureStartPoint = measureEndPoint = getPlaneIntersection(me->localPos());
+// only the GUI thread writes the requested settings, so they can be read here without the lock
+const RenderWidgetSettings& RenderWidget::getSettings() const
+{
+	return requestedSettings;
+}
 
-	me->accept();
+std::shared_ptr<VolumeResource> RenderWidget::getVolume() const
+{
+	std::lock_guard<std::mutex> lock(settingsMutex);
+	return publishedVolume;
 }
 
-void RenderWidget::mouseReleaseEvent(QMouseEvent* me)
+// streamed images have no volume, but they are still loaded
+bool RenderWidget::isLoaded() const
 {
-	mouseButtons = me->buttons();
-	setMouseMode();
-	me->accept();
+	std::lock_guard<std::mutex> lock(settingsMutex);
+	return publishedVolume != nullptr || publishedSliceStreaming;
 }
 
-void RenderWidget::mouseMoveEvent(QMouseEvent* me)
+void RenderWidget::applyRequestedSettings()
 {
-	QPoint mouseDelta = me->globalPos() - previousMousePosition;
-	previousMousePosition = me->globalPos();
+	if (!hasRequestedSettings.exchange(false))
+		return;
 
-	float yawAmount = -mouseDelta.x() * mouseRotateSpeedModifier;
-	float pitchAmount = -mouseDelta.y() * mouseRotateSpeedModifier;
-	float moveSpeed = mouseMoveSpeedModifier;
-	
-	if (keyboardHelper.keyIsDown(Qt::Key_Shift))
-		moveSpeed *= 2.0f;
+	{
+		std::lock_guard<std::mutex> lock(settingsMutex);
+		settings = requestedSettings;
+		pendingVolume = requestedVolume;
+		forceReload = requestedForceReload;
+		requestedVolume.reset();
+		requestedForceReload = false;
+	}
 
-	if (keyboardHelper.keyIsDown(Qt::Key_Control))
-		moveSpeed *= 0.5f;
+	// colors can change without anything else, and a converged view would never show them
+	accumulationSampleCount = 0;
+	sliceViews.invalidate();
 
-	if (mouseMode == MouseMode::ROTATE)
+	if (volumeChanged() || sizeChanged())
+		applySettings();
+
+	pendingVolume.reset();
+}
+
+void RenderWidget::applySettings()
+{
+	hasPendingInitialize = false;
+	accumulationSampleCount = 0;
+
+	bool reloadVolume = volumeChanged();
+	bool resizeCube = sizeChanged();
+
+	if (reloadVolume && settings.textureFormat == TextureFormat::STREAMED_SLICES)
 	{
-		if (keyboardHelper.keyIsDown(Qt::Key_Space))
+		std::unique_ptr<SliceStreamer> newSliceStreamer(new SliceStreamer());
+
+		if (newSliceStreamer->open(settings.imageLoaderInfo, SLICE_PREFETCH_RADIUS))
 		{
-			QVector3D rollAxis = QVector3D(0, 0, 1);
-			QMatrix4x4 rollMatrix = MathHelper::rotationMatrix(yawAmount, rollAxis);
-			cameraOrientationMatrix = cameraOrientationMatrix * rollMatrix;
+			volume.reset();
+			releaseStreamedSlices();
+			sliceStreamer = std::move(newSliceStreamer);
 		}
+	}
+	else if (reloadVolume)
+	{
+		if (!forceReload && pendingVolume != nullptr && !pendingVolume->isCropped() && pendingVolume->isLoadedFrom(settings.imageLoaderInfo, settings.textureFormat, settings.imageWidth, settings.imageHeight, settings.imageDepth))
+			volume = pendingVolume;
 		else
 		{
-			QVector3D yawAxis = QVector3D(0, 1, 0);
-			QMatrix4x4 yawMatrix = MathHelper::rotationMatrix(yawAmount, yawAxis);
-			cameraOrientationMatrix = cameraOrientationMatrix * yawMatrix;
+			std::shared_ptr<VolumeResource> newVolume = std::make_shared<VolumeResource>();
 
-			QVector3D pitchAxis = QVector3D(1, 0, 0);
-			QMatrix4x4 pitchMatrix = MathHelper::rotationMatrix(pitchAmount, pitchAxis);
-			cameraOrientationMatrix = cameraOrientationMatrix * pitchMatrix;
+			if (newVolume->load(settings.imageLoaderInfo, settings.textureFormat, settings.imageWidth, settings.imageHeight, settings.imageDepth))
+				volume = newVolume;
 		}
-		
-		MathHelper::orthonormalize(cameraOrientationMatrix);
-		cameraOrientationInvMatrix = cameraOrientationMatrix.inverted();
+
+		if (volume != nullptr)
+			releaseStreamedSlices();
 	}
-	else if (mouseMode == MouseMode::ORBIT)
+
+	pendingVolume.reset();
+	forceReload = false;
+
+	if (resizeCube)
 	{
-		orbitPointCamera = viewMatrix * orbitPointWorld;
+		std::array<QVector3D, 72> cubeVertexData;
+		std::array<QVector3D, 24> cubeLinesVertexData;
+		generateCubeVertices(cubeVertexData, cubeLinesVertexData, settings.imageWidth, settings.imageHeight, settings.imageDepth, getDeskewShear());
+
+		cube.vbo.bind();
+		cube.vbo.write(0, cubeLinesVertexData.data(), sizeof(cubeLinesVertexData));
+		cube.vbo.release();
+	}
 
-		QVector3D yawAxis = QVector3D(0, 1, 0);
-		QMatrix4x4 yawMatrix = MathHelper::rotationMatrix(yawAmount, yawAxis);
-		cameraOrientationMatrix = cameraOrientationMatrix * yawMatrix;
+	if (reloadVolume || resizeCube)
+		resetCameraPosition();
 
-		QVector3D pitchAxis = QVector3D(1, 0, 0);
-		QMatrix4x4 pitchMatrix = MathHelper::rotationMatrix(pitchAmount, pitchAxis);
-		cameraOrientationMatrix = cameraOrientationMatrix * pitchMatrix;
+	if (reloadVolume)
+		camera.loadSpeeds();
 
-		MathHelper::orthonormalize(cameraOrientationMatrix);
-		cameraOrientationInvMatrix = cameraOrientationMatrix.inverted();
+	// the projections of another image are not shown while the new ones are generated
+	if (reloadVolume)
+		projectionTexture.destroy();
 
-		cameraPosition = orbitPointWorld - cameraOrientationMatrix * orbitPointCamera;
-	}
-	else if (mouseMode == MouseMode::PAN)
-		cameraPosition += (cameraRight * -mouseDelta.x() * moveSpeed + cameraUp * mouseDelta.y() * moveSpeed) * planeDistance;
-	else if (mouseMode == MouseMode::ZOOM)
-		cameraPosition += cameraForward * -mouseDelta.y() * moveSpeed;
-	else if (mouseMode == MouseMode::MEASURE)
+	if (reloadVolume || resizeCube)
 	{
-		measureEndPoint = getPlaneIntersection(me->localPos());
-		measureDistance = (measureEndPoint - measureStartPoint).length();
+		resetCrop();
+		updateOccupiedBounds();
+		projectionImageIsValid = false;
+		pinnedPlanes.clear();
+		selectedPlane = -1;
 	}
 
-	me->accept();
+	// a reloaded volume can end up at the address of the old one
+	sliceViews.invalidate();
+
+	appliedSettings = settings;
+	hasAppliedSettings = true;
+
+	std::lock_guard<std::mutex> lock(settingsMutex);
+	publishedVolume = volume;
+	publishedSliceStreaming = (sliceStreamer != nullptr);
 }
 
-void RenderWidget::wheelEvent(QWheelEvent* we)
+bool RenderWidget::volumeChanged() const
 {
-	float stepSize = mouseWheelStepSizeModifier;
+	if (settings.textureFormat == TextureFormat::STREAMED_SLICES)
+		return forceReload || sliceStreamer == nullptr || !sliceStreamer->isOpenedFrom(settings.imageLoaderInfo);
 
-	if (keyboardHelper.keyIsDown(Qt::Key_Shift))
-		stepSize *= 2.0f;
+	return forceReload || volume == nullptr || !volume->isLoadedFrom(settings.imageLoaderInfo, settings.textureFormat, settings.imageWidth, settings.imageHeight, settings.imageDepth);
+}
+
+bool RenderWidget::sizeChanged() const
+{
+	if (!hasAppliedSettings || settings.imageWidth != appliedSettings.imageWidth || settings.imageHeight != appliedSettings.imageHeight || settings.imageDepth != appliedSettings.imageDepth)
+		return true;
 
-	if (keyboardHelper.keyIsDown(Qt::Key_Control))
-		stepSize *= 0.5f;
+	// the shear grows with the slice count
+	return settings.deskewAngle != appliedSettings.deskewAngle || settings.scanStep != appliedSettings.scanStep || settings.imageLoaderInfo.imagesPerChannel != appliedSettings.imageLoaderInfo.imagesPerChannel;
+}
 
-	float moveAmount = we->angleDelta().y() / 120.0f * stepSize;
+// the volume is one unit wide, a deskewed one also needs room for the shear
+QVector3D RenderWidget::getBoxMaximum() const
+{
+	return QVector3D(1.0f + std::abs(getDeskewShear()), settings.imageHeight / settings.imageWidth, settings.imageDepth / settings.imageWidth);
+}
 
-	cameraPosition += cameraForward * moveAmount;
-	planeDistance -= moveAmount;
+// how far along x the last slice of the stack is moved from the first one, in world units
+float RenderWidget::getDeskewShear() const
+{
+	if (settings.deskewAngle == 0.0f || settings.scanStep <= 0.0f)
+		return 0.0f;
 
-	we->accept();
+	float angle = settings.deskewAngle * float(M_PI) / 180.0f;
+	return settings.imageLoaderInfo.imagesPerChannel * settings.scanStep * std::cos(angle) / settings.imageWidth;
 }
 
-void RenderWidget::initializeGL()
+// the slices are kept inside the box, so the first one at the front or the last one at the back is not moved at all
+float RenderWidget::getDeskewOffset(float z) const
 {
-	initializeOpenGLFunctions();
+	float shear = getDeskewShear();
+	float depth = settings.imageDepth / settings.imageWidth;
 
-	MainWindow::getLog().logInfo("OpenGL Vendor: %s | Renderer: %s | Version: %s | GLSL: %s", glGetString(GL_VENDOR), glGetString(GL_RENDERER), glGetString(GL_VERSION), glGetString(GL_SHADING_LANGUAGE_VERSION));;
+	return std::max(shear, 0.0f) - shear * z / depth;
+}
 
-	// CUBE //
+void RenderWidget::setDeskewUniforms(QOpenGLShaderProgram& program) const
+{
+	float depth = settings.imageDepth / settings.imageWidth;
 
-	std::array<QVector3D, 72> cubeVertexData;
-	std::array<QVector3D, 24> cubeLinesVertexData;
-	generateCubeVertices(cubeVertexData, cubeLinesVertexData, 1.0f, 1.0f, 1.0f);
+	program.setUniformValue("deskewOffset", getDeskewOffset(0.0f));
+	program.setUniformValue("deskewShear", -getDeskewShear() / depth);
+}
 
-	cube.program.addShaderFromSourceFile(QOpenGLShader::Vertex, "data/shaders/cube.vert");
-	cube.program.addShaderFromSourceFile(QOpenGLShader::Fragment, "data/shaders/cube.frag");
-	cube.program.link();
-	cube.program.bind();
+// from raw volume coordinates to the box that contains them after the deskew, the offset is linear in z so the ends of the z range are enough
+void RenderWidget::deskewBounds(QVector3D& minimum, QVector3D& maximum) const
+{
+	float offset1 = getDeskewOffset(minimum.z());
+	float offset2 = getDeskewOffset(maximum.z());
 
-	cube.vbo.create();
-	cube.vbo.bind();
-	cube.vbo.setUsagePattern(QOpenGLBuffer::StaticDraw);
-	cube.vbo.allocate(cubeLinesVertexData.data(), sizeof(cubeLinesVertexData));
+	minimum.setX(minimum.x() + std::min(offset1, offset2));
+	maximum.setX(maximum.x() + std::max(offset1, offset2));
+}
 
-	cube.vao.create();
-	cube.vao.bind();
+// the raw volume coordinates that can be sampled from inside a deskewed box
+void RenderWidget::undeskewBounds(QVector3D& minimum, QVector3D& maximum) const
+{
+	float offset1 = getDeskewOffset(minimum.z());
+	float offset2 = getDeskewOffset(maximum.z());
 
-	cube.program.enableAttributeArray("position");
-	cube.program.setAttributeBuffer("position", GL_FLOAT, 0, 3, 3 * sizeof(GLfloat));
+	minimum.setX(minimum.x() - std::max(offset1, offset2));
+	maximum.setX(maximum.x() - std::min(offset1, offset2));
+}
 
-	cube.vao.release();
-	cube.vbo.release();
-	cube.program.release();
+bool RenderWidget::event(QEvent* e)
+{
+	if (e->type() == QEvent::KeyPress || e->type() == QEvent::KeyRelease)
+	{
+		QKeyEvent* ke = static_cast<QKeyEvent*>(e);
 
-	// PLANE //
+		InputEvent inputEvent;
+		inputEvent.type = e->type();
+		inputEvent.key = ke->key();
+		inputEvent.isAutoRepeat = ke->isAutoRepeat();
+		postInput(inputEvent);
+	}
 
-	QVector3D v1(-10, -10, 0);
-	QVector3D v2(10, -10, 0);
-	QVector3D v3(-10, 10, 0);
-	QVector3D v4(10, 10, 0);
+	return QOpenGLWidget::event(e);
+}
 
-	const QVector3D planeVertexData[] =
-	{
-		v1, v2, v4,
-		v1, v4, v3
-	};
+void RenderWidget::mousePressEvent(QMouseEvent* me)
+{
+	setFocus();
 
-	plane.program.addShaderFromSourceFile(QOpenGLShader::Vertex, "data/shaders/plane.vert");
-	plane.program.addShaderFromSourceFile(QOpenGLShader::Fragment, "data/shaders/plane.frag");
-	plane.program.link();
-	plane.program.bind();
+	InputEvent inputEvent;
+	inputEvent.type = QEvent::MouseButtonPress;
+	inputEvent.buttons = me->buttons();
+	inputEvent.globalPosition = me->globalPos();
+	inputEvent.localPosition = me->localPos();
+	postInput(inputEvent);
 
-	plane.vbo.create();
-	plane.vbo.bind();
-	plane.vbo.setUsagePattern(QOpenGLBuffer::StaticDraw);
-	plane.vbo.allocate(planeVertexData, sizeof(planeVertexData));
+	me->accept();
+}
 
-	plane.vao.create();
-	plane.vao.bind();
+void RenderWidget::mouseReleaseEvent(QMouseEvent* me)
+{
+	InputEvent inputEvent;
+	inputEvent.type = QEvent::MouseButtonRelease;
+	inputEvent.buttons = me->buttons();
+	postInput(inputEvent);
 
-	plane.program.enableAttributeArray("position");
-	plane.program.setAttributeBuffer("position", GL_FLOAT, 0, 3, 3 * sizeof(GLfloat));
+	me->accept();
+}
 
-	plane.vao.release();
-	plane.vbo.release();
-	plane.program.release();
+void RenderWidget::mouseMoveEvent(QMouseEvent* me)
+{
+	InputEvent inputEvent;
+	inputEvent.type = QEvent::MouseMove;
+	inputEvent.buttons = me->buttons();
+	inputEvent.globalPosition = me->globalPos();
+	inputEvent.localPosition = me->localPos();
+	postInput(inputEvent);
 
-	// COORDINATES //
-	
-	const float coordinatesVertexData[] =
-	{
-		-10.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, -1.0f, 10.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f,
-		0.0f, -10.0f, 0.0f, 0.0f, 1.0f, 0.0f, -1.0f, 0.0f, 10.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
-		0.0f, 0.0f, -10.0f, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, 10.0f, 0.0f, 0.0f, 1.0f, 1.0f
-	};
+	me->accept();
+}
 
-	coordinates.program.addShaderFromSourceFile(QOpenGLShader::Vertex, "data/shaders/coordinates.vert");
-	coordinates.program.addShaderFromSourceFile(QOpenGLShader::Fragment, "data/shaders/coordinates.frag");
-	coordinates.program.link();
-	coordinates.program.bind();
+void RenderWidget::wheelEvent(QWheelEvent* we)
+{
+	InputEvent inputEvent;
+	inputEvent.type = QEvent::Wheel;
+	inputEvent.angleDelta = we->angleDelta();
+	inputEvent.localPosition = we->posF();
+	postInput(inputEvent);
 
-	coordinates.vbo.create();
-	coordinates.vbo.bind();
-	coordinates.vbo.setUsagePattern(QOpenGLBuffer::StaticDraw);
-	coordinates.vbo.allocate(coordinatesVertexData, sizeof(coordinatesVertexData));
+	we->accept();
+}
 
-	coordinates.vao.create();
-	coordinates.vao.bind();
+// a hidden widget is not shown, so its render thread has nothing to do
+void RenderWidget::showEvent(QShowEvent* se)
+{
+	renderThreadPaused = false;
+	QOpenGLWidget::showEvent(se);
+}
 
-	coordinates.program.enableAttributeArray("position");
-	coordinates.program.enableAttributeArray("color");
-	coordinates.program.enableAttributeArray("distance");
-	coordinates.program.setAttributeBuffer("position", GL_FLOAT, 0, 3, 7 * sizeof(GLfloat));
-	coordinates.program.setAttributeBuffer("color", GL_FLOAT, 3 * sizeof(GLfloat), 3, 7 * sizeof(GLfloat));
-	coordinates.program.setAttributeBuffer("distance", GL_FLOAT, 6 * sizeof(GLfloat), 1, 7 * sizeof(GLfloat));
+// a frame that is already running is waited for, so nothing of this widget touches the volume once it has been handed to another one
+void RenderWidget::hideEvent(QHideEvent* he)
+{
+	renderThreadPaused = true;
 
-	coordinates.vao.release();
-	coordinates.vbo.release();
-	coordinates.program.release();
+	{
+		std::lock_guard<std::mutex> lock(renderThreadFrameMutex);
+	}
 
-	// MINI COORDINATES //
+	QOpenGLWidget::hideEvent(he);
+}
 
-	const float miniCoordinatesVertexData[] =
+// with a render thread the input is applied at the start of its next frame, otherwise right away
+void RenderWidget::postInput(const InputEvent& inputEvent)
+{
+	if (renderThread == nullptr)
 	{
-		0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f,
-		0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
-		0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f
-	};
+		applyInput(inputEvent);
+		return;
+	}
 
-	miniCoordinates.program.addShaderFromSourceFile(QOpenGLShader::Vertex, "data/shaders/miniCoordinates.vert");
-	miniCoordinates.program.addShaderFromSourceFile(QOpenGLShader::Fragment, "data/shaders/miniCoordinates.frag");
-	miniCoordinates.program.link();
-	miniCoordinates.program.bind();
+	if (!inputQueue.push(inputEvent))
+		MainWindow::getLog().logWarning("Render thread input queue is full, dropping input");
+}
 
-	miniCoordinates.vbo.create();
-	miniCoordinates.vbo.bind();
-	miniCoordinates.vbo.setUsagePattern(QOpenGLBuffer::StaticDraw);
-	miniCoordinates.vbo.allocate(miniCoordinatesVertexData, sizeof(miniCoordinatesVertexData));
+void RenderWidget::processInput()
+{
+	InputEvent inputEvent;
 
-	miniCoordinates.vao.create();
-	miniCoordinates.vao.bind();
+	while (inputQueue.pop(inputEvent))
+		applyInput(inputEvent);
+}
 
-	miniCoordinates.program.enableAttributeArray("position");
-	miniCoordinates.program.enableAttributeArray("color");
-	miniCoordinates.program.enableAttributeArray("distance");
-	miniCoordinates.program.setAttributeBuffer("position", GL_FLOAT, 0, 3, 7 * sizeof(GLfloat));
-	miniCoordinates.program.setAttributeBuffer("color", GL_FLOAT, 3 * sizeof(GLfloat), 3, 7 * sizeof(GLfloat));
-	miniCoordinates.program.setAttributeBuffer("distance", GL_FLOAT, 6 * sizeof(GLfloat), 1, 7 * sizeof(GLfloat));
+void RenderWidget::applyInput(const InputEvent& inputEvent)
+{
+	// KEYS //
 
-	miniCoordinates.vao.release();
-	miniCoordinates.vbo.release();
-	miniCoordinates.program.release();
+	if (inputEvent.type == QEvent::KeyPress || inputEvent.type == QEvent::KeyRelease)
+	{
+		QKeyEvent keyEvent(inputEvent.type, inputEvent.key, Qt::NoModifier, QString(), inputEvent.isAutoRepeat);
+		keyboardHelper.event(&keyEvent);
 
-	// BACKGROUND //
+		if (inputEvent.key == Qt::Key_Space)
+			camera.updateMouseMode(keyboardHelper);
 
-	std::array<float, 30> backgroundVertexData;
-	generateBackgroundVertices(backgroundVertexData, settings.backgroundColor);
+		// almost every key changes something that is visible in the accumulated image
+		accumulationSampleCount = 0;
+		return;
+	}
 
-	background.program.addShaderFromSourceFile(QOpenGLShader::Vertex, "data/shaders/background.vert");
-	background.program.addShaderFromSourceFile(QOpenGLShader::Fragment, "data/shaders/background.frag");
-	background.program.link();
-	background.program.bind();
+	if (viewLayout == ViewLayout::SINGLE)
+	{
+		applySceneInput(inputEvent);
+		return;
+	}
 
-	background.vbo.create();
-	background.vbo.bind();
-	background.vbo.setUsagePattern(QOpenGLBuffer::StaticDraw);
-	background.vbo.allocate(backgroundVertexData.data(), sizeof(backgroundVertexData));
+	// in the 2x2 layout a drag stays with the view it was started in, and the wheel goes to the view under the cursor
+	if (inputEvent.type == QEvent::MouseButtonPress && activeView < 0)
+		activeView = getViewAt(inputEvent.localPosition);
 
-	background.vao.create();
-	background.vao.bind();
+	int view = (inputEvent.type == QEvent::Wheel) ? getViewAt(inputEvent.localPosition) : activeView;
 
-	background.program.enableAttributeArray("position");
-	background.program.enableAttributeArray("color");
-	background.program.setAttributeBuffer("position", GL_FLOAT, 0, 2, 5 * sizeof(GLfloat));
-	background.program.setAttributeBuffer("color", GL_FLOAT, 2 * sizeof(GLfloat), 3, 5 * sizeof(GLfloat));
+	if (view == 3)
+	{
+		// the 3D view gets the mouse positions relative to its own top left corner
+		QRect viewRect = getViewRect(view);
+		InputEvent sceneInputEvent = inputEvent;
+		sceneInputEvent.localPosition -= QPointF(viewRect.x(), frameSize.height() - viewRect.y() - viewRect.height());
+		applySceneInput(sceneInputEvent);
+	}
+	else if (view >= 0)
+	{
+		// the slice moves one voxel per wheel step
+		float sliceStep = (volume != nullptr) ? getVoxelSpacing(SliceViews::getNormal(view)) : 0.01f;
 
-	background.vao.release();
-	background.vbo.release();
-	background.program.release();
+		if (sliceViews.applyInput(view, getViewRect(view), frameSize.height(), inputEvent, keyboardHelper, sliceStep, getBoxMaximum()))
+			followCrosshair();
+	}
 
-	// MEASUREMENT //
+	if (inputEvent.type == QEvent::MouseButtonRelease && inputEvent.buttons == Qt::NoButton)
+		activeView = -1;
+}
 
-	const float measurementVertexData[] =
+void RenderWidget::applySceneInput(const InputEvent& inputEvent)
+{
+	// MOUSE PRESS //
+
+	if (inputEvent.type == QEvent::MouseButtonPress)
 	{
-		0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f
-	};
+		camera.mousePress(inputEvent.buttons, inputEvent.globalPosition, keyboardHelper);
 
-	measurement.program.addShaderFromSourceFile(QOpenGLShader::Vertex, "data/shaders/measurement.vert");
-	measurement.program.addShaderFromSourceFile(QOpenGLShader::Fragment, "data/shaders/measurement.frag");
-	measurement.program.link();
-	measurement.program.bind();
+		if (camera.mouseMode == MouseMode::ORBIT)
+			camera.orbitPointWorld = getPlaneIntersection(inputEvent.localPosition);
+		else if (camera.mouseMode == MouseMode::MEASURE)
+			measureStartPoint = measureEndPoint = getPlaneIntersection(inputEvent.localPosition);
+	}
 
-	measurement.vbo.create();
-	measurement.vbo.bind();
-	measurement.vbo.setUsagePattern(QOpenGLBuffer::DynamicDraw);
-	measurement.vbo.allocate(measurementVertexData, sizeof(measurementVertexData));
+	// MOUSE RELEASE //
 
-	measurement.vao.create();
-	measurement.vao.bind();
+	else if (inputEvent.type == QEvent::MouseButtonRelease)
+		camera.mouseRelease(inputEvent.buttons, keyboardHelper);
 
-	measurement.program.enableAttributeArray("position");
-	measurement.program.setAttributeBuffer("position", GL_FLOAT, 0, 3, 3 * sizeof(GLfloat));
+	// MOUSE MOVE //
 
-	measurement.vao.release();
-	measurement.vbo.release();
-	measurement.program.release();
+	else if (inputEvent.type == QEvent::MouseMove)
+	{
+		camera.mouseMove(inputEvent.globalPosition, keyboardHelper);
 
-	// TEXT //
+		if (camera.mouseMode == MouseMode::MEASURE)
+		{
+			measureEndPoint = getPlaneIntersection(inputEvent.localPosition);
+			measureDistance = (measureEndPoint - measureStartPoint).length();
+		}
+	}
+
+	// WHEEL //
 
-	const float textVertexData[] =
+	else if (inputEvent.type == QEvent::Wheel)
 	{
-		-1.0f, -1.0f, 0.0f, 0.0f,
-		1.0f, -1.0f, 1.0f, 0.0f,
-		1.0f, 1.0f, 1.0f, 1.0f,
+		float wheelSteps = inputEvent.angleDelta.y() / 120.0f;
 
-		-1.0f, -1.0f, 0.0f, 0.0f,
-		1.0f, 1.0f, 1.0f, 1.0f,
-		-1.0f, 1.0f, 0.0f, 1.0f
-	};
+		// a streamed image has no slab, its slices are paged through instead
+		if (keyboardHelper.keyIsDown(Qt::Key_Space) && sliceStreamer != nullptr)
+			changeStreamedSlice((wheelSteps > 0.0f) ? 1 : -1);
 
-	text.program.addShaderFromSourceFile(QOpenGLShader::Vertex, "data/shaders/text.vert");
-	text.program.addShaderFromSourceFile(QOpenGLShader::Fragment, "data/shaders/text.frag");
-	text.program.link();
-	text.program.bind();
+		// the slab grows two voxels along the plane normal per wheel step
+		else if (keyboardHelper.keyIsDown(Qt::Key_Space))
+		{
+			float boxDiagonal = getBoxMaximum().length();
+			float thicknessStep = (volume != nullptr) ? 2.0f * getVoxelSpacing(planeNormal) : 0.01f;
 
-	text.vbo.create();
-	text.vbo.bind();
-	text.vbo.setUsagePattern(QOpenGLBuffer::StaticDraw);
-	text.vbo.allocate(textVertexData, sizeof(textVertexData));
+			slabThickness = std::min(std::max(slabThickness + wheelSteps * thicknessStep * CameraController::getSpeedModifier(keyboardHelper), 0.0f), boxDiagonal);
+			accumulationSampleCount = 0;
+			updatePlaneVertices();
+		}
+		else
+			camera.wheel(wheelSteps, keyboardHelper);
+	}
+}
 
-	text.vao.create();
-	text.vao.bind();
+void RenderWidget::initializeGL()
+{
+	initializeOpenGLFunctions();
 
-	text.program.enableAttributeArray("position");
-	text.program.enableAttributeArray("texcoord");
-	text.program.setAttributeBuffer("position", GL_FLOAT, 0, 2, 4 * sizeof(GLfloat));
-	text.program.setAttributeBuffer("texcoord", GL_FLOAT, 2 * sizeof(GLfloat), 2, 4 * sizeof(GLfloat));
+	MainWindow::getLog().logInfo("OpenGL Vendor: %s | Renderer: %s | Version: %s | GLSL: %s", glGetString(GL_VENDOR), glGetString(GL_RENDERER), glGetString(GL_VERSION), glGetString(GL_SHADING_LANGUAGE_VERSION));;
 
-	text.vao.release();
-	text.vbo.release();
-	text.program.release();
+	if (!isOffscreen)
+		startRenderThread();
+
+	// offscreen rendering, and a widget whose render thread could not be started, render with the widget's own context
+	if (renderThread == nullptr)
+		initializeScene();
+}
+
+void RenderWidget::startRenderThread()
+{
+	renderContext.reset(new QOpenGLContext());
+	renderContext->setFormat(QSurfaceFormat::defaultFormat());
+	renderContext->setShareContext(context());
+
+	if (!renderContext->create() || !renderContext->shareContext())
+	{
+		MainWindow::getLog().logWarning("Could not create a shared context for the render thread, rendering on the GUI thread");
+		renderContext.reset();
+		return;
+	}
+
+	// the surface has to be created on the GUI thread, but it can be made current on any thread
+	renderSurface.reset(new QOffscreenSurface());
+	renderSurface->setFormat(renderContext->format());
+	renderSurface->create();
+
+	// PRESENT //
+
+	programCache.linkFiles(present.program, "data/shaders/text.vert", { "data/shaders/upscale.frag" });
+	present.program.bind();
+
+	present.vbo.create();
+	present.vbo.bind();
+	present.vbo.setUsagePattern(QOpenGLBuffer::StaticDraw);
+	present.vbo.allocate(screenQuadVertexData, sizeof(screenQuadVertexData));
+
+	present.vao.create();
+	present.vao.bind();
+
+	present.program.enableAttributeArray("position");
+	present.program.enableAttributeArray("texcoord");
+	present.program.setAttributeBuffer("position", GL_FLOAT, 0, 2, 4 * sizeof(GLfloat));
+	present.program.setAttributeBuffer("texcoord", GL_FLOAT, 2 * sizeof(GLfloat), 2, 4 * sizeof(GLfloat));
+
+	present.vao.release();
+	present.vbo.release();
+	present.program.release();
 
 	// MISC //
 
-	timeStepTimer.start();
-	resetCameraPosition();
-	loadCameraSpeeds();
-	updateCamera();
+	qreal refreshRate = QGuiApplication::primaryScreen()->refreshRate();
+
+	if (refreshRate > 1.0)
+		frameInterval = qint64(1000000000.0 / refreshRate);
+
+	renderThread.reset(new RenderThread([this]() { runRenderThread(); }));
+	renderContext->moveToThread(renderThread.get());
+	renderThread->start();
 }
 
-void RenderWidget::resizeGL(int width, int height)
+// the render thread owns its context for its whole lifetime and renders at the display refresh rate until the widget is destroyed
+void RenderWidget::runRenderThread()
 {
-	float aspectRatio = float(width) / float(height);
-	projectionMatrix.setToIdentity();
-	projectionMatrix.perspective(45.0f, aspectRatio, 0.001f, 100.0f);
+	renderContext->makeCurrent(renderSurface.get());
+	initializeOpenGLFunctions();
+	initializeScene();
 
-	textImage = QImage(width, height, QImage::Format_RGBA8888);
-	textImage.fill(QColor(0, 0, 0, 0));
+	QElapsedTimer frameIntervalTimer;
+	frameIntervalTimer.start();
+
+	while (!renderThreadExiting)
+	{
+		// the pause is checked under the frame lock, so once hideEvent has held it no frame is running or will start
+		{
+			std::lock_guard<std::mutex> lock(renderThreadFrameMutex);
 
+			if (!renderThreadPaused)
+				renderThreadFrame();
+		}
+
+		// the widget only ever shows the latest frame, so anything faster than the display would never be seen
+		qint64 remainingTime = frameInterval - frameIntervalTimer.nsecsElapsed();
+
+		if (remainingTime > 0)
+			QThread::usleep(remainingTime / 1000);
+
+		frameIntervalTimer.restart();
+	}
+
+	releaseScene();
+	renderContext->doneCurrent();
+	renderContext->moveToThread(QCoreApplication::instance()->thread());
+}
+
+void RenderWidget::renderThreadFrame()
+{
+	processInput();
+	applyRequestedSettings();
+
+	QSize requestedSize(requestedWidth, requestedHeight);
+
+	if (requestedSize.isEmpty())
+		return;
+
+	if (requestedSize != frameSize)
+		resizeScene(requestedSize.width(), requestedSize.height());
+
+	// the widget's own framebuffer would be multisampled, so the frame is rendered the same way and resolved for the GUI thread
+	if (multisampleFramebuffer == nullptr || multisampleFramebuffer->size() != frameSize)
+	{
+		QOpenGLFramebufferObjectFormat format;
+		format.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+		format.setSamples(QSurfaceFormat::defaultFormat().samples());
+
+		multisampleFramebuffer.reset(new QOpenGLFramebufferObject(frameSize, format));
+	}
+
+	targetFramebuffer = multisampleFramebuffer->handle();
+	glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+	glViewport(0, 0, frameSize.width(), frameSize.height());
+
+	renderFrame();
+
+	std::unique_ptr<QOpenGLFramebufferObject>& frameFramebuffer = frameFramebuffers[frameExchange.getBackIndex()];
+	updateFramebuffer(frameFramebuffer, frameSize, GL_RGBA8);
+	QOpenGLFramebufferObject::blitFramebuffer(frameFramebuffer.get(), multisampleFramebuffer.get());
+
+	// the other context may only sample the frame once it is complete
+	glFinish();
+	frameExchange.publish();
+}
+
+// the widget draws the latest frame finished by the render thread, or just the background until there is one
+void RenderWidget::presentFrame()
+{
+	// the functions of this class are resolved for the render thread context
+	QOpenGLFunctions* functions = context()->functions();
+
+	if (frameExchange.acquire())
+		hasPresentedFrame = true;
+
+	if (!hasPresentedFrame)
+	{
+		QColor backgroundColor = getSettings().backgroundColor;
+		functions->glClearColor(backgroundColor.redF(), backgroundColor.greenF(), backgroundColor.blueF(), backgroundColor.alphaF());
+		functions->glClear(GL_COLOR_BUFFER_BIT);
+
+		return;
+	}
+
+	present.program.bind();
+	present.vao.bind();
+	functions->glActiveTexture(GL_TEXTURE0);
+	functions->glBindTexture(GL_TEXTURE_2D, frameFramebuffers[frameExchange.getFrontIndex()]->texture());
+
+	present.program.setUniformValue("tex0", 0);
+	present.program.setUniformValue("sampleWeight", 1.0f);
+
+	functions->glDrawArrays(GL_TRIANGLES, 0, 6);
+
+	functions->glBindTexture(GL_TEXTURE_2D, 0);
+	present.vao.release();
+	present.program.release();
+}
+
+// frees everything that initializeScene and rendering created, with the same context current
+void RenderWidget::releaseScene()
+{
+	pendingCrop.reset();
+	volume.reset();
+	pendingVolume.reset();
+	releaseStreamedSlices();
 	textTexture.destroy();
-	textTexture.create();
-	textTexture.bind();
-	textTexture.setData(textImage);
-	textTexture.release();
+	projectionTexture.destroy();
+	scaledFramebuffer.reset();
+	sampleFramebuffer.reset();
+	accumulationFramebuffer.reset();
+	multisampleFramebuffer.reset();
+
+	for (std::unique_ptr<QOpenGLFramebufferObject>& frameFramebuffer : frameFramebuffers)
+		frameFramebuffer.reset();
+
+	frameTimer.release();
+	sliceViews.release();
+	planeVariants.release();
+	rayMarchVariants.release();
+	projectionVariants.release();
+
+	for (OpenGLData* data : { &cube, &plane, &planeLines, &rayMarch, &projection, &projectionImage, &coordinates, &miniCoordinates, &background, &measurement, &text, &upscale, &slicePlanes, &cropBox, &streamedSlice })
+	{
+		data->vao.destroy();
+		data->vbo.destroy();
+	}
 }
 
-void RenderWidget::paintGL()
+void RenderWidget::initializeScene()
 {
-	updateLogic();
+	QElapsedTimer initializeTimer;
+	initializeTimer.start();
 
-	glClearColor(settings.backgroundColor.redF(), settings.backgroundColor.greenF(), settings.backgroundColor.blueF(), settings.backgroundColor.alphaF());
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-	glDisable(GL_DEPTH_TEST);
-	glEnable(GL_BLEND);
-	glEnable(GL_MULTISAMPLE);
-	glEnable(GL_LINE_SMOOTH);
-	glLineWidth(4.0f);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	int loadedProgramCount = programCache.getLoadedCount();
+	int compiledProgramCount = programCache.getCompiledCount();
+
+	drawArraysInstanced = reinterpret_cast<DrawArraysInstancedFunction>(QOpenGLContext::currentContext()->getProcAddress("glDrawArraysInstanced"));
+	vertexAttribDivisor = reinterpret_cast<VertexAttribDivisorFunction>(QOpenGLContext::currentContext()->getProcAddress("glVertexAttribDivisor"));
+
+	// CUBE //
+
+	std::array<QVector3D, 72> cubeVertexData;
+	std::array<QVector3D, 24> cubeLinesVertexData;
+	generateCubeVertices(cubeVertexData, cubeLinesVertexData, 1.0f, 1.0f, 1.0f, 0.0f);
+
+	programCache.linkFiles(cube.program, "data/shaders/cube.vert", { "data/shaders/cube.frag" });
+	cube.program.bind();
+
+	cube.vbo.create();
+	cube.vbo.bind();
+	cube.vbo.setUsagePattern(QOpenGLBuffer::StaticDraw);
+	cube.vbo.allocate(cubeLinesVertexData.data(), sizeof(cubeLinesVertexData));
+
+	cube.vao.create();
+	cube.vao.bind();
+
+	cube.program.enableAttributeArray("position");
+	cube.program.setAttributeBuffer("position", GL_FLOAT, 0, 3, 3 * sizeof(GLfloat));
+
+	cube.vao.release();
+	cube.vbo.release();
+	cube.program.release();
+
+	// PLANE //
+
+	std::array<PlaneInstance, MAX_PLANE_COUNT> planeInstanceData;
+	memset(planeInstanceData.data(), 0, sizeof(planeInstanceData));
+
+	// the programs are compiled per variant when first drawn, plane.vert has its attribute locations in the source
+	planeVariants.initialize("plane", "data/shaders/plane.vert", { "data/shaders/plane.frag", "data/shaders/sampling.frag" }, programCache);
+
+	plane.vbo.create();
+	plane.vbo.bind();
+	plane.vbo.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+	plane.vbo.allocate(planeInstanceData.data(), sizeof(planeInstanceData));
+
+	plane.vao.create();
+	plane.vao.bind();
+
+	setPlaneInstanceAttributes();
+
+	plane.vao.release();
+	plane.vbo.release();
+
+	// PLANE LINES //
+
+	std::array<QVector3D, 6 * MAX_PLANE_COUNT> planeLinesVertexData;
+	planeLinesVertexData.fill(QVector3D());
+
+	programCache.linkFiles(planeLines.program, "data/shaders/cube.vert", { "data/shaders/cube.frag" });
+	planeLines.program.bind();
+
+	planeLines.vbo.create();
+	planeLines.vbo.bind();
+	planeLines.vbo.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+	planeLines.vbo.allocate(planeLinesVertexData.data(), sizeof(planeLinesVertexData));
+
+	planeLines.vao.create();
+	planeLines.vao.bind();
+
+	planeLines.program.enableAttributeArray("position");
+	planeLines.program.setAttributeBuffer("position", GL_FLOAT, 0, 3, 3 * sizeof(GLfloat));
+
+	planeLines.vao.release();
+	planeLines.vbo.release();
+	planeLines.program.release();
+
+	// SLICE PLANES //
+
+	// one plane instance that each slice view writes before drawing
+	slicePlanes.vbo.create();
+	slicePlanes.vbo.bind();
+	slicePlanes.vbo.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+	slicePlanes.vbo.allocate(planeInstanceData.data(), sizeof(PlaneInstance));
+
+	slicePlanes.vao.create();
+	slicePlanes.vao.bind();
+
+	setPlaneInstanceAttributes();
+
+	slicePlanes.vao.release();
+	slicePlanes.vbo.release();
+
+	// SLICE VIEWS //
+
+	sliceViews.initialize(programCache);
+
+	// CROP BOX //
+
+	// the twelve edges of the box and the outline of the selected face
+	std::array<QVector3D, 28> cropBoxVertexData;
+	cropBoxVertexData.fill(QVector3D());
+
+	programCache.linkFiles(cropBox.program, "data/shaders/cube.vert", { "data/shaders/cube.frag" });
+	cropBox.program.bind();
+
+	cropBox.vbo.create();
+	cropBox.vbo.bind();
+	cropBox.vbo.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+	cropBox.vbo.allocate(cropBoxVertexData.data(), sizeof(cropBoxVertexData));
+
+	cropBox.vao.create();
+	cropBox.vao.bind();
+
+	cropBox.program.enableAttributeArray("position");
+	cropBox.program.setAttributeBuffer("position", GL_FLOAT, 0, 3, 3 * sizeof(GLfloat));
+
+	cropBox.vao.release();
+	cropBox.vbo.release();
+	cropBox.program.release();
+
+	// RAY MARCH //
+
+	rayMarchVariants.initialize("volume", "data/shaders/volume.vert", { "data/shaders/volume.frag", "data/shaders/sampling.frag" }, programCache);
+
+	rayMarch.vbo.create();
+	rayMarch.vbo.bind();
+	rayMarch.vbo.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+	rayMarch.vbo.allocate(cubeVertexData.data(), sizeof(cubeVertexData));
+
+	rayMarch.vao.create();
+	rayMarch.vao.bind();
+
+	glEnableVertexAttribArray(ShaderVariantCache::POSITION_LOCATION);
+	glVertexAttribPointer(ShaderVariantCache::POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), nullptr);
+
+	rayMarch.vao.release();
+	rayMarch.vbo.release();
+
+	// PROJECTION //
+
+	projectionVariants.initialize("projection", "data/shaders/volume.vert", { "data/shaders/projection.frag", "data/shaders/sampling.frag" }, programCache);
+
+	projection.vbo.create();
+	projection.vbo.bind();
+	projection.vbo.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+	projection.vbo.allocate(cubeVertexData.data(), sizeof(cubeVertexData));
+
+	projection.vao.create();
+	projection.vao.bind();
+
+	glEnableVertexAttribArray(ShaderVariantCache::POSITION_LOCATION);
+	glVertexAttribPointer(ShaderVariantCache::POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), nullptr);
+
+	projection.vao.release();
+	projection.vbo.release();
+
+	// PROJECTION IMAGE //
+
+	std::array<float, 30> projectionImageVertexData;
+	projectionImageVertexData.fill(0.0f);
+
+	programCache.linkFiles(projectionImage.program, "data/shaders/projectionImage.vert", { "data/shaders/projectionImage.frag" });
+	projectionImage.program.bind();
+
+	projectionImage.vbo.create();
+	projectionImage.vbo.bind();
+	projectionImage.vbo.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+	projectionImage.vbo.allocate(projectionImageVertexData.data(), sizeof(projectionImageVertexData));
+
+	projectionImage.vao.create();
+	projectionImage.vao.bind();
+
+	projectionImage.program.enableAttributeArray("position");
+	projectionImage.program.enableAttributeArray("texcoord");
+	projectionImage.program.setAttributeBuffer("position", GL_FLOAT, 0, 3, 5 * sizeof(GLfloat));
+	projectionImage.program.setAttributeBuffer("texcoord", GL_FLOAT, 3 * sizeof(GLfloat), 2, 5 * sizeof(GLfloat));
+
+	projectionImage.vao.release();
+	projectionImage.vbo.release();
+	projectionImage.program.release();
+
+	// STREAMED SLICE //
+
+	programCache.linkFiles(streamedSlice.program, "data/shaders/projectionImage.vert", { "data/shaders/streamedSlice.frag" });
+	streamedSlice.program.bind();
+
+	streamedSlice.vbo.create();
+	streamedSlice.vbo.bind();
+	streamedSlice.vbo.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+	streamedSlice.vbo.allocate(projectionImageVertexData.data(), sizeof(projectionImageVertexData));
+
+	streamedSlice.vao.create();
+	streamedSlice.vao.bind();
+
+	streamedSlice.program.enableAttributeArray("position");
+	streamedSlice.program.enableAttributeArray("texcoord");
+	streamedSlice.program.setAttributeBuffer("position", GL_FLOAT, 0, 3, 5 * sizeof(GLfloat));
+	streamedSlice.program.setAttributeBuffer("texcoord", GL_FLOAT, 3 * sizeof(GLfloat), 2, 5 * sizeof(GLfloat));
+
+	streamedSlice.vao.release();
+	streamedSlice.vbo.release();
+	streamedSlice.program.release();
+
+	// COORDINATES //
+	
+	const float coordinatesVertexData[] =
+	{
+		-10.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, -1.0f, 10.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+		0.0f, -10.0f, 0.0f, 0.0f, 1.0f, 0.0f, -1.0f, 0.0f, 10.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
+		0.0f, 0.0f, -10.0f, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, 10.0f, 0.0f, 0.0f, 1.0f, 1.0f
+	};
+
+	programCache.linkFiles(coordinates.program, "data/shaders/coordinates.vert", { "data/shaders/coordinates.frag" });
+	coordinates.program.bind();
+
+	coordinates.vbo.create();
+	coordinates.vbo.bind();
+	coordinates.vbo.setUsagePattern(QOpenGLBuffer::StaticDraw);
+	coordinates.vbo.allocate(coordinatesVertexData, sizeof(coordinatesVertexData));
+
+	coordinates.vao.create();
+	coordinates.vao.bind();
+
+	coordinates.program.enableAttributeArray("position");
+	coordinates.program.enableAttributeArray("color");
+	coordinates.program.enableAttributeArray("distance");
+	coordinates.program.setAttributeBuffer("position", GL_FLOAT, 0, 3, 7 * sizeof(GLfloat));
+	coordinates.program.setAttributeBuffer("color", GL_FLOAT, 3 * sizeof(GLfloat), 3, 7 * sizeof(GLfloat));
+	coordinates.program.setAttributeBuffer("distance", GL_FLOAT, 6 * sizeof(GLfloat), 1, 7 * sizeof(GLfloat));
+
+	coordinates.vao.release();
+	coordinates.vbo.release();
+	coordinates.program.release();
+
+	// MINI COORDINATES //
+
+	const float miniCoordinatesVertexData[] =
+	{
+		0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+		0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
+		0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f
+	};
+
+	programCache.linkFiles(miniCoordinates.program, "data/shaders/miniCoordinates.vert", { "data/shaders/miniCoordinates.frag" });
+	miniCoordinates.program.bind();
+
+	miniCoordinates.vbo.create();
+	miniCoordinates.vbo.bind();
+	miniCoordinates.vbo.setUsagePattern(QOpenGLBuffer::StaticDraw);
+	miniCoordinates.vbo.allocate(miniCoordinatesVertexData, sizeof(miniCoordinatesVertexData));
+
+	miniCoordinates.vao.create();
+	miniCoordinates.vao.bind();
+
+	miniCoordinates.program.enableAttributeArray("position");
+	miniCoordinates.program.enableAttributeArray("color");
+	miniCoordinates.program.enableAttributeArray("distance");
+	miniCoordinates.program.setAttributeBuffer("position", GL_FLOAT, 0, 3, 7 * sizeof(GLfloat));
+	miniCoordinates.program.setAttributeBuffer("color", GL_FLOAT, 3 * sizeof(GLfloat), 3, 7 * sizeof(GLfloat));
+	miniCoordinates.program.setAttributeBuffer("distance", GL_FLOAT, 6 * sizeof(GLfloat), 1, 7 * sizeof(GLfloat));
+
+	miniCoordinates.vao.release();
+	miniCoordinates.vbo.release();
+	miniCoordinates.program.release();
+
+	// BACKGROUND //
+
+	const float backgroundVertexData[] =
+	{
+		-1.0f, -1.0f,
+		1.0f, -1.0f,
+		1.0f, 1.0f,
+
+		-1.0f, -1.0f,
+		1.0f, 1.0f,
+		-1.0f, 1.0f
+	};
+
+	programCache.linkFiles(background.program, "data/shaders/background.vert", { "data/shaders/background.frag" });
+	background.program.bind();
+
+	background.vbo.create();
+	background.vbo.bind();
+	background.vbo.setUsagePattern(QOpenGLBuffer::StaticDraw);
+	background.vbo.allocate(backgroundVertexData, sizeof(backgroundVertexData));
+
+	background.vao.create();
+	background.vao.bind();
+
+	background.program.enableAttributeArray("position");
+	background.program.setAttributeBuffer("position", GL_FLOAT, 0, 2, 2 * sizeof(GLfloat));
+
+	background.vao.release();
+	background.vbo.release();
+	background.program.release();
+
+	// MEASUREMENT //
+
+	const float measurementVertexData[] =
+	{
+		0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f
+	};
+
+	programCache.linkFiles(measurement.program, "data/shaders/measurement.vert", { "data/shaders/measurement.frag" });
+	measurement.program.bind();
+
+	measurement.vbo.create();
+	measurement.vbo.bind();
+	measurement.vbo.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+	measurement.vbo.allocate(measurementVertexData, sizeof(measurementVertexData));
+
+	measurement.vao.create();
+	measurement.vao.bind();
+
+	measurement.program.enableAttributeArray("position");
+	measurement.program.setAttributeBuffer("position", GL_FLOAT, 0, 3, 3 * sizeof(GLfloat));
+
+	measurement.vao.release();
+	measurement.vbo.release();
+	measurement.program.release();
+
+	// TEXT //
+
+	programCache.linkFiles(text.program, "data/shaders/text.vert", { "data/shaders/text.frag" });
+	text.program.bind();
+
+	text.vbo.create();
+	text.vbo.bind();
+	text.vbo.setUsagePattern(QOpenGLBuffer::StaticDraw);
+	text.vbo.allocate(screenQuadVertexData, sizeof(screenQuadVertexData));
+
+	text.vao.create();
+	text.vao.bind();
+
+	text.program.enableAttributeArray("position");
+	text.program.enableAttributeArray("texcoord");
+	text.program.setAttributeBuffer("position", GL_FLOAT, 0, 2, 4 * sizeof(GLfloat));
+	text.program.setAttributeBuffer("texcoord", GL_FLOAT, 2 * sizeof(GLfloat), 2, 4 * sizeof(GLfloat));
+
+	text.vao.release();
+	text.vbo.release();
+	text.program.release();
+
+	// UPSCALE //
+
+	programCache.linkFiles(upscale.program, "data/shaders/text.vert", { "data/shaders/upscale.frag" });
+	upscale.program.bind();
+
+	upscale.vbo.create();
+	upscale.vbo.bind();
+	upscale.vbo.setUsagePattern(QOpenGLBuffer::StaticDraw);
+	upscale.vbo.allocate(screenQuadVertexData, sizeof(screenQuadVertexData));
+
+	upscale.vao.create();
+	upscale.vao.bind();
+
+	upscale.program.enableAttributeArray("position");
+	upscale.program.enableAttributeArray("texcoord");
+	upscale.program.setAttributeBuffer("position", GL_FLOAT, 0, 2, 4 * sizeof(GLfloat));
+	upscale.program.setAttributeBuffer("texcoord", GL_FLOAT, 2 * sizeof(GLfloat), 2, 4 * sizeof(GLfloat));
+
+	upscale.vao.release();
+	upscale.vbo.release();
+	upscale.program.release();
+
+	// MISC //
+
+	MainWindow::getLog().logInfo("Initialized the scene in %d ms (%d programs loaded from the shader cache, %d compiled)", initializeTimer.elapsed(), programCache.getLoadedCount() - loadedProgramCount, programCache.getCompiledCount() - compiledProgramCount);
+
+	frameTimer.initialize();
+	timeStepTimer.start();
+	resetCameraPosition();
+	camera.loadSpeeds();
+	camera.updateMatrices();
+	resetCrop();
+
+	if (hasPendingInitialize)
+		applySettings();
+}
+
+void RenderWidget::resizeGL(int width, int height)
+{
+	if (renderThread != nullptr)
+	{
+		requestedWidth = width;
+		requestedHeight = height;
+		return;
+	}
+
+	resizeScene(width, height);
+}
+
+void RenderWidget::paintGL()
+{
+	if (renderThread != nullptr)
+		presentFrame();
+	else
+		renderFrame();
+}
+
+void RenderWidget::resizeScene(int width, int height)
+{
+	frameSize = QSize(width, height);
+	updateSceneViewport();
+
+	textImage = QImage(width, height, QImage::Format_RGBA8888);
+	textImage.fill(QColor(0, 0, 0, 0));
+
+	textTexture.destroy();
+	textTexture.create();
+	textTexture.bind();
+	textTexture.setData(textImage);
+	textTexture.release();
+}
+
+void RenderWidget::renderFrame()
+{
+	frameTimer.beginFrame();
+
+	frameTimer.beginCpu(CpuTimer::LOGIC);
+	updateLogic();
+	frameTimer.endCpu(CpuTimer::LOGIC);
+
+	if (runEmptySpaceSkippingBenchmark)
+	{
+		runEmptySpaceSkippingBenchmark = false;
+		benchmarkEmptySpaceSkipping();
+	}
+
+	updateRenderScale();
+	frameTimer.setRenderScale(renderScale);
+
+	if (recordingCameraPath)
+	{
+		CameraPose pose = getCameraPose();
+		pose.time = cameraPathTimer.elapsed() / 1000.0f;
+		recordedCameraPath.addPose(pose);
+	}
+
+	// in the 2x2 layout the slice views are drawn first, and everything of the 3D view is clipped to its own corner
+	if (viewLayout == ViewLayout::QUAD)
+	{
+		glDisable(GL_SCISSOR_TEST);
+		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+		glEnable(GL_SCISSOR_TEST);
+
+		renderSliceViews();
+	}
+
+	QSize sceneSize = sceneViewport.size();
+	setViewport(sceneViewport);
+
+	// while the camera moves the scene is drawn into a smaller offscreen target and stretched over the widget
+	if (renderScale < 1.0f)
+	{
+		QSize scaledSize(std::max(int(sceneSize.width() * renderScale), 1), std::max(int(sceneSize.height() * renderScale), 1));
+		updateFramebuffer(scaledFramebuffer, scaledSize, GL_RGBA8);
+
+		scaledFramebuffer->bind();
+		setViewport(QRect(QPoint(0, 0), scaledSize));
+
+		renderScene();
+
+		glBindFramebuffer(GL_FRAMEBUFFER, getTargetFramebuffer());
+		setViewport(sceneViewport);
+
+		frameTimer.beginGpu(GpuTimer::COMPOSITE);
+		glDisable(GL_BLEND);
+		renderFramebuffer(*scaledFramebuffer, 1.0f);
+		glEnable(GL_BLEND);
+		frameTimer.endGpu(GpuTimer::COMPOSITE);
+
+		accumulationSampleCount = 0;
+	}
+	else if (camera.mouseMode == MouseMode::NONE && !viewChanged && !isOffscreen)
+	{
+		// a still view is refined by adding one jittered frame at a time to the accumulation buffer until the sample limit
+		bool renderSample = (accumulationSampleCount < maxAccumulationSampleCount);
+
+		if (renderSample)
+		{
+			updateFramebuffer(sampleFramebuffer, sceneSize, GL_RGBA8);
+
+			// a new accumulation buffer has to be cleared before the first sample
+			if (updateFramebuffer(accumulationFramebuffer, sceneSize, GL_RGBA32F))
+				accumulationSampleCount = 0;
+
+			sampleFramebuffer->bind();
+			setViewport(QRect(QPoint(0, 0), sceneSize));
+			renderScene();
+		}
+
+		frameTimer.beginGpu(GpuTimer::COMPOSITE);
+
+		if (renderSample)
+		{
+			accumulationFramebuffer->bind();
+
+			if (accumulationSampleCount == 0)
+			{
+				glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+				glClear(GL_COLOR_BUFFER_BIT);
+			}
+
+			glBlendFunc(GL_ONE, GL_ONE);
+			renderFramebuffer(*sampleFramebuffer, 1.0f);
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+			glBindFramebuffer(GL_FRAMEBUFFER, getTargetFramebuffer());
+			setViewport(sceneViewport);
+			++accumulationSampleCount;
+		}
+
+		glDisable(GL_BLEND);
+		renderFramebuffer(*accumulationFramebuffer, 1.0f / accumulationSampleCount);
+		glEnable(GL_BLEND);
+
+		frameTimer.endGpu(GpuTimer::COMPOSITE);
+	}
+	else
+	{
+		accumulationSampleCount = 0;
+		renderScene();
+	}
+
+	// MINI COORDINATES //
+
+	if (renderMiniCoordinates)
+	{
+		frameTimer.beginGpu(GpuTimer::MINI_COORDINATES);
+		glViewport(sceneViewport.x() - 50, sceneViewport.y() - 50, 200, 200);
+
+		miniCoordinates.program.bind();
+		miniCoordinates.vao.bind();
+
+		miniCoordinates.program.setUniformValue("mvp", miniCoordinates.mvp);
+
+		glDrawArrays(GL_LINES, 0, 6);
+
+		miniCoordinates.vao.release();
+		miniCoordinates.program.release();
+
+		glViewport(sceneViewport.x(), sceneViewport.y(), sceneViewport.width(), sceneViewport.height());
+		frameTimer.endGpu(GpuTimer::MINI_COORDINATES);
+	}
+
+	// MEASUREMENT //
+
+	if (camera.mouseMode == MouseMode::MEASURE)
+	{
+		frameTimer.beginGpu(GpuTimer::MEASUREMENT);
+
+		measurement.program.bind();
+		measurement.vao.bind();
+
+		measurement.program.setUniformValue("lineColor", settings.lineColor);
+		measurement.program.setUniformValue("mvp", measurement.mvp);
+
+		glDrawArrays(GL_LINES, 0, 2);
+
+		measurement.vao.release();
+		measurement.program.release();
+
+		frameTimer.endGpu(GpuTimer::MEASUREMENT);
+	}
+
+	glDisable(GL_SCISSOR_TEST);
+	glViewport(0, 0, frameSize.width(), frameSize.height());
+
+	// TEXT //
+
+	if (renderText)
+	{
+		frameTimer.beginCpu(CpuTimer::TEXT_PAINT);
+
+		QLocale locale(QLocale::English);
+
+		QVector3D realCameraPosition = camera.position * settings.imageWidth;
+		float realMeasuredDistance = measureDistance * settings.imageWidth;
+
+		textImage.fill(QColor(0, 0, 0, 0));
+
+		QPainter painter(&textImage);
+		painter.setRenderHint(QPainter::Antialiasing);
+		painter.setRenderHint(QPainter::TextAntialiasing);
+		painter.setRenderHint(QPainter::SmoothPixmapTransform);
+		painter.setRenderHint(QPainter::HighQualityAntialiasing);
+
+		painter.setPen(QColor(0, 0, 0, 96));
+		painter.setBrush(QColor(0, 0, 0, 64));
+		// the box grows downwards with the number of lines
+		int lineCount = renderTimings ? 7 + int(GpuTimer::COUNT) + int(CpuTimer::COUNT) : 4;
+
+		if (isCropActive())
+			++lineCount;
+
+		painter.drawRoundRect(-20, 6 + lineCount * 17 - 400, 400, 400, 10, 10);
+
+#ifdef __APPLE__
+		int textSize = 12;
+#else
+		int textSize = 10;
+#endif
+
+		QFont font("Roboto Mono", textSize, QFont::Normal);
+		font.setHintingPreference(QFont::PreferFullHinting);
+		font.setStyleStrategy(QFont::PreferAntialias);
+
+		painter.setBrush(Qt::NoBrush);
+		painter.setPen(QColor(255, 255, 255, 255));
+		painter.setFont(font);
+		
+		painter.drawText(5, 15, QString("Position: (%1, %2, %3)").arg(locale.toString(realCameraPosition.x(), 'e', 3), locale.toString(realCameraPosition.y(), 'e', 3), locale.toString(realCameraPosition.z(), 'e', 3)));
+		painter.drawText(5, 32, QString("Distance: %1").arg(locale.toString(realMeasuredDistance, 'e', 3)));
+		painter.drawText(5, 49, QString("Mode: %1").arg(getRenderModeName()));
+		painter.drawText(5, 66, QString("Resolution: %1 % | %2 ms (target %3 ms) | %4/%5 samples").arg(QString::number(int(renderScale * 100.0f + 0.5f)), QString::number(sceneTime, 'f', 1), QString::number(targetFrameTime, 'f', 1), QString::number(std::max(accumulationSampleCount, 1)), QString::number(maxAccumulationSampleCount)));
+
+		int y = 83;
+
+		// in the same physical units as the position, a committed crop does not move anything
+		if (isCropActive())
+		{
+			const char* faceNames[] = { "-x", "+x", "-y", "+y", "-z", "+z" };
+			QVector3D realCropMinimum = cropMinimum * settings.imageWidth;
+			QVector3D realCropMaximum = cropMaximum * settings.imageWidth;
+
+			QString cropText = QString("Crop: (%1, %2, %3) - (%4, %5, %6)").arg(locale.toString(realCropMinimum.x(), 'e', 3), locale.toString(realCropMinimum.y(), 'e', 3), locale.toString(realCropMinimum.z(), 'e', 3), locale.toString(realCropMaximum.x(), 'e', 3), locale.toString(realCropMaximum.y(), 'e', 3), locale.toString(realCropMaximum.z(), 'e', 3));
+
+			if (cropFace >= 0)
+				cropText += QString(" | %1 face").arg(faceNames[cropFace]);
+
+			if (volume != nullptr && volume->isCropped())
+				cropText += " | committed";
+
+			painter.drawText(5, y, cropText);
+			y += 17;
+		}
+
+		if (renderTimings)
+		{
+			y += 17;
+
+			painter.drawText(5, y, QString("%1 %2 %3 %4").arg("Timings (ms)", -20).arg("p50", 7).arg("p95", 7).arg("p99", 7));
+
+			auto drawTimings = [&](const QString& name, float p50, float p95, float p99)
+			{
+				y += 17;
+				painter.drawText(5, y, QString("%1 %2 %3 %4").arg(name, -20).arg(p50, 7, 'f', 2).arg(p95, 7, 'f', 2).arg(p99, 7, 'f', 2));
+			};
+
+			for (int i = 0; i < int(GpuTimer::COUNT); ++i)
+				drawTimings(QString("GPU %1").arg(FrameTimer::getName(GpuTimer(i))), frameTimer.getGpuPercentile(GpuTimer(i), 50.0f), frameTimer.getGpuPercentile(GpuTimer(i), 95.0f), frameTimer.getGpuPercentile(GpuTimer(i), 99.0f));
+
+			for (int i = 0; i < int(CpuTimer::COUNT); ++i)
+				drawTimings(QString("CPU %1").arg(FrameTimer::getName(CpuTimer(i))), frameTimer.getCpuPercentile(CpuTimer(i), 50.0f), frameTimer.getCpuPercentile(CpuTimer(i), 95.0f), frameTimer.getCpuPercentile(CpuTimer(i), 99.0f));
+
+			size_t variantCount = planeVariants.getVariantCount() + rayMarchVariants.getVariantCount() + projectionVariants.getVariantCount();
+			float variantCompileTime = planeVariants.getTotalCompileTime() + rayMarchVariants.getTotalCompileTime() + projectionVariants.getTotalCompileTime();
+
+			y += 17;
+			painter.drawText(5, y, QString("Shader variants: %1 (%2 ms compiling)").arg(QString::number(variantCount), QString::number(variantCompileTime, 'f', 1)));
+		}
+
+		painter.end();
+		frameTimer.endCpu(CpuTimer::TEXT_PAINT);
+
+		frameTimer.beginCpu(CpuTimer::TEXT_UPLOAD);
+		textTexture.bind();
+		textTexture.setData(QOpenGLTexture::RGBA, QOpenGLTexture::UInt8, textImage.bits());
+		frameTimer.endCpu(CpuTimer::TEXT_UPLOAD);
+
+		frameTimer.beginGpu(GpuTimer::TEXT);
+
+		text.program.bind();
+		text.vao.bind();
+
+		text.program.setUniformValue("tex0", 0);
+
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+
+		text.vao.release();
+		text.program.release();
+
+		textTexture.release();
+
+		frameTimer.endGpu(GpuTimer::TEXT);
+	}
+
+	frameTimer.endFrame();
+}
+
+void RenderWidget::renderScene()
+{
+	glClearColor(settings.backgroundColor.redF(), settings.backgroundColor.greenF(), settings.backgroundColor.blueF(), settings.backgroundColor.alphaF());
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glEnable(GL_MULTISAMPLE);
+	glEnable(GL_LINE_SMOOTH);
+	glLineWidth(4.0f);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	// BACKGROUND //
+
+	if (renderBackground)
+	{
+		frameTimer.beginGpu(GpuTimer::BACKGROUND);
+
+		QVector3D bottomColor;
+		QVector3D topColor;
+		generateBackgroundColors(bottomColor, topColor, settings.backgroundColor);
+
+		background.program.bind();
+		background.vao.bind();
+
+		background.program.setUniformValue("bottomColor", bottomColor);
+		background.program.setUniformValue("topColor", topColor);
+
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+
+		background.vao.release();
+		background.program.release();
+
+		frameTimer.endGpu(GpuTimer::BACKGROUND);
+	}
+
+	// COORDINATES //
+
+	if (renderCoordinates)
+	{
+		frameTimer.beginGpu(GpuTimer::COORDINATES);
+
+		coordinates.program.bind();
+		coordinates.vao.bind();
+
+		coordinates.program.setUniformValue("mvp", coordinates.mvp);
+
+		glDrawArrays(GL_LINES, 0, 6);
+
+		coordinates.vao.release();
+		coordinates.program.release();
+
+		frameTimer.endGpu(GpuTimer::COORDINATES);
+	}
+
+	// CUBE //
+
+	frameTimer.beginGpu(GpuTimer::CUBE);
+
+	cube.program.bind();
+	cube.vao.bind();
+
+	cube.program.setUniformValue("lineColor", settings.lineColor);
+	cube.program.setUniformValue("mvp", cube.mvp);
+
+	glDrawArrays(GL_LINES, 0, 24);
+
+	cube.vao.release();
+	cube.program.release();
+
+	// CROSSHAIR //
+
+	if (viewLayout == ViewLayout::QUAD)
+		sliceViews.renderCrosshair(crosshairMvp, settings.lineColor);
+
+	// CROP BOX //
+
+	if (isCropActive())
+	{
+		cropBox.program.bind();
+		cropBox.vao.bind();
+
+		QColor cropColor = settings.lineColor;
+		cropColor.setAlpha(255);
+
+		cropBox.program.setUniformValue("lineColor", cropColor);
+		cropBox.program.setUniformValue("mvp", cropBox.mvp);
+
+		glDrawArrays(GL_LINES, 0, 24);
+
+		if (cropFace >= 0)
+			glDrawArrays(GL_LINE_LOOP, 24, 4);
+
+		cropBox.vao.release();
+		cropBox.program.release();
+	}
+
+	frameTimer.endGpu(GpuTimer::CUBE);
+
+	// STREAMED SLICE //
+
+	if (sliceStreamer != nullptr)
+	{
+		frameTimer.beginGpu(GpuTimer::PLANE);
+		renderStreamedSlice();
+		frameTimer.endGpu(GpuTimer::PLANE);
+	}
+
+	// RAY MARCH //
+
+	if (renderMode == RenderMode::VOLUME && volume != nullptr)
+	{
+		frameTimer.beginGpu(GpuTimer::VOLUME);
+		renderRayMarch();
+		frameTimer.endGpu(GpuTimer::VOLUME);
+	}
+
+	// PROJECTION //
+
+	if (renderMode == RenderMode::PROJECTION && volume != nullptr)
+	{
+		frameTimer.beginGpu(GpuTimer::VOLUME);
+
+		if (projectionAxis == ProjectionAxis::VIEW)
+			renderProjection();
+		else
+			renderProjectionImage();
+
+		frameTimer.endGpu(GpuTimer::VOLUME);
+	}
+
+	// PLANE //
+
+	if (renderMode == RenderMode::PLANE && sliceStreamer == nullptr)
+	{
+		frameTimer.beginGpu(GpuTimer::PLANE);
+
+		// the planes cut through each other, so only they are depth tested
+		if (planeInstanceCount > 0)
+		{
+			glEnable(GL_DEPTH_TEST);
+			renderPlane();
+			glDisable(GL_DEPTH_TEST);
+		}
+
+		// PLANE LINES //
+
+		planeLines.program.bind();
+		planeLines.vao.bind();
+
+		planeLines.program.setUniformValue("mvp", planeLines.mvp);
+
+		// the camera plane is first, the selected pinned plane is outlined at full opacity
+		for (int i = 0; i < MAX_PLANE_COUNT; ++i)
+		{
+			if (planeLinesVertexCounts[i] < 3)
+				continue;
+
+			QColor lineColor = settings.lineColor;
+
+			if (i == selectedPlane + 1)
+				lineColor.setAlpha(255);
+
+			planeLines.program.setUniformValue("lineColor", lineColor);
+			glDrawArrays(GL_LINE_LOOP, i * 6, planeLinesVertexCounts[i]);
+		}
+
+		planeLines.vao.release();
+		planeLines.program.release();
+
+		frameTimer.endGpu(GpuTimer::PLANE);
+	}
+}
+
+// the slice views are drawn into their own framebuffers only when something they show has changed, otherwise the old image is reused
+void RenderWidget::renderSliceViews()
+{
+	for (int view = 0; view < 3; ++view)
+	{
+		QOpenGLFramebufferObject& sliceFramebuffer = sliceViews.render(view, getSliceViewState(view), getTargetFramebuffer(), [&](const QMatrix4x4& mvp) { renderSlice(view, mvp); });
+
+		setViewport(getViewRect(view));
+
+		glDisable(GL_BLEND);
+		renderFramebuffer(sliceFramebuffer, 1.0f);
+		glEnable(GL_BLEND);
+	}
+}
+
+// the cross-section of the crop box at the crosshair
+void RenderWidget::renderSlice(int view, const QMatrix4x4& mvp)
+{
+	int normalAxis = SliceViews::getNormalAxis(view);
+	QVector3D normal = SliceViews::getNormal(view);
+	QVector3D crosshairPosition = sliceViews.getCrosshairPosition();
+
+	if (volume == nullptr || crosshairPosition[normalAxis] < cropMinimum[normalAxis] || crosshairPosition[normalAxis] > cropMaximum[normalAxis])
+		return;
+
+	QVector3D cropSize = cropMaximum - cropMinimum;
+	QVector3D origin = cropMinimum + normal * (crosshairPosition[normalAxis] - cropMinimum[normalAxis]);
+	QVector3D edge1 = getAxisVector((normalAxis + 1) % 3) * cropSize;
+	QVector3D edge2 = getAxisVector((normalAxis + 2) % 3) * cropSize;
+
+	PlaneInstance sliceInstance;
+	sliceInstance.vertices[0] = origin;
+	sliceInstance.vertices[1] = origin + edge1;
+	sliceInstance.vertices[2] = origin + edge1 + edge2;
+	sliceInstance.vertices[3] = origin + edge2;
+	sliceInstance.vertices[4] = origin + edge2;
+	sliceInstance.vertices[5] = origin + edge2;
+	sliceInstance.slabNormal = normal;
+	sliceInstance.slabSampleCount = float(getSlabSampleCount(normal));
+
+	slicePlanes.vbo.bind();
+	slicePlanes.vbo.write(0, &sliceInstance, sizeof(sliceInstance));
+	slicePlanes.vbo.release();
+
+	renderPlane(slicePlanes.vao, mvp, 1);
+}
+
+// the projection of the 3D view follows its own part of the frame
+void RenderWidget::updateSceneViewport()
+{
+	sceneViewport = (viewLayout == ViewLayout::QUAD) ? getViewRect(3) : QRect(QPoint(0, 0), frameSize);
+
+	float aspectRatio = float(sceneViewport.width()) / float(std::max(sceneViewport.height(), 1));
+	projectionMatrix.setToIdentity();
+	projectionMatrix.perspective(45.0f, aspectRatio, 0.001f, 100.0f);
+
+	// the accumulated samples were rendered for the old viewport
+	accumulationSampleCount = 0;
+}
+
+// the scissor keeps the clears inside the viewport too, it is only enabled in the 2x2 layout
+void RenderWidget::setViewport(const QRect& rect)
+{
+	glViewport(rect.x(), rect.y(), rect.width(), rect.height());
+	glScissor(rect.x(), rect.y(), rect.width(), rect.height());
+}
+
+// in window coordinates with the origin at the bottom left, the views are XY, XZ, YZ and 3D from top left to bottom right with a gap of two pixels
+QRect RenderWidget::getViewRect(int view) const
+{
+	int leftWidth = frameSize.width() / 2;
+	int bottomHeight = frameSize.height() / 2;
+	bool isLeft = (view == 0 || view == 2);
+	bool isTop = (view == 0 || view == 1);
+
+	int x = isLeft ? 0 : leftWidth + 1;
+	int y = isTop ? bottomHeight + 1 : 0;
+	int width = isLeft ? leftWidth - 1 : frameSize.width() - leftWidth - 1;
+	int height = isTop ? frameSize.height() - bottomHeight - 1 : bottomHeight - 1;
+
+	return QRect(x, y, std::max(width, 1), std::max(height, 1));
+}
+
+int RenderWidget::getViewAt(const QPointF& mousePosition) const
+{
+	QPoint windowPosition(int(mousePosition.x()), frameSize.height() - 1 - int(mousePosition.y()));
+
+	for (int view = 0; view < 4; ++view)
+	{
+		if (getViewRect(view).contains(windowPosition))
+			return view;
+	}
+
+	return -1;
+}
+
+SliceViewState RenderWidget::getSliceViewState(int view) const
+{
+	SliceViewState state = sliceViews.getState(view, getViewRect(view).size());
+
+	state.volume = volume.get();
+	state.cropMinimum = cropMinimum;
+	state.cropMaximum = cropMaximum;
+	state.displayThreshold = displayThreshold;
+	state.backgroundColor = settings.backgroundColor;
+	state.lineColor = settings.lineColor;
+	state.slabMode = slabMode;
+	state.slabThickness = slabThickness;
+	state.skipEmptySpace = skipEmptySpace;
+
+	return state;
+}
+
+// the plane of the 3D view is moved through the crosshair
+void RenderWidget::followCrosshair()
+{
+	float distance = QVector3D::dotProduct(sliceViews.getCrosshairPosition() - camera.position, camera.forward);
+
+	if (distance > 0.001f)
+		camera.planeDistance = distance;
+
+	accumulationSampleCount = 0;
+}
+
+// draws the color attachment over the whole viewport, scaled by the weight and blended with the current blend function
+void RenderWidget::renderFramebuffer(QOpenGLFramebufferObject& framebuffer, float sampleWeight)
+{
+	upscale.program.bind();
+	upscale.vao.bind();
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, framebuffer.texture());
+
+	upscale.program.setUniformValue("tex0", 0);
+	upscale.program.setUniformValue("sampleWeight", sampleWeight);
+
+	glDrawArrays(GL_TRIANGLES, 0, 6);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	upscale.vao.release();
+	upscale.program.release();
+}
+
+// returns true if the framebuffer was created again, its contents are then undefined
+bool RenderWidget::updateFramebuffer(std::unique_ptr<QOpenGLFramebufferObject>& framebuffer, const QSize& framebufferSize, GLenum internalFormat)
+{
+	if (framebuffer != nullptr && framebuffer->size() == framebufferSize)
+		return false;
+
+	framebuffer.reset(new QOpenGLFramebufferObject(framebufferSize, QOpenGLFramebufferObject::CombinedDepthStencil, GL_TEXTURE_2D, internalFormat));
+
+	glBindTexture(GL_TEXTURE_2D, framebuffer->texture());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	return true;
+}
+
+// the first sample is centered, the rest follow a Halton sequence over the pixel
+QMatrix4x4 RenderWidget::getJitterMatrix() const
+{
+	QMatrix4x4 jitterMatrix;
+
+	if (accumulationSampleCount == 0 || sceneViewport.isEmpty())
+		return jitterMatrix;
+
+	float jitterX = halton(accumulationSampleCount, 2) - 0.5f;
+	float jitterY = halton(accumulationSampleCount, 3) - 0.5f;
+
+	jitterMatrix.translate(jitterX * 2.0f / sceneViewport.width(), jitterY * 2.0f / sceneViewport.height(), 0.0f);
+
+	return jitterMatrix;
+}
+
+// the pixel jitter does not move gl_FragCoord, so the ray start phase needs its own sequence to vary between accumulated frames
+float RenderWidget::getStepJitter() const
+{
+	if (accumulationSampleCount == 0)
+		return 0.0f;
+
+	return halton(accumulationSampleCount, 5);
+}
+
+GLuint RenderWidget::getTargetFramebuffer() const
+{
+	return (isOffscreen || renderThread != nullptr) ? targetFramebuffer : defaultFramebufferObject();
+}
+
+// the scale follows the measured scene time towards the target during interaction, the cost is assumed to follow the pixel count
+void RenderWidget::updateRenderScale()
+{
+	viewChanged = (camera.viewMatrix != previousViewMatrix || planePosition != previousPlanePosition || planeNormal != previousPlaneNormal);
+
+	if (viewChanged)
+		interactionTimer.start();
+
+	previousViewMatrix = camera.viewMatrix;
+	previousPlanePosition = planePosition;
+	previousPlaneNormal = planeNormal;
+
+	// offscreen frames are always rendered the same way, so that they can be compared
+	bool isInteracting = interactionTimer.isValid() && interactionTimer.elapsed() < refinementDelay && !isOffscreen;
+
+	// the GPU times arrive a few frames late, together with the scale they were measured at
+	frameTimer.getLatestSceneTime(sceneTime, sceneTimeScale);
+
+	if (!isInteracting)
+	{
+		renderScale = 1.0f;
+		return;
+	}
+
+	if (sceneTime > 0.0f)
+	{
+		float targetScale = sceneTimeScale * std::sqrt(targetFrameTime / sceneTime);
+		interactionScale = std::min(std::max(0.5f * interactionScale + 0.5f * targetScale, minimumRenderScale), 1.0f);
+	}
+
+	renderScale = (interactionScale > 0.95f) ? 1.0f : interactionScale;
+}
+
+void RenderWidget::renderPlane()
+{
+	renderPlane(plane.vao, plane.mvp, planeInstanceCount);
+}
+
+void RenderWidget::renderPlane(QOpenGLVertexArrayObject& vao, const QMatrix4x4& mvp, int instanceCount)
+{
+	// the slab mode and the empty space skipping are compiled into the program, only the sample count is left to the loop
+	ShaderDefines defines = getSamplingDefines();
+	defines.emplace_back("SLAB_MODE", (getSlabSampleCount() > 1) ? int(slabMode) + 1 : 0);
+	defines.emplace_back("SKIP_EMPTY_SPACE", skipEmptySpace ? 1 : 0);
+
+	QOpenGLShaderProgram* program = planeVariants.getProgram(defines);
+
+	if (program == nullptr)
+		return;
+
+	program->bind();
+	vao.bind();
+
+	if (volume != nullptr)
+		volume->bind(*program);
+
+	setDeskewUniforms(*program);
+	program->setUniformValue("modelMatrix", plane.modelMatrix);
+	program->setUniformValue("mvp", mvp);
+	program->setUniformValue("displayThreshold", displayThreshold);
+	program->setUniformValue("slabThickness", slabThickness);
+	program->setUniformValue("cropMinimum", cropMinimum);
+	program->setUniformValue("cropMaximum", cropMaximum);
+
+	drawArraysInstanced(GL_TRIANGLE_FAN, 0, 6, instanceCount);
+
+	if (volume != nullptr)
+		volume->release();
+
+	vao.release();
+	program->release();
+}
+
+// the plane programs read everything per instance, see plane.vert
+void RenderWidget::setPlaneInstanceAttributes()
+{
+	for (GLuint i = 0; i < 6; ++i)
+	{
+		glEnableVertexAttribArray(PLANE_POLYGON_LOCATION + i);
+		glVertexAttribPointer(PLANE_POLYGON_LOCATION + i, 3, GL_FLOAT, GL_FALSE, sizeof(PlaneInstance), reinterpret_cast<const void*>(i * sizeof(QVector3D)));
+		vertexAttribDivisor(PLANE_POLYGON_LOCATION + i, 1);
+	}
+
+	glEnableVertexAttribArray(PLANE_SLAB_LOCATION);
+	glVertexAttribPointer(PLANE_SLAB_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(PlaneInstance), reinterpret_cast<const void*>(offsetof(PlaneInstance, slabNormal)));
+	vertexAttribDivisor(PLANE_SLAB_LOCATION, 1);
+}
+
+void RenderWidget::renderRayMarch()
+{
+	QVector3D worldExtent = volume->getWorldExtent();
+
+	// the step is tied to the smallest voxel dimension in world units
+	float voxelSize = std::min(worldExtent.x() / volume->getWidth(), std::min(worldExtent.y() / volume->getHeight(), worldExtent.z() / volume->getDepth()));
+
+	ShaderDefines defines = getSamplingDefines();
+	defines.emplace_back("SKIP_EMPTY_SPACE", skipEmptySpace ? 1 : 0);
+
+	QOpenGLShaderProgram* program = rayMarchVariants.getProgram(defines);
+
+	if (program == nullptr)
+		return;
+
+	// back faces only, front faces would miss the rays starting inside the box
+	glEnable(GL_CULL_FACE);
+	glCullFace(GL_FRONT);
+
+	program->bind();
+	rayMarch.vao.bind();
+
+	volume->bind(*program);
+	setDeskewUniforms(*program);
+
+	program->setUniformValue("mvp", rayMarch.mvp);
+	program->setUniformValue("cameraPosition", camera.position);
+	program->setUniformValue("boxMinimum", cropMinimum);
+	program->setUniformValue("boxMaximum", cropMaximum);
+	program->setUniformValue("stepSize", voxelSize / samplesPerVoxel);
+	program->setUniformValue("stepJitter", getStepJitter());
+	program->setUniformValue("opacityCorrection", 1.0f / samplesPerVoxel);
+	program->setUniformValue("transferLow", transferLow);
+	program->setUniformValue("transferHigh", transferHigh);
+	program->setUniformValue("transferOpacity", transferOpacity);
+
+	glDrawArrays(GL_TRIANGLES, 0, 36);
+
+	volume->release();
+
+	rayMarch.vao.release();
+	program->release();
+
+	glDisable(GL_CULL_FACE);
+}
+
+void RenderWidget::renderProjection()
+{
+	QVector3D worldExtent = volume->getWorldExtent();
+	float voxelSize = std::min(worldExtent.x() / volume->getWidth(), std::min(worldExtent.y() / volume->getHeight(), worldExtent.z() / volume->getDepth()));
+
+	ShaderDefines defines = getSamplingDefines();
+	defines.emplace_back("PROJECTION_TYPE", int(projectionType));
+	defines.emplace_back("SKIP_EMPTY_SPACE", skipEmptySpace ? 1 : 0);
+
+	QOpenGLShaderProgram* program = projectionVariants.getProgram(defines);
+
+	if (program == nullptr)
+		return;
+
+	glEnable(GL_CULL_FACE);
+	glCullFace(GL_FRONT);
+
+	program->bind();
+	projection.vao.bind();
+
+	volume->bind(*program);
+	setDeskewUniforms(*program);
+
+	program->setUniformValue("mvp", projection.mvp);
+	program->setUniformValue("cameraPosition", camera.position);
+	program->setUniformValue("boxMinimum", cropMinimum);
+	program->setUniformValue("boxMaximum", cropMaximum);
+	program->setUniformValue("stepSize", voxelSize / samplesPerVoxel);
+	program->setUniformValue("stepJitter", getStepJitter());
+	program->setUniformValue("sampleWeight", 1.0f / samplesPerVoxel);
+	program->setUniformValue("projectionScale", getProjectionScale());
+
+	glDrawArrays(GL_TRIANGLES, 0, 36);
+
+	volume->release();
+
+	projection.vao.release();
+	program->release();
+
+	glDisable(GL_CULL_FACE);
+}
+
+// axis aligned projections are exact CPU results shown on the box face behind the projected axis
+void RenderWidget::renderProjectionImage()
+{
+	if (!projectionImageIsValid)
+		updateProjectionImage();
+
+	// the previous image is shown until the projections of the current volume are ready
+	if (!projectionTexture.isCreated())
+		return;
+
+	projectionImage.program.bind();
+	projectionImage.vao.bind();
+	projectionTexture.bind();
+
+	projectionImage.program.setUniformValue("mvp", projectionImage.mvp);
+	projectionImage.program.setUniformValue("tex0", 0);
+	projectionImage.program.setUniformValue("projectionScale", getProjectionScale());
+
+	glDrawArrays(GL_TRIANGLES, 0, 6);
+
+	projectionTexture.release();
+	projectionImage.vao.release();
+	projectionImage.program.release();
+}
+
+void RenderWidget::updateProjectionImage()
+{
+	if (isOffscreen)
+		volume->waitForAxisProjections();
+
+	std::vector<float> projectionData;
+	uint32_t projectionWidth, projectionHeight;
+
+	if (!generateProjectionData(projectionData, projectionWidth, projectionHeight))
+		return;
+
+	projectionTexture.destroy();
+	projectionTexture.create();
+	projectionTexture.bind();
+	projectionTexture.setFormat(QOpenGLTexture::RGB32F);
+	projectionTexture.setMinMagFilters(QOpenGLTexture::Linear, QOpenGLTexture::Linear);
+	projectionTexture.setWrapMode(QOpenGLTexture::ClampToEdge);
+	projectionTexture.setSize(projectionWidth, projectionHeight);
+	projectionTexture.setMipLevels(1);
+	projectionTexture.allocateStorage();
+	projectionTexture.setData(QOpenGLTexture::RGB, QOpenGLTexture::Float32, &projectionData[0]);
+	projectionTexture.release();
+
+	// the projections are of the loaded voxels inside the crop box, snapped outwards to whole voxels
+	std::array<int, 3> voxelMinimum;
+	std::array<int, 3> voxelMaximum;
+	getCropVoxelRange(voxelMinimum, voxelMaximum);
+
+	QVector3D worldOrigin = volume->getWorldOrigin();
+	QVector3D worldExtent = volume->getWorldExtent();
+	QVector3D volumeSize(volume->getWidth(), volume->getHeight(), volume->getDepth());
+	QVector3D minimum = worldOrigin + worldExtent * QVector3D(voxelMinimum[0], voxelMinimum[1], volumeSize.z() - voxelMaximum[2]) / volumeSize;
+	QVector3D maximum = worldOrigin + worldExtent * QVector3D(voxelMaximum[0], voxelMaximum[1], volumeSize.z() - voxelMinimum[2]) / volumeSize;
+
+	// quad corners with their texcoords, counterclockwise from the projection image origin
+	std::array<QVector3D, 4> corners;
+
+	if (projectionAxis == ProjectionAxis::X)
+		corners = { QVector3D(minimum.x(), minimum.y(), maximum.z()), QVector3D(minimum.x(), maximum.y(), maximum.z()), QVector3D(minimum.x(), maximum.y(), minimum.z()), minimum };
+	else if (projectionAxis == ProjectionAxis::Y)
+		corners = { QVector3D(minimum.x(), minimum.y(), maximum.z()), QVector3D(maximum.x(), minimum.y(), maximum.z()), QVector3D(maximum.x(), minimum.y(), minimum.z()), minimum };
+	else
+		corners = { minimum, QVector3D(maximum.x(), minimum.y(), minimum.z()), QVector3D(maximum.x(), maximum.y(), minimum.z()), QVector3D(minimum.x(), maximum.y(), minimum.z()) };
+
+	const float texcoords[4][2] = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f } };
+	const int indices[6] = { 0, 1, 2, 0, 2, 3 };
+
+	std::array<float, 30> projectionImageVertexData;
+
+	for (int i = 0; i < 6; ++i)
+	{
+		projectionImageVertexData[i * 5 + 0] = corners[indices[i]].x();
+		projectionImageVertexData[i * 5 + 1] = corners[indices[i]].y();
+		projectionImageVertexData[i * 5 + 2] = corners[indices[i]].z();
+		projectionImageVertexData[i * 5 + 3] = texcoords[indices[i]][0];
+		projectionImageVertexData[i * 5 + 4] = texcoords[indices[i]][1];
+	}
+
+	projectionImage.vbo.bind();
+	projectionImage.vbo.write(0, projectionImageVertexData.data(), sizeof(projectionImageVertexData));
+	projectionImage.vbo.release();
+
+	projectionImageIsValid = true;
+}
+
+// interleaves the cached per-channel projections of the current axis and type into RGB, only the part inside the crop box is kept
+// the cached projections go through the whole loaded volume, so the crop box limits the rays only after it has been committed
+// returns false while the projections are still being generated
+bool RenderWidget::generateProjectionData(std::vector<float>& projectionData, uint32_t& projectionWidth, uint32_t& projectionHeight)
+{
+	ProjectionImage channels[3];
+
+	for (uint32_t c = 0; c < 3; ++c)
+	{
+		if (!volume->getAxisProjection(projectionAxis, projectionType, c, channels[c]))
+			return false;
+	}
+
+	std::array<int, 3> minimum;
+	std::array<int, 3> maximum;
+	getCropVoxelRange(minimum, maximum);
+
+	// x projections are (y, z) images, y projections are (x, z) images and z projections are (x, y) images
+	int columnAxis = (projectionAxis == ProjectionAxis::X) ? 1 : 0;
+	int rowAxis = (projectionAxis == ProjectionAxis::Z) ? 1 : 2;
+
+	projectionWidth = uint32_t(maximum[columnAxis] - minimum[columnAxis]);
+	projectionHeight = uint32_t(maximum[rowAxis] - minimum[rowAxis]);
+	projectionData.resize(uint64_t(projectionWidth) * projectionHeight * 3);
+
+	for (uint32_t y = 0; y < projectionHeight; ++y)
+	{
+		for (uint32_t x = 0; x < projectionWidth; ++x)
+		{
+			uint64_t source = uint64_t(minimum[rowAxis] + y) * channels[0].width + minimum[columnAxis] + x;
+			uint64_t destination = uint64_t(y) * projectionWidth + x;
+
+			for (uint32_t c = 0; c < 3; ++c)
+				projectionData[destination * 3 + c] = channels[c].data[source];
+		}
+	}
+
+	return true;
+}
+
+// from the crop box to voxels of the loaded volume, the z axis is flipped in sampling.frag
+void RenderWidget::getCropVoxelRange(std::array<int, 3>& minimum, std::array<int, 3>& maximum) const
+{
+	QVector3D worldOrigin = volume->getWorldOrigin();
+	QVector3D worldExtent = volume->getWorldExtent();
+	const int sizes[3] = { volume->getWidth(), volume->getHeight(), volume->getDepth() };
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		float start = (cropMinimum[axis] - worldOrigin[axis]) / worldExtent[axis];
+		float end = (cropMaximum[axis] - worldOrigin[axis]) / worldExtent[axis];
+
+		if (axis == 2)
+		{
+			float flippedStart = 1.0f - end;
+			end = 1.0f - start;
+			start = flippedStart;
+		}
+
+		minimum[axis] = std::min(std::max(int(std::floor(start * sizes[axis])), 0), sizes[axis] - 1);
+		maximum[axis] = std::min(std::max(int(std::ceil(end * sizes[axis])), minimum[axis] + 1), sizes[axis]);
+	}
+}
+
+void RenderWidget::saveProjection()
+{
+	if (volume == nullptr)
+		return;
+
+	if (projectionAxis == ProjectionAxis::VIEW)
+	{
+		MainWindow::getLog().logWarning("Only axis aligned projections can be saved");
+		return;
+	}
+
+	const char* axisNames[] = { "view", "x", "y", "z" };
+	const char* typeNames[] = { "maximum", "minimum", "mean", "sum" };
+
+	QFileInfo imageFileInfo(QString::fromStdString(settings.imageLoaderInfo.fileName));
+	QString fileName = QString("%1/%2_projection_%3_%4.tif").arg(imageFileInfo.absolutePath(), imageFileInfo.completeBaseName(), axisNames[int(projectionAxis)], typeNames[int(projectionType)]);
+
+	std::vector<float> projectionData;
+	uint32_t projectionWidth, projectionHeight;
+
+	if (!generateProjectionData(projectionData, projectionWidth, projectionHeight))
+	{
+		MainWindow::getLog().logWarning("The axis projections are still being generated, save again once they are shown");
+		return;
+	}
+
+	ImageSaver::saveToFloatTiff(fileName.toStdString(), projectionWidth, projectionHeight, projectionData);
+}
+
+ShaderDefines RenderWidget::getSamplingDefines() const
+{
+	if (volume != nullptr)
+		return volume->getShaderDefines();
+
+	return { { "TEXTURE_FORMAT", int(TextureFormat::UNCOMPRESSED) } };
+}
+
+// sums are shown relative to a ray through the largest dimension of the volume
+float RenderWidget::getProjectionScale() const
+{
+	float scale = projectionGain;
+
+	if (projectionType == ProjectionType::SUM && volume != nullptr)
+		scale /= float(std::max(volume->getWidth(), std::max(volume->getHeight(), volume->getDepth())));
+
+	return scale;
+}
+
+// distance along the direction that moves at most one voxel along any of the volume axes
+float RenderWidget::getVoxelSpacing(const QVector3D& direction) const
+{
+	QVector3D voxelSize = volume->getWorldExtent() / QVector3D(volume->getWidth(), volume->getHeight(), volume->getDepth());
+	float spacing = std::numeric_limits<float>::max();
+
+	for (int i = 0; i < 3; ++i)
+	{
+		if (std::abs(direction[i]) > 0.0001f)
+			spacing = std::min(spacing, voxelSize[i] / std::abs(direction[i]));
+	}
+
+	return spacing;
+}
+
+// one sample per voxel crossed along the normal, capped so that thick slabs still render at interactive rates
+int RenderWidget::getSlabSampleCount() const
+{
+	return getSlabSampleCount(planeNormal);
+}
+
+int RenderWidget::getSlabSampleCount(const QVector3D& normal) const
+{
+	if (slabThickness <= 0.0f || volume == nullptr)
+		return 1;
+
+	int sampleCount = int(std::ceil(slabThickness / getVoxelSpacing(normal))) + 1;
+
+	return std::min(std::max(sampleCount, 1), maxSlabSampleCount);
+}
+
+QString RenderWidget::getRenderModeName() const
+{
+	if (sliceStreamer != nullptr)
+	{
+		int cachedCount = int(std::count_if(streamedSliceIndices.begin(), streamedSliceIndices.end(), [](int index) { return index >= 0; }));
+		return QString("Streamed slice %1/%2 (%3 cached)").arg(sliceStreamer->getCurrentSlice() + 1).arg(sliceStreamer->getDepth()).arg(cachedCount);
+	}
+
+	if (renderMode == RenderMode::VOLUME)
+		return "Volume";
+
+	if (renderMode == RenderMode::PROJECTION)
+	{
+		const char* axisNames[] = { "view", "x axis", "y axis", "z axis" };
+		const char* typeNames[] = { "maximum", "minimum", "mean", "sum" };
+
+		return QString("Projection (%1, %2)").arg(typeNames[int(projectionType)], axisNames[int(projectionAxis)]);
+	}
+
+	QString name = "Plane";
+
+	if (slabThickness > 0.0f)
+	{
+		QLocale locale(QLocale::English);
+		name = QString("Plane (%1 slab %2, %3 samples)").arg(slabMode == SlabMode::MAXIMUM ? "maximum" : "mean", locale.toString(slabThickness * settings.imageWidth, 'e', 3)).arg(getSlabSampleCount());
+	}
+
+	if (!pinnedPlanes.empty())
+		name += QString(" + %1 pinned").arg(pinnedPlanes.size()) + ((selectedPlane >= 0) ? QString(", #%1 selected").arg(selectedPlane + 1) : QString());
+
+	return name;
+}
+
+// draws the current pass repeatedly with and without empty space skipping and logs the average GPU time of both
+void RenderWidget::benchmarkEmptySpaceSkipping()
+{
+	if (volume == nullptr)
+		return;
+
+	const int frameCount = 20;
+	bool originalSkipEmptySpace = skipEmptySpace;
+	double frameTimes[2] = { 0.0, 0.0 };
+
+	for (int i = 0; i < 2; ++i)
+	{
+		skipEmptySpace = (i == 1);
+		updatePlaneVertices();
+
+		auto renderPass = [&]()
+		{
+			if (renderMode == RenderMode::VOLUME)
+				renderRayMarch();
+			else if (renderMode == RenderMode::PROJECTION)
+				renderProjection();
+			else if (planeInstanceCount > 0)
+				renderPlane();
+		};
+
+		// the first draw may compile the shader variant, which is not part of the frame time
+		renderPass();
+		glFinish();
+
+		QElapsedTimer timer;
+		timer.start();
+
+		for (int j = 0; j < frameCount; ++j)
+			renderPass();
+
+		glFinish();
+
+		frameTimes[i] = timer.nsecsElapsed() / 1000000.0 / frameCount;
+	}
+
+	skipEmptySpace = originalSkipEmptySpace;
+	updatePlaneVertices();
+
+	QVector3D threshold = (renderMode == RenderMode::VOLUME) ? transferLow : ((renderMode == RenderMode::PROJECTION) ? QVector3D() : displayThreshold);
+	float emptyFraction = MacrocellGenerator::getEmptyFraction(volume->getMacrocellGrid(), { threshold.x(), threshold.y(), threshold.z() });
+
+	MainWindow::getLog().logInfo("Empty space skipping (%s, %.1f %% of the cells empty): %.2f ms -> %.2f ms per frame (%.2fx)", getRenderModeName().toStdString(), emptyFraction * 100.0f, frameTimes[0], frameTimes[1], frameTimes[0] / std::max(frameTimes[1], 0.001));
+}
+
+void RenderWidget::updateLogic()
+{
+	float timeStep = timeStepTimer.nsecsElapsed() / 1000000000.0f;
+	timeStepTimer.restart();
+
+	finishCrop();
+
+	camera.updateKeys(keyboardHelper, timeStep);
+	float moveSpeed = camera.getMoveSpeed(keyboardHelper);
+
+	if (keyboardHelper.keyIsDown(Qt::Key_R))
+	{
+		if (keyboardHelper.keyIsDown(Qt::Key_Control))
+			camera.resetSpeeds();
+		else
+			resetCameraPosition();
+	}
+
+	if (keyboardHelper.keyIsDownOnce(Qt::Key_B))
+		renderBackground = !renderBackground;
+
+	if (keyboardHelper.keyIsDownOnce(Qt::Key_C))
+		renderCoordinates = !renderCoordinates;
+
+	if (keyboardHelper.keyIsDownOnce(Qt::Key_V))
+		renderMiniCoordinates = !renderMiniCoordinates;
+
+	if (keyboardHelper.keyIsDownOnce(Qt::Key_T))
+		renderText = !renderText;
+
+	if (keyboardHelper.keyIsDownOnce(Qt::Key_M))
+		renderMode = RenderMode((int(renderMode) + 1) % 3);
+
+	if (keyboardHelper.keyIsDownOnce(Qt::Key_X))
+	{
+		if (renderMode == RenderMode::PROJECTION)
+			projectionGain *= 2.0f;
+		else
+			transferOpacity = MathHelper::clamp(transferOpacity * 2.0f, 0.0f, 1.0f);
+	}
+
+	if (keyboardHelper.keyIsDownOnce(Qt::Key_Z))
+	{
+		if (renderMode == RenderMode::PROJECTION)
+			projectionGain *= 0.5f;
+		else
+			transferOpacity *= 0.5f;
+	}
+
+	if (keyboardHelper.keyIsDownOnce(Qt::Key_P))
+	{
+		if (keyboardHelper.keyIsDown(Qt::Key_Control))
+			saveProjection();
+		else
+		{
+			projectionType = ProjectionType((int(projectionType) + 1) % 4);
+			projectionImageIsValid = false;
+		}
+	}
+
+	if (keyboardHelper.keyIsDownOnce(Qt::Key_1))
+		slabMode = (slabMode == SlabMode::MAXIMUM) ? SlabMode::MEAN : SlabMode::MAXIMUM;
+
+	if (keyboardHelper.keyIsDownOnce(Qt::Key_F2))
+	{
+		if (keyboardHelper.keyIsDown(Qt::Key_Control))
+			frameTimer.saveToCsv(QString("frametimes_%1.csv").arg(QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss")).toStdString());
+		else
+			renderTimings = !renderTimings;
+	}
+
+	if (keyboardHelper.keyIsDownOnce(Qt::Key_F3))
+	{
+		if (!recordingCameraPath)
+		{
+			recordedCameraPath.clear();
+			cameraPathTimer.start();
+			recordingCameraPath = true;
+
+			MainWindow::getLog().logInfo("Recording camera path");
+		}
+		else
+		{
+			recordingCameraPath = false;
+			recordedCameraPath.saveToFile(QString("camerapath_%1.txt").arg(QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss")).toStdString());
+		}
+	}
+
+	if (keyboardHelper.keyIsDownOnce(Qt::Key_F4))
+	{
+		viewLayout = (viewLayout == ViewLayout::SINGLE) ? ViewLayout::QUAD : ViewLayout::SINGLE;
+		activeView = -1;
+		updateSceneViewport();
+	}
+
+	if (keyboardHelper.keyIsDownOnce(Qt::Key_Insert))
+		pinPlane();
+
+	if (keyboardHelper.keyIsDownOnce(Qt::Key_Delete))
+		unpinPlane();
+
+	// cycles through the pinned planes and back to none
+	if (keyboardHelper.keyIsDownOnce(Qt::Key_Home) && !pinnedPlanes.empty())
+		selectedPlane = (selectedPlane + 2) % (int(pinnedPlanes.size()) + 1) - 1;
+
+	if (sliceStreamer != nullptr)
+	{
+		int sliceStep = keyboardHelper.keyIsDown(Qt::Key_Shift) ? 10 : 1;
+
+		if (keyboardHelper.keyIsDownOnce(Qt::Key_F6))
+			changeStreamedSlice(sliceStep);
+
+		if (keyboardHelper.keyIsDownOnce(Qt::Key_F7))
+			changeStreamedSlice(-sliceStep);
+	}
+
+	if (selectedPlane >= 0)
+	{
+		IntersectionPlane& intersectionPlane = pinnedPlanes[selectedPlane];
+
+		if (keyboardHelper.keyIsDownOnce(Qt::Key_Return))
+		{
+			intersectionPlane.position = planePosition;
+			intersectionPlane.normal = planeNormal;
+		}
 
-	// BACKGROUND //
+		if (keyboardHelper.keyIsDown(Qt::Key_PageUp))
+		{
+			intersectionPlane.position += intersectionPlane.normal * moveSpeed * timeStep;
+			accumulationSampleCount = 0;
+		}
 
-	if (renderBackground)
+		if (keyboardHelper.keyIsDown(Qt::Key_PageDown))
+		{
+			intersectionPlane.position -= intersectionPlane.normal * moveSpeed * timeStep;
+			accumulationSampleCount = 0;
+		}
+	}
+
+	if (keyboardHelper.keyIsDownOnce(Qt::Key_F5))
 	{
-		background.program.bind();
-		background.vao.bind();
+		if (keyboardHelper.keyIsDown(Qt::Key_Control))
+			commitCrop();
+		else if (keyboardHelper.keyIsDown(Qt::Key_Shift))
+			resetCrop();
+		else
+		{
+			// cycles through the faces -x, +x, -y, +y, -z, +z and back to none
+			cropFace = (cropFace + 2) % 7 - 1;
+			updateCropVertices();
+		}
+	}
 
-		glDrawArrays(GL_TRIANGLES, 0, 6);
+	if (cropFace >= 0)
+	{
+		if (keyboardHelper.keyIsDown(Qt::Key_BracketRight))
+			moveCropFace(moveSpeed * timeStep);
 
-		background.vao.release();
-		background.program.release();
+		if (keyboardHelper.keyIsDown(Qt::Key_BracketLeft))
+			moveCropFace(-moveSpeed * timeStep);
 	}
 
-	// COORDINATES //
-
-	if (renderCoordinates)
+	if (keyboardHelper.keyIsDownOnce(Qt::Key_N))
 	{
-		coordinates.program.bind();
-		coordinates.vao.bind();
+		projectionAxis = ProjectionAxis((int(projectionAxis) + 1) % 4);
+		projectionImageIsValid = false;
+	}
 
-		coordinates.program.setUniformValue("mvp", coordinates.mvp);
+	if (keyboardHelper.keyIsDownOnce(Qt::Key_Period))
+		changeThreshold(0.05f);
 
-		glDrawArrays(GL_LINES, 0, 6);
+	if (keyboardHelper.keyIsDownOnce(Qt::Key_Comma))
+		changeThreshold(-0.05f);
 
-		coordinates.vao.release();
-		coordinates.program.release();
+	if (keyboardHelper.keyIsDownOnce(Qt::Key_G))
+	{
+		if (keyboardHelper.keyIsDown(Qt::Key_Control))
+			runEmptySpaceSkippingBenchmark = true;
+		else
+			skipEmptySpace = !skipEmptySpace;
 	}
 
+	// the axis projections are generated on a worker thread, the view is not refined before they are shown
+	if (renderMode == RenderMode::PROJECTION && projectionAxis != ProjectionAxis::VIEW && !projectionImageIsValid)
+		accumulationSampleCount = 0;
+
+	camera.updateMatrices();
+
+	// accumulated frames are offset by a fraction of a pixel, the picking and the mini coordinates use the unjittered projection
+	QMatrix4x4 jitteredProjectionMatrix = getJitterMatrix() * projectionMatrix;
+
 	// CUBE //
 
-	cube.program.bind();
-	cube.vao.bind();
+	cube.modelMatrix.setToIdentity();
+	cube.mvp = jitteredProjectionMatrix * camera.viewMatrix * cube.modelMatrix;
 
-	cube.program.setUniformValue("lineColor", settings.lineColor);
-	cube.program.setUniformValue("mvp", cube.mvp);
+	// CROSSHAIR //
 
-	glDrawArrays(GL_LINES, 0, 24);
+	crosshairMvp = jitteredProjectionMatrix * camera.viewMatrix;
 
-	cube.vao.release();
-	cube.program.release();
+	if (viewLayout == ViewLayout::QUAD)
+		sliceViews.updateCrosshairVertices(getBoxMaximum());
+
+	// CROP BOX //
+
+	cropBox.modelMatrix.setToIdentity();
+	cropBox.mvp = jitteredProjectionMatrix * camera.viewMatrix * cropBox.modelMatrix;
+
+	// STREAMED SLICE //
+
+	streamedSlice.modelMatrix.setToIdentity();
+	streamedSlice.mvp = jitteredProjectionMatrix * camera.viewMatrix * streamedSlice.modelMatrix;
+
+	updateStreamedSlices();
 
 	// PLANE //
 
-	plane.program.bind();
-	plane.vao.bind();
+	planePosition = camera.position + camera.planeDistance * camera.forward;
+	planeNormal = -camera.forward;
 
-	if (volumeTexture.isCreated())
-		volumeTexture.bind();
+	plane.modelMatrix.setToIdentity();
+	plane.mvp = jitteredProjectionMatrix * camera.viewMatrix * plane.modelMatrix;
 
-	plane.program.setUniformValue("tex0", 0);
-	plane.program.setUniformValue("modelMatrix", plane.modelMatrix);
-	plane.program.setUniformValue("mvp", plane.mvp);
-	plane.program.setUniformValue("scaleY", settings.imageHeight / settings.imageWidth);
-	plane.program.setUniformValue("scaleZ", settings.imageDepth / settings.imageWidth);
+	updatePlaneVertices();
 
-	glDrawArrays(GL_TRIANGLES, 0, 6);
+	// PLANE LINES //
 
-	if (volumeTexture.isCreated())
-		volumeTexture.release();
+	planeLines.modelMatrix.setToIdentity();
+	planeLines.mvp = jitteredProjectionMatrix * camera.viewMatrix * planeLines.modelMatrix;
 
-	plane.vao.release();
-	plane.program.release();
+	// RAY MARCH //
 
-	// MINI COORDINATES //
+	rayMarch.modelMatrix.setToIdentity();
+	rayMarch.mvp = jitteredProjectionMatrix * camera.viewMatrix * rayMarch.modelMatrix;
 
-	if (renderMiniCoordinates)
-	{
-		glViewport(-50, -50, 200, 200);
+	// PROJECTION //
 
-		miniCoordinates.program.bind();
-		miniCoordinates.vao.bind();
+	projection.modelMatrix.setToIdentity();
+	projection.mvp = jitteredProjectionMatrix * camera.viewMatrix * projection.modelMatrix;
 
-		miniCoordinates.program.setUniformValue("mvp", miniCoordinates.mvp);
+	projectionImage.modelMatrix.setToIdentity();
+	projectionImage.mvp = jitteredProjectionMatrix * camera.viewMatrix * projectionImage.modelMatrix;
 
-		glDrawArrays(GL_LINES, 0, 6);
+	// COORDINATES //
 
-		miniCoordinates.vao.release();
-		miniCoordinates.program.release();
+	coordinates.modelMatrix.setToIdentity();
+	coordinates.mvp = jitteredProjectionMatrix * camera.viewMatrix * coordinates.modelMatrix;
 
-		glViewport(0, 0, width(), height());
-	}
+	// MINI COORDINATES //
+
+	QVector3D miniCoordPosition = camera.position + 1.0f * camera.forward;
+	QMatrix4x4 miniCoordProjection;
+	miniCoordProjection.perspective(45.0f, 1.0f, 0.1f, 10.0f);
+	
+	miniCoordinates.modelMatrix.setToIdentity();
+	miniCoordinates.modelMatrix.scale(0.2f);
+	miniCoordinates.modelMatrix.setColumn(3, QVector4D(miniCoordPosition.x(), miniCoordPosition.y(), miniCoordPosition.z(), 1.0f));
+	miniCoordinates.mvp = miniCoordProjection * camera.viewMatrix * miniCoordinates.modelMatrix;
 
 	// MEASUREMENT //
 
-	if (mouseMode == MouseMode::MEASURE)
+	if (camera.mouseMode == MouseMode::MEASURE)
 	{
-		measurement.program.bind();
-		measurement.vao.bind();
-
-		measurement.program.setUniformValue("lineColor", settings.lineColor);
-		measurement.program.setUniformValue("mvp", measurement.mvp);
+		measurement.modelMatrix.setToIdentity();
+		measurement.mvp = jitteredProjectionMatrix * camera.viewMatrix * measurement.modelMatrix;
 
-		glDrawArrays(GL_LINES, 0, 2);
+		const QVector3D measurementVertexData[] = { measureStartPoint, measureEndPoint };
 
-		measurement.vao.release();
-		measurement.program.release();
+		measurement.vbo.bind();
+		measurement.vbo.write(0, measurementVertexData, sizeof(measurementVertexData));
+		measurement.vbo.release();
 	}
+}
 
-	// TEXT //
+void RenderWidget::resetCameraPosition()
+{
+	camera.resetPosition(getBoxMaximum());
+	sliceViews.reset(getBoxMaximum());
+}
 
-	if (renderText)
+// the period/comma keys move the threshold of whatever is currently rendered
+void RenderWidget::changeThreshold(float amount)
+{
+	QVector3D step(amount, amount, amount);
+
+	if (renderMode == RenderMode::VOLUME)
+		transferLow = MathHelper::clamp(transferLow + step, 0.0f, 0.95f);
+	else
 	{
-		QLocale locale(QLocale::English);
+		displayThreshold = MathHelper::clamp(displayThreshold + step, 0.0f, 0.95f);
+		updateOccupiedBounds();
+	}
+}
 
-		QVector3D realCameraPosition = cameraPosition * settings.imageWidth;
-		float realMeasuredDistance = measureDistance * settings.imageWidth;
+void RenderWidget::updateOccupiedBounds()
+{
+	hasOccupiedBounds = false;
 
-		textImage.fill(QColor(0, 0, 0, 0));
+	if (volume == nullptr)
+		return;
 
-		QPainter painter(&textImage);
-		painter.setRenderHint(QPainter::Antialiasing);
-		painter.setRenderHint(QPainter::TextAntialiasing);
-		painter.setRenderHint(QPainter::SmoothPixmapTransform);
-		painter.setRenderHint(QPainter::HighQualityAntialiasing);
+	std::array<float, 3> minimum;
+	std::array<float, 3> maximum;
 
-		painter.setPen(QColor(0, 0, 0, 96));
-		painter.setBrush(QColor(0, 0, 0, 64));
-		painter.drawRoundRect(-20, -360, 400, 400, 10, 10);
+	if (!MacrocellGenerator::getOccupiedBounds(volume->getMacrocellGrid(), { displayThreshold.x(), displayThreshold.y(), displayThreshold.z() }, minimum, maximum))
+		return;
 
-#ifdef __APPLE__
-		int textSize = 12;
-#else
-		int textSize = 10;
-#endif
+	// from normalized texcoords to world coordinates, the z axis is flipped in sampling.frag
+	QVector3D worldOrigin = volume->getWorldOrigin();
+	QVector3D worldExtent = volume->getWorldExtent();
 
-		QFont font("Roboto Mono", textSize, QFont::Normal);
-		font.setHintingPreference(QFont::PreferFullHinting);
-		font.setStyleStrategy(QFont::PreferAntialias);
+	occupiedMinimum = worldOrigin + worldExtent * QVector3D(minimum[0], minimum[1], 1.0f - maximum[2]);
+	occupiedMaximum = worldOrigin + worldExtent * QVector3D(maximum[0], maximum[1], 1.0f - minimum[2]);
+	deskewBounds(occupiedMinimum, occupiedMaximum);
+	hasOccupiedBounds = true;
+}
 
-		painter.setBrush(Qt::NoBrush);
-		painter.setPen(QColor(255, 255, 255, 255));
-		painter.setFont(font);
-		
-		painter.drawText(5, 15, QString("Position: (%1, %2, %3)").arg(locale.toString(realCameraPosition.x(), 'e', 3), locale.toString(realCameraPosition.y(), 'e', 3), locale.toString(realCameraPosition.z(), 'e', 3)));
-		painter.drawText(5, 32, QString("Distance: %1").arg(locale.toString(realMeasuredDistance, 'e', 3)));
+void RenderWidget::updatePlaneVertices()
+{
+	QVector3D boxMaximum = getBoxMaximum();
 
-		textTexture.bind();
-		textTexture.setData(QOpenGLTexture::RGBA, QOpenGLTexture::UInt8, textImage.bits());
+	IntersectionPlane cameraPlane;
+	cameraPlane.position = planePosition;
+	cameraPlane.normal = planeNormal;
 
-		text.program.bind();
-		text.vao.bind();
+	std::vector<IntersectionPlane> intersectionPlanes = { cameraPlane };
+	intersectionPlanes.insert(intersectionPlanes.end(), pinnedPlanes.begin(), pinnedPlanes.end());
 
-		text.program.setUniformValue("tex0", 0);
+	std::array<QVector3D, 6 * MAX_PLANE_COUNT> planeLinesVertexData;
+	std::vector<PlaneInstance> planeInstances;
+	planeLinesVertexCounts.fill(0);
 
-		glDrawArrays(GL_TRIANGLES, 0, 6);
+	for (size_t i = 0; i < intersectionPlanes.size(); ++i)
+	{
+		const IntersectionPlane& intersectionPlane = intersectionPlanes[i];
 
-		text.vao.release();
-		text.program.release();
+		std::array<QVector3D, 6> planeVertexData;
+		planeLinesVertexCounts[i] = generatePlaneVertices(planeVertexData, intersectionPlane, QVector3D(0.0f, 0.0f, 0.0f), boxMaximum);
+		std::copy(planeVertexData.begin(), planeVertexData.end(), planeLinesVertexData.begin() + i * 6);
 
-		textTexture.release();
-	}
-}
+		// the outline shows the whole volume, but the textured part is only drawn inside the crop box where some cells are not empty
+		QVector3D clipMinimum = cropMinimum;
+		QVector3D clipMaximum = cropMaximum;
+		bool clipIsEmpty = false;
 
-void RenderWidget::updateLogic()
-{
-	float timeStep = timeStepTimer.nsecsElapsed() / 1000000000.0f;
-	timeStepTimer.restart();
+		// a slab can reach occupied cells that the plane itself does not intersect
+		if (skipEmptySpace && volume != nullptr)
+		{
+			float slabExtent = slabThickness * 0.5f;
+			clipIsEmpty = !hasOccupiedBounds;
+
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				clipMinimum[axis] = std::max(clipMinimum[axis], occupiedMinimum[axis] - slabExtent);
+				clipMaximum[axis] = std::min(clipMaximum[axis], occupiedMaximum[axis] + slabExtent);
+				clipIsEmpty = clipIsEmpty || clipMinimum[axis] >= clipMaximum[axis];
+			}
+		}
 
-	if (keyboardHelper.keyIsDownOnce(Qt::Key_Y))
-		moveSpeedModifier *= 2.0f;
+		int planeVertexCount = clipIsEmpty ? 0 : generatePlaneVertices(planeVertexData, intersectionPlane, clipMinimum, clipMaximum);
 
-	if (keyboardHelper.keyIsDownOnce(Qt::Key_H))
-		moveSpeedModifier *= 0.5f;
+		if (planeVertexCount < 3)
+			continue;
 
-	if (keyboardHelper.keyIsDownOnce(Qt::Key_U))
-		mouseMoveSpeedModifier *= 2.0f;
+		PlaneInstance planeInstance;
 
-	if (keyboardHelper.keyIsDownOnce(Qt::Key_J))
-		mouseMoveSpeedModifier *= 0.5f;
+		for (int j = 0; j < 6; ++j)
+			planeInstance.vertices[j] = planeVertexData[std::min(j, planeVertexCount - 1)];
+
+		planeInstance.slabNormal = intersectionPlane.normal;
+		planeInstance.slabSampleCount = float(getSlabSampleCount(intersectionPlane.normal));
+		planeInstances.push_back(planeInstance);
+	}
 
-	if (keyboardHelper.keyIsDownOnce(Qt::Key_I))
-		mouseRotateSpeedModifier *= 2.0f;
+	// front to back by the polygon centers, so that the depth test rejects most of what is hidden before it is shaded
+	auto getCameraDistance = [&](const PlaneInstance& planeInstance)
+	{
+		QVector3D center;
 
-	if (keyboardHelper.keyIsDownOnce(Qt::Key_K))
-		mouseRotateSpeedModifier *= 0.5f;
+		for (const QVector3D& vertex : planeInstance.vertices)
+			center += vertex;
 
-	if (keyboardHelper.keyIsDownOnce(Qt::Key_O))
-		mouseWheelStepSizeModifier *= 2.0f;
+		return (center / 6.0f - camera.position).lengthSquared();
+	};
 
-	if (keyboardHelper.keyIsDownOnce(Qt::Key_L))
-		mouseWheelStepSizeModifier *= 0.5f;
+	std::sort(planeInstances.begin(), planeInstances.end(), [&](const PlaneInstance& p1, const PlaneInstance& p2)
+	{
+		return getCameraDistance(p1) < getCameraDistance(p2);
+	});
 
-	float moveSpeed = moveSpeedModifier;
+	planeInstanceCount = int(planeInstances.size());
 
-	if (keyboardHelper.keyIsDown(Qt::Key_Shift))
-		moveSpeed *= 2.0f;
+	if (planeInstanceCount > 0)
+	{
+		plane.vbo.bind();
+		plane.vbo.write(0, planeInstances.data(), planeInstanceCount * sizeof(PlaneInstance));
+		plane.vbo.release();
+	}
 
-	if (keyboardHelper.keyIsDown(Qt::Key_Control))
-		moveSpeed *= 0.5f;
+	planeLines.vbo.bind();
+	planeLines.vbo.write(0, planeLinesVertexData.data(), int(intersectionPlanes.size() * 6 * sizeof(QVector3D)));
+	planeLines.vbo.release();
+}
 
-	if (keyboardHelper.keyIsDown(Qt::Key_R))
+// the camera plane is left where it is as a new pinned plane, which is then selected
+void RenderWidget::pinPlane()
+{
+	if (int(pinnedPlanes.size()) + 1 >= MAX_PLANE_COUNT)
 	{
-		if (keyboardHelper.keyIsDown(Qt::Key_Control))
-			resetCameraSpeeds();
-		else
-			resetCameraPosition();
+		MainWindow::getLog().logWarning("At most %d planes can be shown at the same time", int(MAX_PLANE_COUNT));
+		return;
 	}
 
-	if (keyboardHelper.keyIsDownOnce(Qt::Key_B))
-		renderBackground = !renderBackground;
+	IntersectionPlane pinnedPlane;
+	pinnedPlane.position = planePosition;
+	pinnedPlane.normal = planeNormal;
 
-	if (keyboardHelper.keyIsDownOnce(Qt::Key_C))
-		renderCoordinates = !renderCoordinates;
+	pinnedPlanes.push_back(pinnedPlane);
+	selectedPlane = int(pinnedPlanes.size()) - 1;
+}
 
-	if (keyboardHelper.keyIsDownOnce(Qt::Key_V))
-		renderMiniCoordinates = !renderMiniCoordinates;
+void RenderWidget::unpinPlane()
+{
+	if (selectedPlane < 0)
+		return;
 
-	if (keyboardHelper.keyIsDownOnce(Qt::Key_T))
-		renderText = !renderText;
+	pinnedPlanes.erase(pinnedPlanes.begin() + selectedPlane);
+	selectedPlane = pinnedPlanes.empty() ? -1 : std::min(selectedPlane, int(pinnedPlanes.size()) - 1);
+}
 
-	if (keyboardHelper.keyIsDown(Qt::Key_W) || keyboardHelper.keyIsDown(Qt::Key_Up))
-		cameraPosition += cameraForward * moveSpeed * timeStep;
+bool RenderWidget::isCropActive() const
+{
+	QVector3D boxMaximum = getBoxMaximum();
+	return cropFace >= 0 || cropMinimum != QVector3D(0.0f, 0.0f, 0.0f) || cropMaximum != boxMaximum || (volume != nullptr && volume->isCropped());
+}
 
-	if (keyboardHelper.keyIsDown(Qt::Key_S) || keyboardHelper.keyIsDown(Qt::Key_Down))
-		cameraPosition -= cameraForward * moveSpeed * timeStep;
+// positive distances move the selected face outwards, it stops before the opposite face and at the edge of the loaded voxels
+void RenderWidget::moveCropFace(float distance)
+{
+	QVector3D minimum(0.0f, 0.0f, 0.0f);
+	QVector3D maximum = getBoxMaximum();
 
-	if (keyboardHelper.keyIsDown(Qt::Key_D) || keyboardHelper.keyIsDown(Qt::Key_Right))
-		cameraPosition += cameraRight * moveSpeed * timeStep;
+	// a committed crop can only be shrunk further, growing it back needs the whole volume again
+	if (volume != nullptr && volume->isCropped())
+	{
+		minimum = volume->getWorldOrigin();
+		maximum = minimum + volume->getWorldExtent();
+		deskewBounds(minimum, maximum);
+	}
 
-	if (keyboardHelper.keyIsDown(Qt::Key_A) || keyboardHelper.keyIsDown(Qt::Key_Left))
-		cameraPosition -= cameraRight * moveSpeed * timeStep;
+	const float minimumSize = 0.001f;
+	int axis = cropFace / 2;
 
-	if (keyboardHelper.keyIsDown(Qt::Key_E))
-		cameraPosition += cameraUp * moveSpeed * timeStep;
+	if (cropFace % 2 == 0)
+		cropMinimum[axis] = std::min(std::max(cropMinimum[axis] - distance, minimum[axis]), cropMaximum[axis] - minimumSize);
+	else
+		cropMaximum[axis] = std::max(std::min(cropMaximum[axis] + distance, maximum[axis]), cropMinimum[axis] + minimumSize);
 
-	if (keyboardHelper.keyIsDown(Qt::Key_Q))
-		cameraPosition -= cameraUp * moveSpeed * timeStep;
+	accumulationSampleCount = 0;
+	projectionImageIsValid = false;
+	updateCropVertices();
+}
 
-	updateCamera();
+// the textures are replaced by ones that only have the voxels inside the crop box, everything outside of it is gone until the crop is reset
+// the cropped voxels are read on a worker thread, the old volume is shown until finishCrop uploads them
+void RenderWidget::commitCrop()
+{
+	if (volume == nullptr || pendingCrop != nullptr)
+		return;
 
-	// CUBE //
+	cropTimer.start();
 
-	cube.modelMatrix.setToIdentity();
-	cube.mvp = projectionMatrix * viewMatrix * cube.modelMatrix;
+	// a deskewed crop box needs the raw voxels of every slice that is moved into it
+	QVector3D rawMinimum = cropMinimum;
+	QVector3D rawMaximum = cropMaximum;
+	undeskewBounds(rawMinimum, rawMaximum);
 
-	// PLANE //
+	pendingCrop = volume->createCropped(rawMinimum, rawMaximum);
 
-	planePosition = cameraPosition + planeDistance * cameraForward;
-	planeNormal = -cameraForward;
+	if (pendingCrop != nullptr)
+		MainWindow::getLog().logInfo("Reading the cropped volume in the background");
+}
 
-	plane.modelMatrix = cameraOrientationMatrix;
-	plane.modelMatrix.setColumn(3, QVector4D(planePosition.x(), planePosition.y(), planePosition.z(), 1.0f));
-	plane.mvp = projectionMatrix * viewMatrix * plane.modelMatrix;
+void RenderWidget::finishCrop()
+{
+	if (pendingCrop == nullptr || !pendingCrop->isCropRead())
+		return;
 
-	// COORDINATES //
+	std::shared_ptr<VolumeResource> croppedVolume = pendingCrop;
+	pendingCrop.reset();
 
-	coordinates.modelMatrix.setToIdentity();
-	coordinates.mvp = projectionMatrix * viewMatrix * coordinates.modelMatrix;
+	if (!croppedVolume->finishCrop())
+		return;
 
-	// MINI COORDINATES //
+	MainWindow::getLog().logInfo("Cropped the volume from %dx%dx%d to %dx%dx%d voxels in %d ms", volume->getWidth(), volume->getHeight(), volume->getDepth(), croppedVolume->getWidth(), croppedVolume->getHeight(), croppedVolume->getDepth(), cropTimer.elapsed());
 
-	QVector3D miniCoordPosition = cameraPosition + 1.0f * cameraForward;
-	QMatrix4x4 miniCoordProjection;
-	miniCoordProjection.perspective(45.0f, 1.0f, 0.1f, 10.0f);
-	
-	miniCoordinates.modelMatrix.setToIdentity();
-	miniCoordinates.modelMatrix.scale(0.2f);
-	miniCoordinates.modelMatrix.setColumn(3, QVector4D(miniCoordPosition.x(), miniCoordPosition.y(), miniCoordPosition.z(), 1.0f));
-	miniCoordinates.mvp = miniCoordProjection * viewMatrix * miniCoordinates.modelMatrix;
+	replaceVolume(croppedVolume);
+	cropFace = -1;
+	updateCropVertices();
+}
 
-	// MEASUREMENT //
+// the voxels outside a committed crop are only on the disk anymore, so the whole volume is loaded again
+void RenderWidget::resetCrop()
+{
+	pendingCrop.reset();
 
-	if (mouseMode == MouseMode::MEASURE)
+	if (volume != nullptr && volume->isCropped())
 	{
-		measurement.modelMatrix.setToIdentity();
-		measurement.mvp = projectionMatrix * viewMatrix * measurement.modelMatrix;
+		std::shared_ptr<VolumeResource> newVolume = std::make_shared<VolumeResource>();
 
-		const QVector3D measurementVertexData[] = { measureStartPoint, measureEndPoint };
-
-		measurement.vbo.bind();
-		measurement.vbo.write(0, measurementVertexData, sizeof(measurementVertexData));
-		measurement.vbo.release();
+		if (newVolume->load(settings.imageLoaderInfo, settings.textureFormat, settings.imageWidth, settings.imageHeight, settings.imageDepth))
+			replaceVolume(newVolume);
 	}
+
+	cropMinimum = QVector3D(0.0f, 0.0f, 0.0f);
+	cropMaximum = getBoxMaximum();
+	cropFace = -1;
+	accumulationSampleCount = 0;
+	projectionImageIsValid = false;
+
+	updateCropVertices();
+}
+
+void RenderWidget::releaseStreamedSlices()
+{
+	sliceStreamer.reset();
+
+	for (std::unique_ptr<QOpenGLTexture>& texture : streamedSliceTextures)
+		texture.reset();
+
+	streamedSliceIndices.fill(-1);
 }
 
-void RenderWidget::updateCamera()
+void RenderWidget::changeStreamedSlice(int amount)
 {
-	cameraMatrix = cameraOrientationMatrix;
-	cameraMatrix.setColumn(3, QVector4D(cameraPosition.x(), cameraPosition.y(), cameraPosition.z(), 1.0f));
-	viewMatrix = cameraMatrix.inverted();
+	int depth = int(sliceStreamer->getDepth());
+	int slice = std::min(std::max(int(sliceStreamer->getCurrentSlice()) + amount, 0), depth - 1);
 
-	cameraRight = cameraOrientationMatrix.column(0).toVector3D();
-	cameraUp = cameraOrientationMatrix.column(1).toVector3D();
-	cameraForward = -cameraOrientationMatrix.column(2).toVector3D();
+	sliceStreamer->setCurrentSlice(uint32_t(slice));
+	accumulationSampleCount = 0;
 }
 
-void RenderWidget::resetCameraPosition()
+// uploads the slices that the streamer has read since the previous frame
+void RenderWidget::updateStreamedSlices()
 {
-	float distance = 2.3f;
-	float depth = settings.imageDepth / settings.imageWidth;
+	if (sliceStreamer == nullptr)
+		return;
+
+	int currentSlice = int(sliceStreamer->getCurrentSlice());
+
+	for (const StreamedSlice& slice : sliceStreamer->takeReadSlices())
+	{
+		// a slice that has already left the window would overwrite the texture of one that is still in it
+		if (std::abs(int(slice.index) - currentSlice) > SLICE_PREFETCH_RADIUS)
+			continue;
+
+		size_t textureIndex = slice.index % streamedSliceTextures.size();
+		std::unique_ptr<QOpenGLTexture>& texture = streamedSliceTextures[textureIndex];
+
+		if (texture == nullptr)
+		{
+			texture.reset(new QOpenGLTexture(QOpenGLTexture::Target2D));
+			texture->create();
+			texture->bind();
+			texture->setFormat(QOpenGLTexture::RGBA8_UNorm);
+			texture->setMinMagFilters(QOpenGLTexture::Linear, QOpenGLTexture::Linear);
+			texture->setWrapMode(QOpenGLTexture::ClampToEdge);
+			texture->setSize(int(sliceStreamer->getWidth()), int(sliceStreamer->getHeight()));
+			texture->setMipLevels(1);
+			texture->allocateStorage();
+			texture->release();
+		}
 
-	cameraPosition = QVector3D(0.5f, 0.5f, distance);
-	cameraOrientationMatrix.setToIdentity();
-	cameraOrientationInvMatrix.setToIdentity();
-	planeDistance = distance - depth / 2.0f;
+		texture->setData(QOpenGLTexture::RGBA, QOpenGLTexture::UInt8, slice.data.data());
+		streamedSliceIndices[textureIndex] = int(slice.index);
+		accumulationSampleCount = 0;
+	}
 }
 
-void RenderWidget::resetCameraSpeeds()
+// the nearest slice that has been read is shown until the current one arrives
+void RenderWidget::renderStreamedSlice()
 {
-	moveSpeedModifier = 0.8f;
-	mouseMoveSpeedModifier = 0.001f;
-	mouseRotateSpeedModifier = 0.2f;
-	mouseWheelStepSizeModifier = 0.05f;
+	int currentSlice = int(sliceStreamer->getCurrentSlice());
+	int textureIndex = -1;
+
+	for (int i = 0; i < int(streamedSliceIndices.size()); ++i)
+	{
+		if (streamedSliceIndices[i] >= 0 && (textureIndex < 0 || std::abs(streamedSliceIndices[i] - currentSlice) < std::abs(streamedSliceIndices[textureIndex] - currentSlice)))
+			textureIndex = i;
+	}
+
+	if (textureIndex < 0)
+		return;
+
+	// at the depth of the current slice in the box, the z axis is flipped like in sampling.frag
+	float scaleY = settings.imageHeight / settings.imageWidth;
+	float scaleZ = settings.imageDepth / settings.imageWidth;
+	float z = (1.0f - (currentSlice + 0.5f) / sliceStreamer->getDepth()) * scaleZ;
+	float x = getDeskewOffset(z);
+
+	const QVector3D corners[4] = { QVector3D(x, 0.0f, z), QVector3D(x + 1.0f, 0.0f, z), QVector3D(x + 1.0f, scaleY, z), QVector3D(x, scaleY, z) };
+	const float texcoords[4][2] = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f } };
+	const int indices[6] = { 0, 1, 2, 0, 2, 3 };
+
+	std::array<float, 30> streamedSliceVertexData;
+
+	for (int i = 0; i < 6; ++i)
+	{
+		streamedSliceVertexData[i * 5 + 0] = corners[indices[i]].x();
+		streamedSliceVertexData[i * 5 + 1] = corners[indices[i]].y();
+		streamedSliceVertexData[i * 5 + 2] = corners[indices[i]].z();
+		streamedSliceVertexData[i * 5 + 3] = texcoords[indices[i]][0];
+		streamedSliceVertexData[i * 5 + 4] = texcoords[indices[i]][1];
+	}
+
+	streamedSlice.vbo.bind();
+	streamedSlice.vbo.write(0, streamedSliceVertexData.data(), sizeof(streamedSliceVertexData));
+	streamedSlice.vbo.release();
+
+	streamedSlice.program.bind();
+	streamedSlice.vao.bind();
+	streamedSliceTextures[textureIndex]->bind();
+
+	streamedSlice.program.setUniformValue("mvp", streamedSlice.mvp);
+	streamedSlice.program.setUniformValue("tex0", 0);
+	streamedSlice.program.setUniformValue("displayThreshold", displayThreshold);
+
+	glDrawArrays(GL_TRIANGLES, 0, 6);
+
+	streamedSliceTextures[textureIndex]->release();
+	streamedSlice.vao.release();
+	streamedSlice.program.release();
 }
 
-void RenderWidget::loadCameraSpeeds()
+void RenderWidget::replaceVolume(const std::shared_ptr<VolumeResource>& newVolume)
 {
-	QSettings settings("cellvision.ini", QSettings::IniFormat);
+	volume = newVolume;
 
-	moveSpeedModifier = settings.value("moveSpeedModifier", 0.8f).toFloat();
-	mouseMoveSpeedModifier = settings.value("mouseMoveSpeedModifier", 0.001f).toFloat();
-	mouseRotateSpeedModifier = settings.value("mouseRotateSpeedModifier", 0.2f).toFloat();
-	mouseWheelStepSizeModifier = settings.value("mouseWheelStepSizeModifier", 0.05f).toFloat();
+	updateOccupiedBounds();
+	projectionImageIsValid = false;
+	accumulationSampleCount = 0;
+	sliceViews.invalidate();
+
+	std::lock_guard<std::mutex> lock(settingsMutex);
+	publishedVolume = volume;
 }
 
-void RenderWidget::setMouseMode()
+// the volume programs draw the back faces of the crop box, so the rays start and end inside it
+void RenderWidget::updateCropVertices()
 {
-	if (mouseButtons == Qt::LeftButton)
-		mouseMode = MouseMode::ROTATE;
-	else if (mouseButtons == Qt::RightButton)
-		mouseMode = MouseMode::ORBIT;
-	else if (mouseButtons == Qt::MidButton)
+	std::array<QVector3D, 72> cubeVertexData;
+	std::array<QVector3D, 24> cubeLinesVertexData;
+	generateCubeVertices(cubeVertexData, cubeLinesVertexData, 1.0f, 1.0f, 1.0f, 0.0f);
+
+	QVector3D cropSize = cropMaximum - cropMinimum;
+
+	// positions and texcoords alternate, only the positions are used
+	for (size_t i = 0; i < cubeVertexData.size(); i += 2)
+		cubeVertexData[i] = cropMinimum + cubeVertexData[i] * cropSize;
+
+	rayMarch.vbo.bind();
+	rayMarch.vbo.write(0, cubeVertexData.data(), sizeof(cubeVertexData));
+	rayMarch.vbo.release();
+
+	projection.vbo.bind();
+	projection.vbo.write(0, cubeVertexData.data(), sizeof(cubeVertexData));
+	projection.vbo.release();
+
+	std::array<QVector3D, 28> cropBoxVertexData;
+
+	for (size_t i = 0; i < cubeLinesVertexData.size(); ++i)
+		cropBoxVertexData[i] = cropMinimum + cubeLinesVertexData[i] * cropSize;
+
+	// the corners of the selected face
+	if (cropFace >= 0)
 	{
-		if (keyboardHelper.keyIsDown(Qt::Key_Space))
-			mouseMode = MouseMode::ZOOM;
-		else
-			mouseMode = MouseMode::PAN;
+		int axis = cropFace / 2;
+		int axis1 = (axis + 1) % 3;
+		int axis2 = (axis + 2) % 3;
+		const float corners[4][2] = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f } };
+
+		for (int i = 0; i < 4; ++i)
+		{
+			QVector3D corner;
+			corner[axis] = (cropFace % 2 == 0) ? 0.0f : 1.0f;
+			corner[axis1] = corners[i][0];
+			corner[axis2] = corners[i][1];
+
+			cropBoxVertexData[24 + i] = cropMinimum + corner * cropSize;
+		}
 	}
-	else if (mouseButtons == (Qt::LeftButton | Qt::RightButton))
-		mouseMode = MouseMode::MEASURE;
-	else
-		mouseMode = MouseMode::NONE;
+
+	cropBox.vbo.bind();
+	cropBox.vbo.write(0, cropBoxVertexData.data(), sizeof(cropBoxVertexData));
+	cropBox.vbo.release();
 }
 
 QVector3D RenderWidget::getPlaneIntersection(const QPointF& mousePosition)
 {
-	float ndcX = mousePosition.x() / float(width());
-	float ndcY = mousePosition.y() / float(height());
+	float ndcX = mousePosition.x() / float(sceneViewport.width());
+	float ndcY = mousePosition.y() / float(sceneViewport.height());
 	ndcX = (ndcX - 0.5f) * 2.0f;
 	ndcY = (ndcY - 0.5f) * -2.0f;
 
 	QVector4D ndcPosition(ndcX, ndcY, 1.0f, 1.0f);
-	QMatrix4x4 tempMatrix = (projectionMatrix * viewMatrix).inverted();
+	QMatrix4x4 tempMatrix = (projectionMatrix * camera.viewMatrix).inverted();
 	QVector4D worldPosition = tempMatrix * ndcPosition;
 	QVector3D worldPosition3d(worldPosition.x() / worldPosition.w(), worldPosition.y() / worldPosition.w(), worldPosition.z() / worldPosition.w());
-	QVector3D rayDirection = (worldPosition3d - cameraPosition).normalized();
+	QVector3D rayDirection = (worldPosition3d - camera.position).normalized();
 
 	float denominator = QVector3D::dotProduct(rayDirection, planeNormal);
 
 	if (std::abs(denominator) < std::numeric_limits<double>::epsilon())
 		return QVector3D();
 
-	float t = QVector3D::dotProduct(planePosition - cameraPosition, planeNormal) / denominator;
+	float t = QVector3D::dotProduct(planePosition - camera.position, planeNormal) / denominator;
 
 	if (t < 0.0)
 		return QVector3D();;
 
-	return cameraPosition + (t * rayDirection);
+	return camera.position + (t * rayDirection);
 }
 
-void RenderWidget::generateCubeVertices(std::array<QVector3D, 72>& cubeVertexData, std::array<QVector3D, 24>& cubeLinesVertexData, float width, float height, float depth)
+// a sheared cube has the first slice at its front face and the last one at its back face, like getDeskewOffset
+void RenderWidget::generateCubeVertices(std::array<QVector3D, 72>& cubeVertexData, std::array<QVector3D, 24>& cubeLinesVertexData, float width, float height, float depth, float shear)
 {
 	float actualWidth = 1.0f;
 	float actualHeight = height / width;
 	float actualDepth = depth / width;
-
-	QVector3D v1(0, 0, actualDepth);
-	QVector3D v2(actualWidth, 0, actualDepth);
-	QVector3D v3(0, actualHeight, actualDepth);
-	QVector3D v4(actualWidth, actualHeight, actualDepth);
-	QVector3D v5(0, 0, 0);
-	QVector3D v6(actualWidth, 0, 0);
-	QVector3D v7(0, actualHeight, 0);
-	QVector3D v8(actualWidth, actualHeight, 0);
+	float frontOffset = std::max(-shear, 0.0f);
+	float backOffset = std::max(shear, 0.0f);
+
+	QVector3D v1(frontOffset, 0, actualDepth);
+	QVector3D v2(frontOffset + actualWidth, 0, actualDepth);
+	QVector3D v3(frontOffset, actualHeight, actualDepth);
+	QVector3D v4(frontOffset + actualWidth, actualHeight, actualDepth);
+	QVector3D v5(backOffset, 0, 0);
+	QVector3D v6(backOffset + actualWidth, 0, 0);
+	QVector3D v7(backOffset, actualHeight, 0);
+	QVector3D v8(backOffset + actualWidth, actualHeight, 0);
 
 	QVector3D t1(0, 0, 1);
 	QVector3D t2(1, 0, 1);
@@ -844,8 +3084,8 @@ void RenderWidget::generateCubeVertices(std::array<QVector3D, 72>& cubeVertexDat
 		v6, t6, v7, t7, v8, t8,
 		v5, t5, v1, t1, v3, t3,
 		v5, t5, v3, t3, v7, t7,
-		v1, t1, v6, t6, v5, t5,
-		v1, t1, v2, t2, v6, t6,
+		v1, t1, v5, t5, v6, t6,
+		v1, t1, v6, t6, v2, t2,
 		v3, t3, v8, t8, v7, t7,
 		v3, t3, v4, t4, v8, t8
 	};
@@ -871,7 +3111,17 @@ void RenderWidget::generateCubeVertices(std::array<QVector3D, 72>& cubeVertexDat
 	cubeLinesVertexData = cubeLinesVertexDataTemp;
 }
 
-void RenderWidget::generateBackgroundVertices(std::array<float, 30>& backgroundVertexData, QColor color)
+// the vertices only need to be sorted around some two axes on the plane
+int RenderWidget::generatePlaneVertices(std::array<QVector3D, 6>& planeVertexData, const IntersectionPlane& intersectionPlane, const QVector3D& boxMinimum, const QVector3D& boxMaximum)
+{
+	QVector3D normal = intersectionPlane.normal;
+	QVector3D right = QVector3D::crossProduct(normal, (std::abs(normal.x()) < 0.9f) ? QVector3D(1.0f, 0.0f, 0.0f) : QVector3D(0.0f, 1.0f, 0.0f)).normalized();
+	QVector3D up = QVector3D::crossProduct(right, normal);
+
+	return MathHelper::intersectPlaneWithBox(planeVertexData, intersectionPlane.position, normal, boxMinimum, boxMaximum, right, up);
+}
+
+void RenderWidget::generateBackgroundColors(QVector3D& bottomColor, QVector3D& topColor, QColor color)
 {
 	float alpha1 = 0.6f;
 	float alpha2 = 1.4f;
@@ -884,16 +3134,6 @@ void RenderWidget::generateBackgroundVertices(std::array<float, 30>& backgroundV
 	float green2 = std::max(0.0f, std::min(1.0f, float(alpha2 * color.greenF())));
 	float blue2 = std::max(0.0f, std::min(1.0f, float(alpha2 * color.blueF())));
 
-	std::array<float, 30> backgroundVertexDataTemp =
-	{
-		-1.0f, -1.0f, red1, green1, blue1,
-		1.0f, -1.0f, red1, green1, blue1,
-		1.0f, 1.0f, red2, green2, blue2,
-
-		-1.0f, -1.0f, red1, green1, blue1,
-		1.0f, 1.0f, red2, green2, blue2,
-		-1.0f, 1.0f, red2, green2, blue2,
-	};
-
-	backgroundVertexData = backgroundVertexDataTemp;
+	bottomColor = QVector3D(red1, green1, blue1);
+	topColor = QVector3D(red2, green2, blue2);
 }
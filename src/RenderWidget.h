@@ -4,6 +4,10 @@
 #pragma once
 
 #include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 #include <QOpenGLWidget>
 #include <QOpenGLFunctions>
@@ -12,9 +16,21 @@
 #include <QOpenGLShaderProgram>
 #include <QOpenGLTexture>
 #include <QElapsedTimer>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLContext>
+#include <QOffscreenSurface>
 
+#include "CameraController.h"
 #include "KeyboardHelper.h"
 #include "ImageLoader.h"
+#include "VolumeResource.h"
+#include "FrameTimer.h"
+#include "CameraPath.h"
+#include "RenderThread.h"
+#include "ShaderVariantCache.h"
+#include "ProgramBinaryCache.h"
+#include "SliceStreamer.h"
+#include "SliceViews.h"
 
 namespace CellVision
 {
@@ -35,9 +51,22 @@ namespace CellVision
 		float imageWidth = 1.0f;
 		float imageHeight = 1.0f;
 		float imageDepth = 1.0f;
+
+		// stage-scanned light-sheet stacks are sheared along x, the angle between the sheet and the scan direction in degrees (zero disables the deskew)
+		float deskewAngle = 0.0f;
+		float scanStep = 0.0f;
+
+		TextureFormat textureFormat = TextureFormat::UNCOMPRESSED;
 	};
 
-	enum class MouseMode { NONE, ROTATE, ORBIT, PAN, ZOOM, MEASURE };
+	enum class RenderMode { PLANE, VOLUME, PROJECTION };
+	enum class ViewLayout { SINGLE, QUAD };
+
+	struct IntersectionPlane
+	{
+		QVector3D position;
+		QVector3D normal;
+	};
 
 	class RenderWidget : public QOpenGLWidget, protected QOpenGLFunctions
 	{
@@ -48,7 +77,16 @@ namespace CellVision
 		explicit RenderWidget(QWidget* parent = nullptr);
 		~RenderWidget();
 
-		void initialize(const RenderWidgetSettings& settings);
+		// a forced reload reads the image again even if it is already loaded, for files that have changed on the disk
+		void initialize(const RenderWidgetSettings& settings, const std::shared_ptr<VolumeResource>& sharedVolume = nullptr, bool forceReload = false);
+		const RenderWidgetSettings& getSettings() const;
+		std::shared_ptr<VolumeResource> getVolume() const;
+		bool isLoaded() const;
+
+		void initializeOffscreen(GLuint framebuffer, int width, int height);
+		void renderOffscreen();
+		CameraPose getCameraPose() const;
+		void setCameraPose(const CameraPose& pose);
 		
 	protected:
 
@@ -59,65 +97,259 @@ namespace CellVision
 		void mouseMoveEvent(QMouseEvent* me) override;
 		void wheelEvent(QWheelEvent* we) override;
 
+		void showEvent(QShowEvent* se) override;
+		void hideEvent(QHideEvent* he) override;
+
 		void initializeGL() override;
 		void resizeGL(int width, int height) override;
 		void paintGL() override;
 
 	private:
 
+		void initializeScene();
+		void resizeScene(int width, int height);
+		void renderFrame();
+		void releaseScene();
+		void startRenderThread();
+		void runRenderThread();
+		void renderThreadFrame();
+		void presentFrame();
+		void applyRequestedSettings();
+		void postInput(const InputEvent& inputEvent);
+		void processInput();
+		void applyInput(const InputEvent& inputEvent);
+		void applySceneInput(const InputEvent& inputEvent);
+		void applySettings();
+		bool volumeChanged() const;
+		bool sizeChanged() const;
+		QVector3D getBoxMaximum() const;
+		float getDeskewShear() const;
+		float getDeskewOffset(float z) const;
+		void setDeskewUniforms(QOpenGLShaderProgram& program) const;
+		void deskewBounds(QVector3D& minimum, QVector3D& maximum) const;
+		void undeskewBounds(QVector3D& minimum, QVector3D& maximum) const;
+		void renderScene();
+		void renderSliceViews();
+		void renderSlice(int view, const QMatrix4x4& mvp);
+		void updateSceneViewport();
+		void setViewport(const QRect& rect);
+		QRect getViewRect(int view) const;
+		int getViewAt(const QPointF& mousePosition) const;
+		SliceViewState getSliceViewState(int view) const;
+		void followCrosshair();
+		void renderFramebuffer(QOpenGLFramebufferObject& framebuffer, float sampleWeight);
+		bool updateFramebuffer(std::unique_ptr<QOpenGLFramebufferObject>& framebuffer, const QSize& framebufferSize, GLenum internalFormat);
+		QMatrix4x4 getJitterMatrix() const;
+		float getStepJitter() const;
+		GLuint getTargetFramebuffer() const;
+		void updateRenderScale();
+		void renderPlane();
+		void renderPlane(QOpenGLVertexArrayObject& vao, const QMatrix4x4& mvp, int instanceCount);
+		void setPlaneInstanceAttributes();
+		void renderRayMarch();
+		void renderProjection();
+		void renderProjectionImage();
+		void updateProjectionImage();
+		bool generateProjectionData(std::vector<float>& projectionData, uint32_t& projectionWidth, uint32_t& projectionHeight);
+		void getCropVoxelRange(std::array<int, 3>& minimum, std::array<int, 3>& maximum) const;
+		void saveProjection();
+		ShaderDefines getSamplingDefines() const;
+		float getProjectionScale() const;
+		float getVoxelSpacing(const QVector3D& direction) const;
+		int getSlabSampleCount() const;
+		int getSlabSampleCount(const QVector3D& normal) const;
+		QString getRenderModeName() const;
+		void benchmarkEmptySpaceSkipping();
 		void updateLogic();
-		void updateCamera();
 		void resetCameraPosition();
-		void resetCameraSpeeds();
-		void loadCameraSpeeds();
-		void setMouseMode();
+		void changeThreshold(float amount);
+		void updateOccupiedBounds();
+		void updatePlaneVertices();
+		void pinPlane();
+		void unpinPlane();
+		bool isCropActive() const;
+		void moveCropFace(float distance);
+		void commitCrop();
+		void finishCrop();
+		void resetCrop();
+		void replaceVolume(const std::shared_ptr<VolumeResource>& newVolume);
+		void updateCropVertices();
+		void releaseStreamedSlices();
+		void changeStreamedSlice(int amount);
+		void updateStreamedSlices();
+		void renderStreamedSlice();
 		QVector3D getPlaneIntersection(const QPointF& mousePosition);
-		void generateCubeVertices(std::array<QVector3D, 72>& cubeVertexData, std::array<QVector3D, 24>& cubeLinesVertexData, float width, float height, float depth);
-		void generateBackgroundVertices(std::array<float, 30>& backgroundVertexData, QColor color);
+		void generateCubeVertices(std::array<QVector3D, 72>& cubeVertexData, std::array<QVector3D, 24>& cubeLinesVertexData, float width, float height, float depth, float shear);
+		int generatePlaneVertices(std::array<QVector3D, 6>& planeVertexData, const IntersectionPlane& intersectionPlane, const QVector3D& boxMinimum, const QVector3D& boxMaximum);
+		void generateBackgroundColors(QVector3D& bottomColor, QVector3D& topColor, QColor color);
 
 		RenderWidgetSettings settings;
+		RenderWidgetSettings appliedSettings;
+		bool hasAppliedSettings = false;
 
 		KeyboardHelper keyboardHelper;
-		Qt::MouseButtons mouseButtons;
-		QPoint previousMousePosition;
+		CameraController camera;
 		QElapsedTimer timeStepTimer;
-		QVector3D cameraPosition;
-		QMatrix4x4 cameraOrientationMatrix;
-		QMatrix4x4 cameraOrientationInvMatrix;
-		QMatrix4x4 cameraMatrix;
-		QMatrix4x4 viewMatrix;
 		QMatrix4x4 projectionMatrix;
-		QVector3D cameraRight;
-		QVector3D cameraUp;
-		QVector3D cameraForward;
 		QVector3D planePosition;
 		QVector3D planeNormal;
 		QVector3D measureStartPoint;
 		QVector3D measureEndPoint;
-		QVector3D orbitPointWorld;
-		QVector3D orbitPointCamera;
-		MouseMode mouseMode = MouseMode::NONE;
-		float moveSpeedModifier = 0.0f;
-		float mouseMoveSpeedModifier = 0.0f;
-		float mouseRotateSpeedModifier = 0.0f;
-		float mouseWheelStepSizeModifier = 0.0f;
-		float planeDistance = 1.0f;
+		RenderMode renderMode = RenderMode::PLANE;
 		float measureDistance = 0.0f;
+		int planeInstanceCount = 0;
 		bool renderBackground = true;
 		bool renderCoordinates = true;
 		bool renderMiniCoordinates = true;
 		bool renderText = true;
 
-		QOpenGLTexture volumeTexture;
+		// per-channel ramps from low to high, opacities are per voxel length
+		QVector3D transferLow = QVector3D(0.1f, 0.1f, 0.1f);
+		QVector3D transferHigh = QVector3D(1.0f, 1.0f, 1.0f);
+		QVector3D transferOpacity = QVector3D(0.05f, 0.05f, 0.05f);
+		float samplesPerVoxel = 2.0f;
+
+		// plane values below the threshold are shown black, cells that are completely below it are not sampled at all
+		QVector3D displayThreshold = QVector3D(0.0f, 0.0f, 0.0f);
+		QVector3D occupiedMinimum;
+		QVector3D occupiedMaximum;
+		bool hasOccupiedBounds = false;
+		bool skipEmptySpace = true;
+		bool runEmptySpaceSkippingBenchmark = false;
+
+		ProjectionType projectionType = ProjectionType::MAXIMUM;
+		ProjectionAxis projectionAxis = ProjectionAxis::VIEW;
+		float projectionGain = 1.0f;
+		bool projectionImageIsValid = false;
+
+		// the plane is composited from samples spread over this thickness in world units, zero samples only the plane
+		SlabMode slabMode = SlabMode::MAXIMUM;
+		float slabThickness = 0.0f;
+		int maxSlabSampleCount = 64;
+
+		// the camera plane is always drawn first, pinned planes stay where they were left and the selected one can be moved on its own
+		// all the planes are drawn with one instanced draw front to back, so the depth test skips the hidden parts before they are shaded
+		static const int MAX_PLANE_COUNT = 8;
+		std::vector<IntersectionPlane> pinnedPlanes;
+		std::array<int, MAX_PLANE_COUNT> planeLinesVertexCounts;
+		int selectedPlane = -1;
+
+		// the crop box clips every render mode, and committing it replaces the volume with one that has only the voxels inside the box
+		// the world coordinates stay the same after a commit, so the positions and distances in the text do not change either
+		QVector3D cropMinimum;
+		QVector3D cropMaximum;
+		int cropFace = -1;
+		std::shared_ptr<VolumeResource> pendingCrop;
+		QElapsedTimer cropTimer;
+
+		// with TextureFormat::STREAMED_SLICES only the z slices around the current one are read from the file and kept as 2D textures
+		// slice i is always uploaded to texture i % count, which never collides inside the window of 2 * radius + 1 slices
+		static const int SLICE_PREFETCH_RADIUS = 3;
+		std::unique_ptr<SliceStreamer> sliceStreamer;
+		std::array<std::unique_ptr<QOpenGLTexture>, 2 * SLICE_PREFETCH_RADIUS + 1> streamedSliceTextures;
+		std::array<int, 2 * SLICE_PREFETCH_RADIUS + 1> streamedSliceIndices;
+
+		// core since 3.1 and 3.3, but not part of the 2.0 functions that QOpenGLFunctions resolves
+		typedef void (QOPENGLF_APIENTRYP DrawArraysInstancedFunction)(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount);
+		typedef void (QOPENGLF_APIENTRYP VertexAttribDivisorFunction)(GLuint index, GLuint divisor);
+		DrawArraysInstancedFunction drawArraysInstanced = nullptr;
+		VertexAttribDivisorFunction vertexAttribDivisor = nullptr;
+
+		// the scene is rendered at a lower resolution while the view changes and refined once it has been still for a while
+		std::unique_ptr<QOpenGLFramebufferObject> scaledFramebuffer;
+		QElapsedTimer interactionTimer;
+		QMatrix4x4 previousViewMatrix;
+		QVector3D previousPlanePosition;
+		QVector3D previousPlaneNormal;
+		float targetFrameTime = 16.0f;
+		float minimumRenderScale = 0.25f;
+		float interactionScale = 1.0f;
+		float renderScale = 1.0f;
+		float sceneTime = 0.0f;
+		float sceneTimeScale = 1.0f;
+		qint64 refinementDelay = 150;
+		bool viewChanged = false;
+
+		// a still view is supersampled over multiple frames, any change starts the accumulation over
+		std::unique_ptr<QOpenGLFramebufferObject> sampleFramebuffer;
+		std::unique_ptr<QOpenGLFramebufferObject> accumulationFramebuffer;
+		int accumulationSampleCount = 0;
+		int maxAccumulationSampleCount = 64;
+
+		FrameTimer frameTimer;
+		bool renderTimings = false;
+
+		CameraPath recordedCameraPath;
+		QElapsedTimer cameraPathTimer;
+		bool recordingCameraPath = false;
+
+		// the frame is rendered into this instead of the widget's framebuffer when offscreen or on the render thread
+		GLuint targetFramebuffer = 0;
+		bool isOffscreen = false;
+		QSize frameSize;
+
+		// the 2x2 layout shows the XY, XZ and YZ slices through the crosshair next to the 3D view, which is drawn inside the scene viewport
+		ViewLayout viewLayout = ViewLayout::SINGLE;
+		QRect sceneViewport;
+		int activeView = -1;
+		SliceViews sliceViews;
+		QMatrix4x4 crosshairMvp;
+
+		// the GUI thread only posts input and settings, everything else is used by the render thread once it runs
+		// the render thread has its own context in the widget's share group, and the widget only draws its latest finished frame
+		RenderWidgetSettings requestedSettings;
+		std::shared_ptr<VolumeResource> requestedVolume;
+		bool requestedForceReload = false;
+		std::shared_ptr<VolumeResource> publishedVolume;
+		bool publishedSliceStreaming = false;
+		std::atomic<bool> hasRequestedSettings{ false };
+		mutable std::mutex settingsMutex;
+		InputQueue inputQueue;
+
+		std::unique_ptr<RenderThread> renderThread;
+		std::unique_ptr<QOpenGLContext> renderContext;
+		std::unique_ptr<QOffscreenSurface> renderSurface;
+		std::unique_ptr<QOpenGLFramebufferObject> multisampleFramebuffer;
+		std::array<std::unique_ptr<QOpenGLFramebufferObject>, 3> frameFramebuffers;
+		FrameExchange frameExchange;
+		std::atomic<int> requestedWidth{ 0 };
+		std::atomic<int> requestedHeight{ 0 };
+		std::atomic<bool> renderThreadExiting{ false };
+		std::atomic<bool> renderThreadPaused{ false };
+		std::mutex renderThreadFrameMutex;
+		qint64 frameInterval = 16666667;
+		bool hasPresentedFrame = false;
+
+		std::shared_ptr<VolumeResource> volume;
+		std::shared_ptr<VolumeResource> pendingVolume;
+		bool hasPendingInitialize = false;
+		bool forceReload = false;
 		QOpenGLTexture textTexture;
 		QImage textImage;
+		QOpenGLTexture projectionTexture;
 
 		OpenGLData cube;
 		OpenGLData plane;
+		OpenGLData planeLines;
+		OpenGLData rayMarch;
+		OpenGLData projection;
+		OpenGLData projectionImage;
 		OpenGLData coordinates;
 		OpenGLData miniCoordinates;
 		OpenGLData background;
 		OpenGLData measurement;
 		OpenGLData text;
+		OpenGLData upscale;
+		OpenGLData present;
+		OpenGLData slicePlanes;
+		OpenGLData cropBox;
+		OpenGLData streamedSlice;
+
+		ProgramBinaryCache programCache;
+
+		// the programs that read the volume come in variants, plane, rayMarch and projection only hold their vertex data
+		ShaderVariantCache planeVariants;
+		ShaderVariantCache rayMarchVariants;
+		ShaderVariantCache projectionVariants;
 	};
 }
@@ -0,0 +1,97 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#include "stdafx.h"
+
+#include "ResliceExporter.h"
+#include "OffscreenRenderer.h"
+#include "CameraPath.h"
+#include "ImageLoader.h"
+#include "ImageSaver.h"
+#include "ParallelHelper.h"
+#include "MainWindow.h"
+#include "Log.h"
+
+using namespace CellVision;
+
+int ResliceExporter::run(const ResliceExporterSettings& settings)
+{
+	Log& log = MainWindow::getLog();
+
+	if (!QDir().mkpath(settings.outputDirectory))
+	{
+		log.logError("Could not create output directory: %s", settings.outputDirectory.toStdString());
+		return -1;
+	}
+
+	RenderWidgetSettings renderWidgetSettings;
+	CameraPath poses;
+
+	if (!OffscreenRenderer::loadSettingsFromFile(settings.datasetFileName, renderWidgetSettings) || !poses.loadFromFile(settings.poseFileName.toStdString()))
+		return -1;
+
+	ImageLoaderResult16 volume = ImageLoader::loadFromMultipageTiff16(renderWidgetSettings.imageLoaderInfo);
+
+	if (volume.width == 0 || volume.height == 0 || volume.depth == 0)
+	{
+		log.logError("Could not load the volume of %s", settings.datasetFileName.toStdString());
+		return -1;
+	}
+
+	const float imageWidth = renderWidgetSettings.imageWidth;
+	std::array<float, 3> imageSize = { { imageWidth, renderWidgetSettings.imageHeight, renderWidgetSettings.imageDepth } };
+	float spacing = settings.spacing;
+
+	if (spacing <= 0.0f)
+		spacing = std::min(imageSize[0] / volume.width, std::min(imageSize[1] / volume.height, imageSize[2] / volume.depth));
+
+	QString baseName = QFileInfo(settings.datasetFileName).completeBaseName();
+	const std::vector<CameraPose>& posesToReslice = poses.getPoses();
+	double resliceTime = 0.0;
+	int failedCount = 0;
+
+	QElapsedTimer timer;
+	timer.start();
+
+	// the plane is the one the viewer shows for the pose, centered on the screen and facing the camera
+	// the camera is in world units where the image width is one, the reslicer works in physical units
+	for (size_t i = 0; i < posesToReslice.size(); ++i)
+	{
+		const CameraPose& pose = posesToReslice[i];
+		QVector3D right = pose.orientation.rotatedVector(QVector3D(1.0f, 0.0f, 0.0f));
+		QVector3D up = pose.orientation.rotatedVector(QVector3D(0.0f, 1.0f, 0.0f));
+		QVector3D forward = pose.orientation.rotatedVector(QVector3D(0.0f, 0.0f, -1.0f));
+		QVector3D center = (pose.position + pose.planeDistance * forward) * imageWidth;
+		QVector3D origin = center - right * (spacing * (settings.frameSize.width() - 1) / 2.0f) - up * (spacing * (settings.frameSize.height() - 1) / 2.0f);
+
+		ReslicePlane plane;
+		plane.origin = { { origin.x(), origin.y(), origin.z() } };
+		plane.axisX = { { right.x(), right.y(), right.z() } };
+		plane.axisY = { { up.x(), up.y(), up.z() } };
+		plane.spacingX = spacing;
+		plane.spacingY = spacing;
+		plane.width = uint32_t(settings.frameSize.width());
+		plane.height = uint32_t(settings.frameSize.height());
+
+		QElapsedTimer resliceTimer;
+		resliceTimer.start();
+
+		ResliceImage image = VolumeReslicer::reslice(volume, imageSize, plane, settings.interpolation);
+
+		resliceTime += resliceTimer.nsecsElapsed() / 1000000000.0;
+
+		QString fileName = QString("%1/%2_reslice_%3.tif").arg(settings.outputDirectory, baseName).arg(int(i), 5, 10, QChar('0'));
+
+		if (!ImageSaver::saveToFloatTiff(fileName.toStdString(), image.width, image.height, image.data))
+			++failedCount;
+	}
+
+	// only the resampling is timed, loading and saving are not part of the throughput
+	double megavoxels = double(posesToReslice.size()) * settings.frameSize.width() * settings.frameSize.height() / 1000000.0;
+	const char* interpolationName = (settings.interpolation == ResliceInterpolation::TRILINEAR) ? "trilinear" : "nearest";
+
+	log.logInfo("Resliced %d planes of %dx%d (%s, spacing %.4f) in %.2f s to %s (%d failed)", posesToReslice.size(), settings.frameSize.width(), settings.frameSize.height(), interpolationName, spacing, timer.elapsed() / 1000.0f, settings.outputDirectory.toStdString(), failedCount);
+	log.logInfo("Reslicing: %.3f s | %.1f MVoxel/s on %d threads", resliceTime, (resliceTime > 0.0) ? megavoxels / resliceTime : 0.0, ParallelHelper::getThreadCount());
+
+	return (failedCount == 0) ? 0 : -1;
+}
@@ -0,0 +1,31 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#pragma once
+
+#include <QString>
+#include <QSize>
+
+#include "VolumeReslicer.h"
+
+namespace CellVision
+{
+	struct ResliceExporterSettings
+	{
+		QString datasetFileName;
+		QString poseFileName;
+		QString outputDirectory;
+		QSize frameSize = QSize(1920, 1080);
+		ResliceInterpolation interpolation = ResliceInterpolation::TRILINEAR;
+		float spacing = 0.0f; // physical units per output pixel, zero uses the smallest voxel size
+	};
+
+	// resamples the plane of every pose in the pose file on the CPU without any OpenGL, the images are saved as float TIFFs
+	class ResliceExporter
+	{
+	public:
+
+		// returns the process exit code
+		static int run(const ResliceExporterSettings& settings);
+	};
+}
@@ -0,0 +1,112 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#include "stdafx.h"
+
+#include "ShaderVariantCache.h"
+#include "MainWindow.h"
+#include "Log.h"
+
+using namespace CellVision;
+
+void ShaderVariantCache::initialize(const std::string& name_, const std::string& vertexShaderFileName, const std::vector<std::string>& fragmentShaderFileNames, ProgramBinaryCache& programCache_)
+{
+	name = name_;
+	programCache = &programCache_;
+	vertexShaderSource = ProgramBinaryCache::readSource(vertexShaderFileName);
+	fragmentShaderSources.clear();
+
+	for (const std::string& fileName : fragmentShaderFileNames)
+		fragmentShaderSources.push_back(ProgramBinaryCache::readSource(fileName));
+
+	variants.clear();
+}
+
+void ShaderVariantCache::release()
+{
+	variants.clear();
+}
+
+QOpenGLShaderProgram* ShaderVariantCache::getProgram(const ShaderDefines& defines)
+{
+	std::string key = getKey(defines);
+	auto existingVariant = variants.find(key);
+
+	if (existingVariant != variants.end())
+		return existingVariant->second.program.get();
+
+	QElapsedTimer timer;
+	timer.start();
+
+	std::unique_ptr<QOpenGLShaderProgram> program(new QOpenGLShaderProgram());
+	program->bindAttributeLocation("position", POSITION_LOCATION);
+
+	std::vector<QByteArray> variantFragmentShaderSources;
+
+	for (const QByteArray& source : fragmentShaderSources)
+		variantFragmentShaderSources.push_back(addDefines(source, defines));
+
+	int loadedCount = programCache->getLoadedCount();
+	bool linked = programCache->link(*program, addDefines(vertexShaderSource, defines), variantFragmentShaderSources);
+
+	Variant& variant = variants[key];
+	variant.compileTime = timer.nsecsElapsed() / 1000000.0f;
+
+	// the compiler errors themselves are already printed by Qt
+	if (!linked)
+	{
+		MainWindow::getLog().logWarning("Could not compile %s shader variant (%s)", name, key);
+		return nullptr;
+	}
+
+	variant.program = std::move(program);
+
+	if (programCache->getLoadedCount() > loadedCount)
+		MainWindow::getLog().logInfo("Loaded %s shader variant (%s) from the shader cache in %.1f ms", name, key, variant.compileTime);
+	else
+		MainWindow::getLog().logInfo("Compiled %s shader variant (%s) in %.1f ms", name, key, variant.compileTime);
+
+	return variant.program.get();
+}
+
+size_t ShaderVariantCache::getVariantCount() const
+{
+	return variants.size();
+}
+
+float ShaderVariantCache::getTotalCompileTime() const
+{
+	float totalCompileTime = 0.0f;
+
+	for (const auto& variant : variants)
+		totalCompileTime += variant.second.compileTime;
+
+	return totalCompileTime;
+}
+
+// the version line has to stay first, and the line numbers of the compiler errors are kept the same as in the file
+QByteArray ShaderVariantCache::addDefines(const QByteArray& source, const ShaderDefines& defines)
+{
+	int versionLineEnd = source.indexOf('\n') + 1;
+	QByteArray defineLines;
+
+	for (const auto& define : defines)
+		defineLines += QByteArray("#define ") + define.first.c_str() + " " + QByteArray::number(define.second) + "\n";
+
+	defineLines += "#line 2\n";
+
+	QByteArray result = source;
+	result.insert(versionLineEnd, defineLines);
+
+	return result;
+}
+
+std::string ShaderVariantCache::getKey(const ShaderDefines& defines)
+{
+	std::string key;
+
+	for (const auto& define : defines)
+		key += (key.empty() ? "" : " ") + define.first + "=" + std::to_string(define.second);
+
+	return key;
+}
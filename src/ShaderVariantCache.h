@@ -0,0 +1,57 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <QByteArray>
+#include <QOpenGLShaderProgram>
+
+#include "ProgramBinaryCache.h"
+
+namespace CellVision
+{
+	// preprocessor definitions that select one variant of a program, e.g. { { "TEXTURE_FORMAT", 1 }, { "SLAB_MODE", 0 } }
+	typedef std::vector<std::pair<std::string, int>> ShaderDefines;
+
+	// programs compiled from the same sources with different definitions, so that branches on rarely changing state are resolved by the compiler
+	// variants are compiled on first use and kept until release, which needs the context that compiled them
+	class ShaderVariantCache
+	{
+	public:
+
+		// every variant binds its position attribute here, so that one vertex array works with all of them
+		static const int POSITION_LOCATION = 0;
+
+		void initialize(const std::string& name, const std::string& vertexShaderFileName, const std::vector<std::string>& fragmentShaderFileNames, ProgramBinaryCache& programCache);
+		void release();
+
+		// returns nullptr if the variant does not compile, it is then not tried again
+		QOpenGLShaderProgram* getProgram(const ShaderDefines& defines);
+
+		size_t getVariantCount() const;
+		float getTotalCompileTime() const;
+
+	private:
+
+		struct Variant
+		{
+			std::unique_ptr<QOpenGLShaderProgram> program;
+			float compileTime = 0.0f;
+		};
+
+		static QByteArray addDefines(const QByteArray& source, const ShaderDefines& defines);
+		static std::string getKey(const ShaderDefines& defines);
+
+		std::string name;
+		ProgramBinaryCache* programCache = nullptr;
+		QByteArray vertexShaderSource;
+		std::vector<QByteArray> fragmentShaderSources;
+		std::map<std::string, Variant> variants;
+	};
+}
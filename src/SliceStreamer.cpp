@@ -0,0 +1,196 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#include "stdafx.h"
+
+#include "SliceStreamer.h"
+#include "MainWindow.h"
+#include "Log.h"
+
+using namespace CellVision;
+
+SliceStreamer::~SliceStreamer()
+{
+	close();
+}
+
+bool SliceStreamer::open(const ImageLoaderInfo& info_, uint32_t prefetchRadius_)
+{
+	close();
+
+	Log& log = MainWindow::getLog();
+	log.logInfo("Streaming multipage TIFF image slices from %s", info_.fileName);
+
+	tiffFile = TIFFOpen(info_.fileName.c_str(), "r");
+
+	if (tiffFile == nullptr)
+	{
+		log.logWarning("Could not open image file");
+		return false;
+	}
+
+	TIFFGetField(tiffFile, TIFFTAG_IMAGEWIDTH, &width);
+	TIFFGetField(tiffFile, TIFFTAG_IMAGELENGTH, &height);
+
+	info = info_;
+	depth = info.imagesPerChannel;
+	prefetchRadius = prefetchRadius_;
+	currentSlice = depth / 2;
+	readIndices.clear();
+	readSlices.clear();
+	exiting = false;
+
+	thread = std::thread(&SliceStreamer::run, this);
+
+	return true;
+}
+
+void SliceStreamer::close()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		exiting = true;
+	}
+
+	condition.notify_one();
+
+	if (thread.joinable())
+		thread.join();
+
+	if (tiffFile != nullptr)
+	{
+		TIFFClose(tiffFile);
+		tiffFile = nullptr;
+	}
+
+	readIndices.clear();
+	readSlices.clear();
+	depth = 0;
+}
+
+bool SliceStreamer::isOpenedFrom(const ImageLoaderInfo& info_) const
+{
+	return depth > 0 && info == info_;
+}
+
+uint32_t SliceStreamer::getWidth() const
+{
+	return width;
+}
+
+uint32_t SliceStreamer::getHeight() const
+{
+	return height;
+}
+
+uint32_t SliceStreamer::getDepth() const
+{
+	return depth;
+}
+
+uint32_t SliceStreamer::getPrefetchRadius() const
+{
+	return prefetchRadius;
+}
+
+void SliceStreamer::setCurrentSlice(uint32_t index)
+{
+	if (depth == 0)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		currentSlice = std::min(index, depth - 1);
+
+		for (auto readIndex = readIndices.begin(); readIndex != readIndices.end();)
+		{
+			if (isWanted(*readIndex))
+				++readIndex;
+			else
+				readIndex = readIndices.erase(readIndex);
+		}
+
+		readSlices.erase(std::remove_if(readSlices.begin(), readSlices.end(), [&](const StreamedSlice& slice) { return !isWanted(slice.index); }), readSlices.end());
+	}
+
+	condition.notify_one();
+}
+
+uint32_t SliceStreamer::getCurrentSlice() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return currentSlice;
+}
+
+std::vector<StreamedSlice> SliceStreamer::takeReadSlices()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::vector<StreamedSlice> slices;
+	slices.swap(readSlices);
+
+	return slices;
+}
+
+// only this thread touches the file after it has been opened
+void SliceStreamer::run()
+{
+	for (;;)
+	{
+		uint32_t index = 0;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [&] { return exiting || getNextSlice(index); });
+
+			if (exiting)
+				return;
+		}
+
+		StreamedSlice slice;
+		slice.index = index;
+		slice.data.resize(uint64_t(width) * height);
+
+		if (!ImageLoader::readSlice(tiffFile, info, width, height, uint16_t(index), &slice.data[0]))
+		{
+			// readSlice has already closed the file
+			tiffFile = nullptr;
+			MainWindow::getLog().logWarning("Could not read slice %d, streaming stopped", index);
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (isWanted(index))
+		{
+			readIndices.insert(index);
+			readSlices.push_back(std::move(slice));
+		}
+	}
+}
+
+// the nearest slice of the window that has not been read yet, the mutex has to be locked
+bool SliceStreamer::getNextSlice(uint32_t& index) const
+{
+	for (uint32_t distance = 0; distance <= prefetchRadius; ++distance)
+	{
+		if (currentSlice + distance < depth && readIndices.count(currentSlice + distance) == 0)
+		{
+			index = currentSlice + distance;
+			return true;
+		}
+
+		if (distance <= currentSlice && readIndices.count(currentSlice - distance) == 0)
+		{
+			index = currentSlice - distance;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool SliceStreamer::isWanted(uint32_t index) const
+{
+	return index + prefetchRadius >= currentSlice && index <= currentSlice + prefetchRadius;
+}
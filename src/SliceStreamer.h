@@ -0,0 +1,70 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "ImageLoader.h"
+
+namespace CellVision
+{
+	// one z slice with its channels packed like in ImageLoaderResult, rows are stored bottom-up
+	struct StreamedSlice
+	{
+		uint32_t index = 0;
+		std::vector<uint32_t> data;
+	};
+
+	// reads the z slices of a multipage TIFF on its own thread, the current slice first and then its neighbours outwards
+	// only the slices within the prefetch radius of the current one are kept, so the memory use does not grow with the depth
+	class SliceStreamer
+	{
+	public:
+
+		~SliceStreamer();
+
+		bool open(const ImageLoaderInfo& info, uint32_t prefetchRadius);
+		void close();
+		bool isOpenedFrom(const ImageLoaderInfo& info) const;
+
+		uint32_t getWidth() const;
+		uint32_t getHeight() const;
+		uint32_t getDepth() const;
+		uint32_t getPrefetchRadius() const;
+
+		// the slices that fall out of the new window are forgotten and will be read again if the window comes back
+		void setCurrentSlice(uint32_t index);
+		uint32_t getCurrentSlice() const;
+
+		// the slices read since the previous call, some of them may already be outside the window
+		std::vector<StreamedSlice> takeReadSlices();
+
+	private:
+
+		void run();
+		bool getNextSlice(uint32_t& index) const;
+		bool isWanted(uint32_t index) const;
+
+		ImageLoaderInfo info;
+		TIFF* tiffFile = nullptr;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t depth = 0;
+		uint32_t prefetchRadius = 0;
+
+		// everything below is shared with the reading thread
+		std::thread thread;
+		mutable std::mutex mutex;
+		std::condition_variable condition;
+		uint32_t currentSlice = 0;
+		std::set<uint32_t> readIndices;
+		std::vector<StreamedSlice> readSlices;
+		bool exiting = false;
+	};
+}
@@ -0,0 +1,274 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#include "stdafx.h"
+
+#include "SliceViews.h"
+
+using namespace CellVision;
+
+namespace
+{
+	// the slice views are XY, XZ and YZ, each looks against its normal axis with these up vectors
+	const int sliceNormalAxes[] = { 2, 1, 0 };
+	const QVector3D sliceUpVectors[] = { QVector3D(0.0f, 1.0f, 0.0f), QVector3D(0.0f, 0.0f, -1.0f), QVector3D(0.0f, 1.0f, 0.0f) };
+}
+
+bool SliceViewState::operator==(const SliceViewState& other) const
+{
+	return volume == other.volume &&
+		size == other.size &&
+		center == other.center &&
+		crosshair == other.crosshair &&
+		cropMinimum == other.cropMinimum &&
+		cropMaximum == other.cropMaximum &&
+		displayThreshold == other.displayThreshold &&
+		backgroundColor == other.backgroundColor &&
+		lineColor == other.lineColor &&
+		slabMode == other.slabMode &&
+		halfHeight == other.halfHeight &&
+		slabThickness == other.slabThickness &&
+		skipEmptySpace == other.skipEmptySpace;
+}
+
+bool SliceViewState::operator!=(const SliceViewState& other) const
+{
+	return !(*this == other);
+}
+
+void SliceViews::initialize(ProgramBinaryCache& programCache)
+{
+	initializeOpenGLFunctions();
+
+	std::array<QVector3D, 6> crosshairVertexData;
+	crosshairVertexData.fill(QVector3D());
+
+	programCache.linkFiles(crosshairProgram, "data/shaders/cube.vert", { "data/shaders/cube.frag" });
+	crosshairProgram.bind();
+
+	crosshairVbo.create();
+	crosshairVbo.bind();
+	crosshairVbo.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+	crosshairVbo.allocate(crosshairVertexData.data(), sizeof(crosshairVertexData));
+
+	crosshairVao.create();
+	crosshairVao.bind();
+
+	crosshairProgram.enableAttributeArray("position");
+	crosshairProgram.setAttributeBuffer("position", GL_FLOAT, 0, 3, 3 * sizeof(GLfloat));
+
+	crosshairVao.release();
+	crosshairVbo.release();
+	crosshairProgram.release();
+}
+
+void SliceViews::release()
+{
+	for (std::unique_ptr<QOpenGLFramebufferObject>& framebuffer : framebuffers)
+		framebuffer.reset();
+
+	invalidate();
+	crosshairVao.destroy();
+	crosshairVbo.destroy();
+}
+
+void SliceViews::reset(const QVector3D& boxMaximum)
+{
+	crosshairPosition = boxMaximum * 0.5f;
+	viewCenter = boxMaximum * 0.5f;
+	viewHalfHeight = 0.6f * std::max(std::max(boxMaximum.x(), boxMaximum.y()), boxMaximum.z());
+}
+
+void SliceViews::invalidate()
+{
+	states.fill(SliceViewState());
+}
+
+bool SliceViews::applyInput(int view, const QRect& viewRect, int frameHeight, const InputEvent& inputEvent, KeyboardHelper& keyboardHelper, float sliceStep, const QVector3D& boxMaximum)
+{
+	QVector3D normal = getNormal(view);
+	QVector3D up = sliceUpVectors[view];
+	QVector3D right = QVector3D::crossProduct(up, normal);
+
+	if (inputEvent.type == QEvent::MouseButtonPress || inputEvent.type == QEvent::MouseMove)
+	{
+		QPoint mouseDelta = inputEvent.globalPosition - previousMousePosition;
+		previousMousePosition = inputEvent.globalPosition;
+
+		if (inputEvent.buttons & Qt::LeftButton)
+		{
+			setCrosshairPosition(getSlicePoint(view, viewRect, frameHeight, inputEvent.localPosition), boxMaximum);
+			return true;
+		}
+
+		if ((inputEvent.buttons & Qt::MidButton) && inputEvent.type == QEvent::MouseMove)
+		{
+			float pixelSize = 2.0f * viewHalfHeight / viewRect.height();
+			viewCenter -= (right * mouseDelta.x() - up * mouseDelta.y()) * pixelSize;
+		}
+	}
+	else if (inputEvent.type == QEvent::Wheel)
+	{
+		float wheelSteps = inputEvent.angleDelta.y() / 120.0f;
+
+		if (keyboardHelper.keyIsDown(Qt::Key_Space))
+		{
+			setCrosshairPosition(crosshairPosition + normal * wheelSteps * sliceStep, boxMaximum);
+			return true;
+		}
+
+		viewHalfHeight = std::min(std::max(viewHalfHeight * std::pow(0.8f, wheelSteps), 0.001f), 10.0f);
+	}
+
+	return false;
+}
+
+void SliceViews::setCrosshairPosition(const QVector3D& position, const QVector3D& boxMaximum)
+{
+	for (int i = 0; i < 3; ++i)
+		crosshairPosition[i] = std::min(std::max(position[i], 0.0f), boxMaximum[i]);
+}
+
+QVector3D SliceViews::getCrosshairPosition() const
+{
+	return crosshairPosition;
+}
+
+// one line through the crosshair along each axis of the box
+void SliceViews::updateCrosshairVertices(const QVector3D& boxMaximum)
+{
+	std::array<QVector3D, 6> crosshairVertexData;
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		crosshairVertexData[axis * 2] = crosshairPosition;
+		crosshairVertexData[axis * 2 + 1] = crosshairPosition;
+		crosshairVertexData[axis * 2][axis] = 0.0f;
+		crosshairVertexData[axis * 2 + 1][axis] = boxMaximum[axis];
+	}
+
+	crosshairVbo.bind();
+	crosshairVbo.write(0, crosshairVertexData.data(), sizeof(crosshairVertexData));
+	crosshairVbo.release();
+}
+
+SliceViewState SliceViews::getState(int view, const QSize& viewSize) const
+{
+	SliceViewState state;
+
+	state.size = viewSize;
+	state.center = getViewCenter(view);
+	state.crosshair = crosshairPosition;
+	state.halfHeight = viewHalfHeight;
+
+	return state;
+}
+
+QMatrix4x4 SliceViews::getViewMatrix(int view, const QSize& viewSize) const
+{
+	QVector3D normal = getNormal(view);
+	QVector3D center = getViewCenter(view);
+	float halfWidth = viewHalfHeight * viewSize.width() / float(std::max(viewSize.height(), 1));
+
+	QMatrix4x4 sliceProjectionMatrix;
+	sliceProjectionMatrix.ortho(-halfWidth, halfWidth, -viewHalfHeight, viewHalfHeight, 0.0f, 2.0f);
+
+	QMatrix4x4 sliceViewMatrix;
+	sliceViewMatrix.lookAt(center + normal, center, sliceUpVectors[view]);
+
+	return sliceProjectionMatrix * sliceViewMatrix;
+}
+
+QOpenGLFramebufferObject& SliceViews::render(int view, const SliceViewState& state, GLuint targetFramebuffer, const std::function<void(const QMatrix4x4& mvp)>& renderSlice)
+{
+	std::unique_ptr<QOpenGLFramebufferObject>& framebuffer = framebuffers[view];
+
+	if (framebuffer != nullptr && state == states[view])
+		return *framebuffer;
+
+	// the views are drawn over the frame with linear filtering like the other framebuffers
+	if (framebuffer == nullptr || framebuffer->size() != state.size)
+	{
+		framebuffer.reset(new QOpenGLFramebufferObject(state.size, QOpenGLFramebufferObject::CombinedDepthStencil, GL_TEXTURE_2D, GL_RGBA8));
+
+		glBindTexture(GL_TEXTURE_2D, framebuffer->texture());
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	framebuffer->bind();
+	glViewport(0, 0, state.size.width(), state.size.height());
+	glScissor(0, 0, state.size.width(), state.size.height());
+
+	glClearColor(state.backgroundColor.redF(), state.backgroundColor.greenF(), state.backgroundColor.blueF(), state.backgroundColor.alphaF());
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glLineWidth(2.0f);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	QMatrix4x4 mvp = getViewMatrix(view, state.size);
+
+	renderSlice(mvp);
+	renderCrosshair(mvp, state.lineColor, view);
+
+	states[view] = state;
+	glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+
+	return *framebuffer;
+}
+
+void SliceViews::renderCrosshair(const QMatrix4x4& mvp, const QColor& lineColor, int view)
+{
+	crosshairProgram.bind();
+	crosshairVao.bind();
+
+	crosshairProgram.setUniformValue("lineColor", lineColor);
+	crosshairProgram.setUniformValue("mvp", mvp);
+
+	// the line along the normal axis of a view would only be a point
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		if (view < 0 || axis != getNormalAxis(view))
+			glDrawArrays(GL_LINES, axis * 2, 2);
+	}
+
+	crosshairVao.release();
+	crosshairProgram.release();
+}
+
+int SliceViews::getNormalAxis(int view)
+{
+	return sliceNormalAxes[view];
+}
+
+QVector3D SliceViews::getNormal(int view)
+{
+	QVector3D result;
+	result[sliceNormalAxes[view]] = 1.0f;
+	return result;
+}
+
+// the shared pan center moved onto the slice of the view
+QVector3D SliceViews::getViewCenter(int view) const
+{
+	QVector3D normal = getNormal(view);
+	return viewCenter + normal * QVector3D::dotProduct(crosshairPosition - viewCenter, normal);
+}
+
+QVector3D SliceViews::getSlicePoint(int view, const QRect& viewRect, int frameHeight, const QPointF& mousePosition) const
+{
+	QVector3D normal = getNormal(view);
+	QVector3D up = sliceUpVectors[view];
+	QVector3D right = QVector3D::crossProduct(up, normal);
+
+	float ndcX = (float(mousePosition.x()) - viewRect.x()) / viewRect.width();
+	float ndcY = (float(mousePosition.y()) - (frameHeight - viewRect.y() - viewRect.height())) / viewRect.height();
+	ndcX = (ndcX - 0.5f) * 2.0f;
+	ndcY = (ndcY - 0.5f) * -2.0f;
+
+	float halfWidth = viewHalfHeight * viewRect.width() / float(viewRect.height());
+
+	return getViewCenter(view) + right * ndcX * halfWidth + up * ndcY * viewHalfHeight;
+}
@@ -0,0 +1,103 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#pragma once
+
+#include <array>
+#include <functional>
+#include <memory>
+
+#include <QOpenGLFunctions>
+#include <QOpenGLBuffer>
+#include <QOpenGLVertexArrayObject>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLFramebufferObject>
+#include <QMatrix4x4>
+#include <QColor>
+#include <QRect>
+
+#include "KeyboardHelper.h"
+#include "RenderThread.h"
+#include "ProgramBinaryCache.h"
+
+namespace CellVision
+{
+	class VolumeResource;
+
+	enum class SlabMode { MAXIMUM, MEAN };
+
+	// everything a slice view of the 2x2 layout is drawn from, the view is only redrawn when some of it changes
+	struct SliceViewState
+	{
+		bool operator==(const SliceViewState& other) const;
+		bool operator!=(const SliceViewState& other) const;
+
+		const VolumeResource* volume = nullptr;
+		QSize size;
+		QVector3D center;
+		QVector3D crosshair;
+		QVector3D cropMinimum;
+		QVector3D cropMaximum;
+		QVector3D displayThreshold;
+		QColor backgroundColor;
+		QColor lineColor;
+		SlabMode slabMode = SlabMode::MAXIMUM;
+		float halfHeight = 0.0f;
+		float slabThickness = 0.0f;
+		bool skipEmptySpace = false;
+	};
+
+	// the XY, XZ and YZ slice views of the 2x2 layout, they go through the crosshair and share their pan and zoom
+	// each view is cached in its own framebuffer until its state changes, the slice itself is drawn by the render widget
+	class SliceViews : protected QOpenGLFunctions
+	{
+	public:
+
+		// needs a current context
+		void initialize(ProgramBinaryCache& programCache);
+		void release();
+
+		// the crosshair and the pan center go to the middle of the box, and the zoom shows all of it
+		void reset(const QVector3D& boxMaximum);
+		// the views are drawn again on the next frame
+		void invalidate();
+
+		// the left button moves the crosshair, the middle button pans, and the wheel zooms or with space moves the slice by the step
+		// returns true if the crosshair moved, the frame height turns the local mouse positions into window coordinates like the view rectangles
+		bool applyInput(int view, const QRect& viewRect, int frameHeight, const InputEvent& inputEvent, KeyboardHelper& keyboardHelper, float sliceStep, const QVector3D& boxMaximum);
+		// the crosshair stays inside the box
+		void setCrosshairPosition(const QVector3D& position, const QVector3D& boxMaximum);
+		QVector3D getCrosshairPosition() const;
+		void updateCrosshairVertices(const QVector3D& boxMaximum);
+
+		// the state of the view without the parts that come from the scene
+		SliceViewState getState(int view, const QSize& viewSize) const;
+		QMatrix4x4 getViewMatrix(int view, const QSize& viewSize) const;
+
+		// redraws the view into its framebuffer if the state has changed, renderSlice draws the slice with the given mvp
+		// the target framebuffer is bound again afterwards, the returned framebuffer is then drawn over the view by the caller
+		QOpenGLFramebufferObject& render(int view, const SliceViewState& state, GLuint targetFramebuffer, const std::function<void(const QMatrix4x4& mvp)>& renderSlice);
+		// the lines through the crosshair along the three axes, or only the two that lie in the slice of a view
+		void renderCrosshair(const QMatrix4x4& mvp, const QColor& lineColor, int view = -1);
+
+		static int getNormalAxis(int view);
+		static QVector3D getNormal(int view);
+
+	private:
+
+		QVector3D getViewCenter(int view) const;
+		QVector3D getSlicePoint(int view, const QRect& viewRect, int frameHeight, const QPointF& mousePosition) const;
+
+		QVector3D crosshairPosition;
+		QVector3D viewCenter;
+		float viewHalfHeight = 1.0f;
+		QPoint previousMousePosition;
+
+		std::array<std::unique_ptr<QOpenGLFramebufferObject>, 3> framebuffers;
+		std::array<SliceViewState, 3> states;
+
+		QOpenGLBuffer crosshairVbo;
+		QOpenGLVertexArrayObject crosshairVao;
+		QOpenGLShaderProgram crosshairProgram;
+	};
+}
@@ -0,0 +1,76 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#include "stdafx.h"
+
+#include "SnapshotRenderer.h"
+#include "OffscreenRenderer.h"
+#include "CameraPath.h"
+#include "ImageSaver.h"
+#include "MainWindow.h"
+#include "Log.h"
+
+using namespace CellVision;
+
+int SnapshotRenderer::run(const SnapshotSettings& settings)
+{
+	Log& log = MainWindow::getLog();
+
+	QString imageFormat = settings.imageFormat.toLower();
+
+	if (imageFormat == "tiff")
+		imageFormat = "tif";
+
+	if (imageFormat != "png" && imageFormat != "tif")
+	{
+		log.logError("Unsupported snapshot format: %s (png and tif are supported)", settings.imageFormat.toStdString());
+		return -1;
+	}
+
+	if (!QDir().mkpath(settings.outputDirectory))
+	{
+		log.logError("Could not create output directory: %s", settings.outputDirectory.toStdString());
+		return -1;
+	}
+
+	RenderWidgetSettings renderWidgetSettings;
+	CameraPath poses;
+
+	if (!OffscreenRenderer::loadSettingsFromFile(settings.datasetFileName, renderWidgetSettings) || !poses.loadFromFile(settings.poseFileName.toStdString()))
+		return -1;
+
+	OffscreenRenderer renderer;
+
+	if (!renderer.initialize(renderWidgetSettings, settings.frameSize))
+		return -1;
+
+	QString baseName = QFileInfo(settings.datasetFileName).completeBaseName();
+	const std::vector<CameraPose>& posesToRender = poses.getPoses();
+	int failedCount = 0;
+
+	QElapsedTimer timer;
+	timer.start();
+
+	// the pose times are not used, every listed pose is rendered exactly once
+	for (size_t i = 0; i < posesToRender.size(); ++i)
+	{
+		renderer.render(posesToRender[i]);
+		QImage image = renderer.getImage();
+
+		QString fileName = QString("%1/%2_%3.%4").arg(settings.outputDirectory, baseName).arg(int(i), 5, 10, QChar('0')).arg(imageFormat);
+		bool saved = (imageFormat == "tif") ? ImageSaver::saveToTiff(fileName.toStdString(), image) : image.save(fileName, "PNG");
+
+		if (!saved)
+		{
+			log.logWarning("Could not save snapshot: %s", fileName.toStdString());
+			++failedCount;
+		}
+
+		if ((i + 1) % 100 == 0)
+			log.logInfo("Rendered %d/%d snapshots", i + 1, posesToRender.size());
+	}
+
+	log.logInfo("Rendered %d snapshots in %.2f s to %s (%d failed)", posesToRender.size(), timer.elapsed() / 1000.0f, settings.outputDirectory.toStdString(), failedCount);
+
+	return (failedCount == 0) ? 0 : -1;
+}
@@ -0,0 +1,28 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#pragma once
+
+#include <QString>
+#include <QSize>
+
+namespace CellVision
+{
+	struct SnapshotSettings
+	{
+		QString datasetFileName;
+		QString poseFileName;
+		QString outputDirectory;
+		QString imageFormat = "png";
+		QSize frameSize = QSize(1920, 1080);
+	};
+
+	// renders one image per pose in the pose file, the volume is uploaded only once for all of them
+	class SnapshotRenderer
+	{
+	public:
+
+		// returns the process exit code
+		static int run(const SnapshotSettings& settings);
+	};
+}
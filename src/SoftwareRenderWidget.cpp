@@ -0,0 +1,425 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#include "stdafx.h"
+
+#include "SoftwareRenderWidget.h"
+#include "MainWindow.h"
+#include "Log.h"
+#include "MathHelper.h"
+#include "ParallelHelper.h"
+#include "VolumeReslicer.h"
+
+using namespace CellVision;
+
+SoftwareRenderWidget::SoftwareRenderWidget(QWidget* parent) : QWidget(parent)
+{
+	setAttribute(Qt::WA_OpaquePaintEvent);
+	setFocusPolicy(Qt::StrongFocus);
+	setFocus();
+
+	timeStepTimer.start();
+	interactionTimer.start();
+	resetCameraPosition();
+	camera.loadSpeeds();
+
+	// repaints continuously like the OpenGL widget, the plane is only resampled when the view changes
+	startTimer(16);
+}
+
+SoftwareRenderWidget::~SoftwareRenderWidget()
+{
+	camera.saveSpeeds();
+}
+
+void SoftwareRenderWidget::initialize(const RenderWidgetSettings& settings_, const std::shared_ptr<SoftwareVolume>& sharedVolume)
+{
+	bool resizeCube = settings.imageWidth != settings_.imageWidth || settings.imageHeight != settings_.imageHeight || settings.imageDepth != settings_.imageDepth;
+	settings = settings_;
+	planeImage = QImage();
+
+	bool reloadVolume = volume == nullptr || volume->imageLoaderInfo != settings.imageLoaderInfo;
+
+	if (reloadVolume)
+	{
+		if (sharedVolume != nullptr && sharedVolume->imageLoaderInfo == settings.imageLoaderInfo)
+			volume = sharedVolume;
+		else
+		{
+			std::shared_ptr<SoftwareVolume> newVolume = std::make_shared<SoftwareVolume>();
+			newVolume->imageLoaderInfo = settings.imageLoaderInfo;
+			newVolume->image = ImageLoader::loadFromMultipageTiff(settings.imageLoaderInfo);
+
+			if (!newVolume->image.data.empty())
+				volume = newVolume;
+		}
+	}
+
+	if (reloadVolume || resizeCube)
+		resetCameraPosition();
+
+	if (reloadVolume)
+		camera.loadSpeeds();
+}
+
+const RenderWidgetSettings& SoftwareRenderWidget::getSettings() const
+{
+	return settings;
+}
+
+std::shared_ptr<SoftwareVolume> SoftwareRenderWidget::getVolume() const
+{
+	return volume;
+}
+
+bool SoftwareRenderWidget::event(QEvent* e)
+{
+	keyboardHelper.event(e);
+
+	if (e->type() == QEvent::KeyPress || e->type() == QEvent::KeyRelease)
+	{
+		QKeyEvent* ke = static_cast<QKeyEvent*>(e);
+
+		if (ke->key() == Qt::Key_Space)
+			camera.updateMouseMode(keyboardHelper);
+	}
+
+	return QWidget::event(e);
+}
+
+void SoftwareRenderWidget::mousePressEvent(QMouseEvent* me)
+{
+	setFocus();
+
+	camera.mousePress(me->buttons(), me->globalPos(), keyboardHelper);
+
+	if (camera.mouseMode == MouseMode::ORBIT)
+		camera.orbitPointWorld = getPlanePoint(me->localPos());
+
+	me->accept();
+}
+
+void SoftwareRenderWidget::mouseReleaseEvent(QMouseEvent* me)
+{
+	camera.mouseRelease(me->buttons(), keyboardHelper);
+	me->accept();
+}
+
+void SoftwareRenderWidget::mouseMoveEvent(QMouseEvent* me)
+{
+	camera.mouseMove(me->globalPos(), keyboardHelper);
+	me->accept();
+}
+
+void SoftwareRenderWidget::wheelEvent(QWheelEvent* we)
+{
+	camera.wheel(we->angleDelta().y() / 120.0f, keyboardHelper);
+	we->accept();
+}
+
+void SoftwareRenderWidget::paintEvent(QPaintEvent* pe)
+{
+	(void)pe;
+
+	QElapsedTimer frameTimer;
+	frameTimer.start();
+
+	updateLogic();
+
+	QPainter painter(this);
+	painter.setRenderHint(QPainter::Antialiasing);
+	painter.setRenderHint(QPainter::TextAntialiasing);
+	painter.setRenderHint(QPainter::SmoothPixmapTransform);
+
+	// BACKGROUND //
+
+	if (renderBackground)
+	{
+		auto scaleColor = [](const QColor& color, float alpha)
+		{
+			return QColor::fromRgbF(std::min(1.0, alpha * color.redF()), std::min(1.0, alpha * color.greenF()), std::min(1.0, alpha * color.blueF()));
+		};
+
+		QLinearGradient gradient(0.0, 0.0, 0.0, height());
+		gradient.setColorAt(0.0, scaleColor(settings.backgroundColor, 1.4f));
+		gradient.setColorAt(1.0, scaleColor(settings.backgroundColor, 0.6f));
+
+		painter.fillRect(rect(), gradient);
+	}
+	else
+		painter.fillRect(rect(), settings.backgroundColor);
+
+	// COORDINATES //
+
+	// the axes run from -10 to 10 and fade out towards the ends like in coordinates.frag
+	if (renderCoordinates)
+	{
+		const int segmentCount = 40;
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			QVector3D direction;
+			direction[axis] = 1.0f;
+
+			QColor color(axis == 0 ? 255 : 0, axis == 1 ? 255 : 0, axis == 2 ? 255 : 0);
+
+			for (int i = 0; i < segmentCount; ++i)
+			{
+				float start = float(i) / segmentCount * 2.0f - 1.0f;
+				float end = float(i + 1) / segmentCount * 2.0f - 1.0f;
+				float middle = (start + end) / 2.0f;
+				QLineF line;
+
+				if (!projectLine(direction * start * 10.0f, direction * end * 10.0f, line))
+					continue;
+
+				color.setAlphaF((1.0f - middle * middle) * 0.5f);
+				painter.setPen(QPen(color, 4.0, Qt::SolidLine, Qt::FlatCap));
+				painter.drawLine(line);
+			}
+		}
+	}
+
+	// CUBE //
+
+	QVector3D boxMaximum(1.0f, settings.imageHeight / settings.imageWidth, settings.imageDepth / settings.imageWidth);
+	painter.setPen(QPen(settings.lineColor, 4.0, Qt::SolidLine, Qt::FlatCap));
+
+	for (int i = 0; i < 8; ++i)
+	{
+		QVector3D corner((i & 1) ? boxMaximum.x() : 0.0f, (i & 2) ? boxMaximum.y() : 0.0f, (i & 4) ? boxMaximum.z() : 0.0f);
+
+		// every edge once, from the corner towards the larger coordinates
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			if (i & (1 << axis))
+				continue;
+
+			QVector3D end = corner;
+			end[axis] = boxMaximum[axis];
+			QLineF line;
+
+			if (projectLine(corner, end, line))
+				painter.drawLine(line);
+		}
+	}
+
+	// PLANE //
+
+	renderPlane(painter);
+
+	// TEXT //
+
+	if (renderText)
+	{
+		QLocale locale(QLocale::English);
+		QVector3D realCameraPosition = camera.position * settings.imageWidth;
+
+		painter.setPen(QColor(0, 0, 0, 96));
+		painter.setBrush(QColor(0, 0, 0, 64));
+		painter.drawRoundRect(-20, 6 + 3 * 17 - 400, 400, 400, 10, 10);
+
+#ifdef __APPLE__
+		int textSize = 12;
+#else
+		int textSize = 10;
+#endif
+
+		QFont font("Roboto Mono", textSize, QFont::Normal);
+		font.setHintingPreference(QFont::PreferFullHinting);
+		font.setStyleStrategy(QFont::PreferAntialias);
+
+		painter.setBrush(Qt::NoBrush);
+		painter.setPen(QColor(255, 255, 255, 255));
+		painter.setFont(font);
+
+		painter.drawText(5, 15, QString("Position: (%1, %2, %3)").arg(locale.toString(realCameraPosition.x(), 'e', 3), locale.toString(realCameraPosition.y(), 'e', 3), locale.toString(realCameraPosition.z(), 'e', 3)));
+		painter.drawText(5, 32, QString("Mode: Software (%1 threads)").arg(ParallelHelper::getThreadCount()));
+		painter.drawText(5, 49, QString("Resolution: %1 % | plane %2 ms | frame %3 ms").arg(QString::number(int(planeImageScale * 100.0f + 0.5f)), QString::number(planeTime, 'f', 1), QString::number(frameTime, 'f', 1)));
+	}
+
+	painter.end();
+
+	frameTime = frameTimer.nsecsElapsed() / 1000000.0f;
+}
+
+void SoftwareRenderWidget::timerEvent(QTimerEvent* te)
+{
+	(void)te;
+
+	update();
+}
+
+void SoftwareRenderWidget::updateLogic()
+{
+	float timeStep = timeStepTimer.nsecsElapsed() / 1000000000.0f;
+	timeStepTimer.restart();
+
+	camera.updateKeys(keyboardHelper, timeStep);
+
+	if (keyboardHelper.keyIsDown(Qt::Key_R))
+	{
+		if (keyboardHelper.keyIsDown(Qt::Key_Control))
+			camera.resetSpeeds();
+		else
+			resetCameraPosition();
+	}
+
+	if (keyboardHelper.keyIsDownOnce(Qt::Key_B))
+		renderBackground = !renderBackground;
+
+	if (keyboardHelper.keyIsDownOnce(Qt::Key_C))
+		renderCoordinates = !renderCoordinates;
+
+	if (keyboardHelper.keyIsDownOnce(Qt::Key_T))
+		renderText = !renderText;
+
+	camera.updateMatrices();
+
+	projectionMatrix.setToIdentity();
+	projectionMatrix.perspective(45.0f, float(width()) / float(std::max(height(), 1)), 0.001f, 100.0f);
+
+	planePosition = camera.position + camera.planeDistance * camera.forward;
+	planeNormal = -camera.forward;
+
+	if (camera.viewMatrix != previousViewMatrix || camera.planeDistance != previousPlaneDistance)
+		interactionTimer.restart();
+
+	previousViewMatrix = camera.viewMatrix;
+	previousPlaneDistance = camera.planeDistance;
+}
+
+void SoftwareRenderWidget::resetCameraPosition()
+{
+	camera.resetPosition(QVector3D(1.0f, settings.imageHeight / settings.imageWidth, settings.imageDepth / settings.imageWidth));
+}
+
+// the plane is parallel to the screen, so its image is the volume resampled on a regular grid with one sample per screen pixel
+// only the bounding rectangle of the intersection polygon is resampled, and the polygon clips it like the box clips the GL plane
+void SoftwareRenderWidget::renderPlane(QPainter& painter)
+{
+	if (camera.planeDistance <= 0.001f)
+		return;
+
+	QVector3D boxMaximum(1.0f, settings.imageHeight / settings.imageWidth, settings.imageDepth / settings.imageWidth);
+	std::array<QVector3D, 6> planeVertexData;
+	int planeVertexCount = MathHelper::intersectPlaneWithBox(planeVertexData, planePosition, planeNormal, QVector3D(0.0f, 0.0f, 0.0f), boxMaximum, camera.right, camera.up);
+
+	if (planeVertexCount < 3)
+		return;
+
+	QPolygonF polygon;
+
+	for (int i = 0; i < planeVertexCount; ++i)
+		polygon << projectPoint(camera.viewMatrix * planeVertexData[i]);
+
+	QRect bounds = polygon.boundingRect().toAlignedRect() & rect();
+
+	if (volume != nullptr && !bounds.isEmpty())
+	{
+		float scale = (interactionTimer.elapsed() < refinementDelay) ? interactionScale : 1.0f;
+
+		if (planeImage.isNull() || bounds != planeImageBounds || scale != planeImageScale || camera.viewMatrix != planeImageViewMatrix || camera.planeDistance != planeImageDistance)
+			updatePlaneImage(bounds, scale);
+
+		QPainterPath clipPath;
+		clipPath.addPolygon(polygon);
+
+		painter.save();
+		painter.setClipPath(clipPath);
+		painter.drawImage(QRectF(bounds.topLeft(), QSizeF(planeImage.width() / scale, planeImage.height() / scale)), planeImage);
+		painter.restore();
+	}
+
+	painter.setPen(QPen(settings.lineColor, 4.0, Qt::SolidLine, Qt::FlatCap));
+	painter.setBrush(Qt::NoBrush);
+	painter.drawPolygon(polygon);
+}
+
+void SoftwareRenderWidget::updatePlaneImage(const QRect& bounds, float scale)
+{
+	QElapsedTimer timer;
+	timer.start();
+
+	// the first sample is at the center of the top left (scaled) pixel, rows go down the screen
+	float pixelSize = getPlanePixelSize();
+	QVector3D origin = getPlanePoint(QPointF(bounds.left() + 0.5f / scale, bounds.top() + 0.5f / scale)) * settings.imageWidth;
+
+	ReslicePlane plane;
+	plane.origin = { { origin.x(), origin.y(), origin.z() } };
+	plane.axisX = { { camera.right.x(), camera.right.y(), camera.right.z() } };
+	plane.axisY = { { -camera.up.x(), -camera.up.y(), -camera.up.z() } };
+	plane.spacingX = pixelSize / scale * settings.imageWidth;
+	plane.spacingY = plane.spacingX;
+	plane.width = uint32_t(std::max(int(std::ceil(bounds.width() * scale)), 1));
+	plane.height = uint32_t(std::max(int(std::ceil(bounds.height() * scale)), 1));
+
+	ResliceImage image = VolumeReslicer::reslice(volume->image, { { settings.imageWidth, settings.imageHeight, settings.imageDepth } }, plane, ResliceInterpolation::TRILINEAR);
+
+	if (planeImage.width() != int(image.width) || planeImage.height() != int(image.height))
+		planeImage = QImage(int(image.width), int(image.height), QImage::Format_RGB32);
+
+	ParallelHelper::parallelFor(image.height, [&](uint64_t y)
+	{
+		const float* source = &image.data[y * image.width * 3];
+		QRgb* destination = reinterpret_cast<QRgb*>(planeImage.scanLine(int(y)));
+
+		for (uint32_t x = 0; x < image.width; ++x)
+		{
+			int red = int(std::min(source[x * 3], 1.0f) * 255.0f + 0.5f);
+			int green = int(std::min(source[x * 3 + 1], 1.0f) * 255.0f + 0.5f);
+			int blue = int(std::min(source[x * 3 + 2], 1.0f) * 255.0f + 0.5f);
+
+			destination[x] = qRgb(red, green, blue);
+		}
+	});
+
+	planeImageBounds = bounds;
+	planeImageScale = scale;
+	planeImageViewMatrix = camera.viewMatrix;
+	planeImageDistance = camera.planeDistance;
+	planeTime = timer.nsecsElapsed() / 1000000.0f;
+}
+
+// clips the line to the near plane, returns false if it is completely behind it
+bool SoftwareRenderWidget::projectLine(const QVector3D& start, const QVector3D& end, QLineF& line) const
+{
+	const float nearDistance = 0.001f;
+
+	QVector3D cameraStart = camera.viewMatrix * start;
+	QVector3D cameraEnd = camera.viewMatrix * end;
+
+	if (cameraStart.z() > -nearDistance && cameraEnd.z() > -nearDistance)
+		return false;
+
+	if (cameraStart.z() > -nearDistance)
+		cameraStart = cameraEnd + (cameraStart - cameraEnd) * ((-nearDistance - cameraEnd.z()) / (cameraStart.z() - cameraEnd.z()));
+	else if (cameraEnd.z() > -nearDistance)
+		cameraEnd = cameraStart + (cameraEnd - cameraStart) * ((-nearDistance - cameraStart.z()) / (cameraEnd.z() - cameraStart.z()));
+
+	line = QLineF(projectPoint(cameraStart), projectPoint(cameraEnd));
+
+	return true;
+}
+
+QPointF SoftwareRenderWidget::projectPoint(const QVector3D& cameraSpacePosition) const
+{
+	QVector4D clipPosition = projectionMatrix * QVector4D(cameraSpacePosition, 1.0f);
+	float ndcX = clipPosition.x() / clipPosition.w();
+	float ndcY = clipPosition.y() / clipPosition.w();
+
+	return QPointF((ndcX + 1.0f) / 2.0f * width(), (1.0f - ndcY) / 2.0f * height());
+}
+
+QVector3D SoftwareRenderWidget::getPlanePoint(const QPointF& screenPosition) const
+{
+	float pixelSize = getPlanePixelSize();
+
+	return planePosition + camera.right * float((screenPosition.x() - width() / 2.0) * pixelSize) + camera.up * float((height() / 2.0 - screenPosition.y()) * pixelSize);
+}
+
+// world units per screen pixel on the plane, from the 45 degree vertical field of view
+float SoftwareRenderWidget::getPlanePixelSize() const
+{
+	return 2.0f * camera.planeDistance * std::tan(22.5f * float(M_PI) / 180.0f) / float(std::max(height(), 1));
+}
@@ -0,0 +1,90 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#pragma once
+
+#include <array>
+#include <memory>
+
+#include <QWidget>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QMatrix4x4>
+
+#include "CameraController.h"
+#include "KeyboardHelper.h"
+#include "ImageLoader.h"
+#include "RenderWidget.h"
+
+namespace CellVision
+{
+	struct SoftwareVolume
+	{
+		ImageLoaderInfo imageLoaderInfo;
+		ImageLoaderResult image;
+	};
+
+	// the slice view without OpenGL, for when a 3.3 context cannot be created (e.g. remote desktops)
+	// the plane always faces the camera, so it is resampled on the CPU straight into screen pixels and the lines are drawn with QPainter
+	class SoftwareRenderWidget : public QWidget
+	{
+	public:
+
+		explicit SoftwareRenderWidget(QWidget* parent = nullptr);
+		~SoftwareRenderWidget();
+
+		void initialize(const RenderWidgetSettings& settings, const std::shared_ptr<SoftwareVolume>& sharedVolume = nullptr);
+		const RenderWidgetSettings& getSettings() const;
+		std::shared_ptr<SoftwareVolume> getVolume() const;
+
+	protected:
+
+		bool event(QEvent* e) override;
+
+		void mousePressEvent(QMouseEvent* me) override;
+		void mouseReleaseEvent(QMouseEvent* me) override;
+		void mouseMoveEvent(QMouseEvent* me) override;
+		void wheelEvent(QWheelEvent* we) override;
+
+		void paintEvent(QPaintEvent* pe) override;
+		void timerEvent(QTimerEvent* te) override;
+
+	private:
+
+		void updateLogic();
+		void resetCameraPosition();
+		void renderPlane(QPainter& painter);
+		void updatePlaneImage(const QRect& bounds, float scale);
+		bool projectLine(const QVector3D& start, const QVector3D& end, QLineF& line) const;
+		QPointF projectPoint(const QVector3D& cameraSpacePosition) const;
+		QVector3D getPlanePoint(const QPointF& screenPosition) const;
+		float getPlanePixelSize() const;
+
+		RenderWidgetSettings settings;
+		std::shared_ptr<SoftwareVolume> volume;
+
+		KeyboardHelper keyboardHelper;
+		CameraController camera;
+		QElapsedTimer timeStepTimer;
+		QMatrix4x4 projectionMatrix;
+		QVector3D planePosition;
+		QVector3D planeNormal;
+		bool renderBackground = true;
+		bool renderCoordinates = true;
+		bool renderText = true;
+
+		// the plane is resampled at a lower resolution while the view changes and again at full resolution once it is still
+		QImage planeImage;
+		QRect planeImageBounds;
+		QMatrix4x4 planeImageViewMatrix;
+		float planeImageDistance = 0.0f;
+		float planeImageScale = 0.0f;
+		QElapsedTimer interactionTimer;
+		QMatrix4x4 previousViewMatrix;
+		float previousPlaneDistance = 0.0f;
+		float interactionScale = 0.5f;
+		qint64 refinementDelay = 150;
+		float planeTime = 0.0f;
+		float frameTime = 0.0f;
+	};
+}
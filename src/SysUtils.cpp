@@ -5,6 +5,13 @@
 
 #include "SysUtils.h"
 
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
 using namespace CellVision;
 
 void SysUtils::openFileExternally(const std::string& filePath)
@@ -61,3 +68,26 @@ void SysUtils::setConsoleTextColor(ConsoleTextColor color)
 	}
 #endif
 }
+
+uint64_t SysUtils::getPeakMemoryUsage()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return uint64_t(counters.PeakWorkingSetSize);
+
+	return 0;
+#else
+	struct rusage usage;
+
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+
+#ifdef __APPLE__
+	return uint64_t(usage.ru_maxrss);
+#else
+	return uint64_t(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include <cstdint>
+
 namespace CellVision
 {
 	enum class ConsoleTextColor
@@ -20,5 +22,8 @@ namespace CellVision
 
 		static void openFileExternally(const std::string& filePath);
 		static void setConsoleTextColor(ConsoleTextColor color);
+
+		// in bytes, zero if the platform does not report it
+		static uint64_t getPeakMemoryUsage();
 	};
 }
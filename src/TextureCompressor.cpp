@@ -0,0 +1,302 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#include "stdafx.h"
+
+#include "TextureCompressor.h"
+#include "MipmapGenerator.h"
+#include "ParallelHelper.h"
+#include "MainWindow.h"
+#include "Log.h"
+
+using namespace CellVision;
+
+namespace
+{
+	struct SliceError
+	{
+		uint64_t squaredErrorSum = 0;
+		uint32_t maximumError = 0;
+	};
+}
+
+std::vector<CompressedChannel> TextureCompressor::compressVolume(const ImageLoaderResult& volume, const std::array<bool, 3>& channelsEnabled, float spacingX, float spacingY, float spacingZ)
+{
+	Log& log = MainWindow::getLog();
+	log.logInfo("Compressing %dx%dx%d volume to RGTC1", volume.width, volume.height, volume.depth);
+
+	const uint32_t channelCount = 3;
+	uint32_t levelCount = MipmapGenerator::getMipLevelCount(volume.width, volume.height, 1);
+	uint64_t sliceSize = uint64_t(volume.width) * volume.height;
+
+	std::vector<CompressedChannel> channels(channelCount);
+	std::vector<SliceError> sliceErrors(uint64_t(volume.depth) * channelCount);
+
+	for (uint32_t c = 0; c < channelCount; ++c)
+	{
+		CompressedChannel& channel = channels[c];
+		channel.width = volume.width;
+		channel.height = volume.height;
+		channel.depth = volume.depth;
+
+		if (!channelsEnabled[c])
+			continue;
+
+		for (uint32_t level = 0; level < levelCount; ++level)
+		{
+			uint32_t levelWidth = std::max(1u, volume.width >> level);
+			uint32_t levelHeight = std::max(1u, volume.height >> level);
+
+			channel.levels.push_back(std::vector<uint8_t>(getLayerSize(levelWidth, levelHeight) * volume.depth));
+		}
+	}
+
+	ParallelHelper::parallelFor(volume.depth, [&](uint64_t z)
+	{
+		ImageLoaderResult slice;
+		slice.width = volume.width;
+		slice.height = volume.height;
+		slice.depth = 1;
+		slice.data.assign(volume.data.begin() + z * sliceSize, volume.data.begin() + (z + 1) * sliceSize);
+
+		std::vector<ImageLoaderResult> sliceLevels = MipmapGenerator::generateMipmaps(slice, spacingX, spacingY, spacingZ);
+
+		for (uint32_t level = 0; level < levelCount; ++level)
+		{
+			const ImageLoaderResult& source = (level == 0) ? slice : sliceLevels[level - 1];
+			uint64_t layerSize = getLayerSize(source.width, source.height);
+
+			for (uint32_t c = 0; c < channelCount; ++c)
+			{
+				if (!channelsEnabled[c])
+					continue;
+
+				uint8_t* block = &channels[c].levels[level][z * layerSize];
+				SliceError& sliceError = sliceErrors[z * channelCount + c];
+
+				for (uint32_t by = 0; by < source.height; by += 4)
+				{
+					for (uint32_t bx = 0; bx < source.width; bx += 4)
+					{
+						uint8_t texels[16];
+
+						// partial blocks at the right and bottom edges repeat the last row and column
+						for (uint32_t y = 0; y < 4; ++y)
+						{
+							for (uint32_t x = 0; x < 4; ++x)
+							{
+								uint32_t sx = std::min(bx + x, source.width - 1);
+								uint32_t sy = std::min(by + y, source.height - 1);
+
+								texels[y * 4 + x] = uint8_t(source.data[uint64_t(sy) * source.width + sx] >> (c * 8));
+							}
+						}
+
+						encodeBlock(texels, block);
+
+						if (level == 0)
+						{
+							uint8_t decoded[16];
+							decodeBlock(block, decoded);
+
+							for (uint32_t y = 0; y < 4 && by + y < source.height; ++y)
+							{
+								for (uint32_t x = 0; x < 4 && bx + x < source.width; ++x)
+								{
+									uint32_t error = uint32_t(std::abs(int32_t(decoded[y * 4 + x]) - int32_t(texels[y * 4 + x])));
+									sliceError.squaredErrorSum += error * error;
+									sliceError.maximumError = std::max(sliceError.maximumError, error);
+								}
+							}
+						}
+
+						block += 8;
+					}
+				}
+			}
+		}
+	});
+
+	uint64_t voxelCount = sliceSize * volume.depth;
+	const char* channelNames[] = { "red", "green", "blue" };
+
+	for (uint32_t c = 0; c < channelCount; ++c)
+	{
+		if (!channelsEnabled[c])
+			continue;
+
+		CompressedChannel& channel = channels[c];
+		uint64_t squaredErrorSum = 0;
+
+		for (uint32_t z = 0; z < volume.depth; ++z)
+		{
+			squaredErrorSum += sliceErrors[z * channelCount + c].squaredErrorSum;
+			channel.maximumError = std::max(channel.maximumError, sliceErrors[z * channelCount + c].maximumError);
+		}
+
+		double meanSquaredError = (voxelCount > 0) ? double(squaredErrorSum) / double(voxelCount) : 0.0;
+
+		channel.rootMeanSquareError = std::sqrt(meanSquaredError);
+		channel.peakSignalToNoiseRatio = (meanSquaredError > 0.0) ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError) : std::numeric_limits<double>::infinity();
+
+		log.logInfo("RGTC1 %s channel: RMSE %.3f | PSNR %.2f dB | max error %d", channelNames[c], channel.rootMeanSquareError, channel.peakSignalToNoiseRatio, channel.maximumError);
+	}
+
+	return channels;
+}
+
+void TextureCompressor::decodeVolume(const std::vector<CompressedChannel>& channels, ImageLoaderResult& volume)
+{
+	uint64_t sliceSize = uint64_t(volume.width) * volume.height;
+	uint64_t layerSize = getLayerSize(volume.width, volume.height);
+
+	ParallelHelper::parallelFor(volume.depth, [&](uint64_t z)
+	{
+		for (uint32_t c = 0; c < uint32_t(channels.size()); ++c)
+		{
+			if (channels[c].levels.empty())
+				continue;
+
+			const uint8_t* block = &channels[c].levels[0][z * layerSize];
+			uint32_t shift = c * 8;
+
+			for (uint32_t by = 0; by < volume.height; by += 4)
+			{
+				for (uint32_t bx = 0; bx < volume.width; bx += 4)
+				{
+					uint8_t texels[16];
+					decodeBlock(block, texels);
+
+					for (uint32_t y = 0; y < 4 && by + y < volume.height; ++y)
+					{
+						for (uint32_t x = 0; x < 4 && bx + x < volume.width; ++x)
+						{
+							uint32_t& voxel = volume.data[z * sliceSize + uint64_t(by + y) * volume.width + bx + x];
+							voxel = (voxel & ~(0xffu << shift)) | (uint32_t(texels[y * 4 + x]) << shift);
+						}
+					}
+
+					block += 8;
+				}
+			}
+		}
+	});
+}
+
+uint64_t TextureCompressor::getLayerSize(uint32_t width, uint32_t height)
+{
+	return uint64_t((width + 3) / 4) * ((height + 3) / 4) * 8;
+}
+
+void TextureCompressor::encodeBlock(const uint8_t* texels, uint8_t* block)
+{
+	uint8_t minimum = 255;
+	uint8_t maximum = 0;
+	uint8_t innerMinimum = 255;
+	uint8_t innerMaximum = 0;
+
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		minimum = std::min(minimum, texels[i]);
+		maximum = std::max(maximum, texels[i]);
+
+		if (texels[i] != 0 && texels[i] != 255)
+		{
+			innerMinimum = std::min(innerMinimum, texels[i]);
+			innerMaximum = std::max(innerMaximum, texels[i]);
+		}
+	}
+
+	uint8_t palette[8];
+	uint64_t indices = 0;
+	uint8_t endpoint0 = maximum;
+	uint8_t endpoint1 = minimum;
+
+	// eight interpolated values between the extremes (endpoint0 > endpoint1)
+	generatePalette(endpoint0, endpoint1, palette);
+	uint32_t error = encodeIndices(texels, palette, indices);
+
+	// six interpolated values plus exact 0 and 255 (endpoint0 <= endpoint1), better for blocks with saturated or empty voxels
+	if (error > 0 && innerMinimum <= innerMaximum && (minimum == 0 || maximum == 255))
+	{
+		uint64_t alternativeIndices = 0;
+
+		generatePalette(innerMinimum, innerMaximum, palette);
+		uint32_t alternativeError = encodeIndices(texels, palette, alternativeIndices);
+
+		if (alternativeError < error)
+		{
+			endpoint0 = innerMinimum;
+			endpoint1 = innerMaximum;
+			indices = alternativeIndices;
+		}
+	}
+
+	block[0] = endpoint0;
+	block[1] = endpoint1;
+
+	for (uint32_t i = 0; i < 6; ++i)
+		block[2 + i] = uint8_t(indices >> (i * 8));
+}
+
+void TextureCompressor::decodeBlock(const uint8_t* block, uint8_t* texels)
+{
+	uint8_t palette[8];
+	uint64_t indices = 0;
+
+	generatePalette(block[0], block[1], palette);
+
+	for (uint32_t i = 0; i < 6; ++i)
+		indices |= uint64_t(block[2 + i]) << (i * 8);
+
+	for (uint32_t i = 0; i < 16; ++i)
+		texels[i] = palette[(indices >> (i * 3)) & 0x7];
+}
+
+void TextureCompressor::generatePalette(uint8_t endpoint0, uint8_t endpoint1, uint8_t* palette)
+{
+	palette[0] = endpoint0;
+	palette[1] = endpoint1;
+
+	if (endpoint0 > endpoint1)
+	{
+		for (uint32_t i = 1; i < 7; ++i)
+			palette[i + 1] = uint8_t(((7 - i) * endpoint0 + i * endpoint1 + 3) / 7);
+
+		return;
+	}
+
+	for (uint32_t i = 1; i < 5; ++i)
+		palette[i + 1] = uint8_t(((5 - i) * endpoint0 + i * endpoint1 + 2) / 5);
+
+	palette[6] = 0;
+	palette[7] = 255;
+}
+
+uint32_t TextureCompressor::encodeIndices(const uint8_t* texels, const uint8_t* palette, uint64_t& indices)
+{
+	uint32_t totalError = 0;
+	indices = 0;
+
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		uint32_t bestIndex = 0;
+		uint32_t bestError = std::numeric_limits<uint32_t>::max();
+
+		for (uint32_t j = 0; j < 8; ++j)
+		{
+			uint32_t error = uint32_t(std::abs(int32_t(texels[i]) - int32_t(palette[j])));
+
+			if (error < bestError)
+			{
+				bestError = error;
+				bestIndex = j;
+			}
+		}
+
+		indices |= uint64_t(bestIndex) << (i * 3);
+		totalError += bestError * bestError;
+	}
+
+	return totalError;
+}
@@ -0,0 +1,46 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "ImageLoader.h"
+
+namespace CellVision
+{
+	struct CompressedChannel
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t depth = 0;
+		std::vector<std::vector<uint8_t>> levels;
+		double rootMeanSquareError = 0.0;
+		double peakSignalToNoiseRatio = 0.0;
+		uint32_t maximumError = 0;
+	};
+
+	class TextureCompressor
+	{
+	public:
+
+		// every slice of every enabled channel is encoded into RGTC1 (BC4) blocks, one 2D texture array per channel
+		// the disabled channels are returned without any levels
+		// the mip levels only reduce x and y because the slices are stored as array layers, the z spacing still limits their filter footprint
+		static std::vector<CompressedChannel> compressVolume(const ImageLoaderResult& volume, const std::array<bool, 3>& channelsEnabled, float spacingX, float spacingY, float spacingZ);
+		static uint64_t getLayerSize(uint32_t width, uint32_t height);
+
+		// replaces the voxels with the base level values that the GPU will sample, so that the CPU side matches the compressed textures
+		static void decodeVolume(const std::vector<CompressedChannel>& channels, ImageLoaderResult& volume);
+
+		static void encodeBlock(const uint8_t* texels, uint8_t* block);
+		static void decodeBlock(const uint8_t* block, uint8_t* texels);
+
+	private:
+
+		static void generatePalette(uint8_t endpoint0, uint8_t endpoint1, uint8_t* palette);
+		static uint32_t encodeIndices(const uint8_t* texels, const uint8_t* palette, uint64_t& indices);
+	};
+}
@@ -0,0 +1,210 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#include "stdafx.h"
+
+#include <limits>
+
+#include "VolumeReslicer.h"
+#include "ParallelHelper.h"
+
+using namespace CellVision;
+
+namespace
+{
+	const uint32_t TILE_SIZE = VolumeReslicer::TILE_SIZE;
+
+	// adds weight * voxel for a run of voxel indices, the channels stay in their stored range until the end of the row
+	struct PackedVoxelReader
+	{
+		const uint32_t* data;
+
+		template <typename Index>
+		void accumulate(const Index* indices, const float* weights, uint32_t count, float* red, float* green, float* blue) const
+		{
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				uint32_t value = data[indices[i]];
+
+				red[i] += weights[i] * float(value & 0xff);
+				green[i] += weights[i] * float((value >> 8) & 0xff);
+				blue[i] += weights[i] * float((value >> 16) & 0xff);
+			}
+		}
+
+		float getScale() const
+		{
+			return 1.0f / 255.0f;
+		}
+	};
+
+	struct PlanarVoxelReader
+	{
+		std::array<const uint16_t*, 3> data;
+
+		template <typename Index>
+		void accumulate(const Index* indices, const float* weights, uint32_t count, float* red, float* green, float* blue) const
+		{
+			float* channels[] = { red, green, blue };
+
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				const uint16_t* channelData = data[c];
+				float* channel = channels[c];
+
+				if (channelData == nullptr)
+					continue;
+
+				for (uint32_t i = 0; i < count; ++i)
+					channel[i] += weights[i] * float(channelData[indices[i]]);
+			}
+		}
+
+		float getScale() const
+		{
+			return 1.0f / 65535.0f;
+		}
+	};
+
+	// the output is split into square tiles that are handed out to the threads, within a tile every row is processed in
+	// separate passes over small arrays (coordinates, one corner's indices and weights, gather and accumulate) so that the
+	// loops are branchless and the compiler can vectorize them, including the gathers
+	// rows are always processed at the full tile width (the extra pixels of edge tiles are clamped inside and dropped), the fixed
+	// trip counts let the vectorizer work without remainder loops, and 32-bit voxel indices are used whenever the volume is small enough
+	template <typename Index, typename VoxelReader>
+	ResliceImage resliceTiled(uint32_t width, uint32_t height, uint32_t depth, const std::array<float, 3>& imageSize, const ReslicePlane& plane, ResliceInterpolation interpolation, const VoxelReader& reader)
+	{
+		ResliceImage result;
+		result.width = plane.width;
+		result.height = plane.height;
+		result.data.resize(uint64_t(plane.width) * plane.height * 3, 0.0f);
+
+		if (result.data.empty() || width == 0 || height == 0 || depth == 0)
+			return result;
+
+		// physical position -> texcoord (x / imageWidth, y / imageHeight, 1 - z / imageDepth) -> voxel (texcoord * size - 0.5)
+		// the mapping is affine, so the voxel coordinates step by a constant amount per output pixel and row
+		const float size[] = { float(width), float(height), float(depth) };
+		const float scale[] = { size[0] / imageSize[0], size[1] / imageSize[1], -size[2] / imageSize[2] };
+		const float offset[] = { -0.5f, -0.5f, size[2] - 0.5f };
+
+		std::array<float, 3> start, stepX, stepY;
+
+		for (uint32_t a = 0; a < 3; ++a)
+		{
+			start[a] = plane.origin[a] * scale[a] + offset[a];
+			stepX[a] = plane.axisX[a] * plane.spacingX * scale[a];
+			stepY[a] = plane.axisY[a] * plane.spacingY * scale[a];
+		}
+
+		const Index strides[] = { 1, Index(width), Index(width) * Index(height) };
+		const int32_t limits[] = { int32_t(width), int32_t(height), int32_t(depth) };
+		const uint32_t tileCountX = (plane.width + TILE_SIZE - 1) / TILE_SIZE;
+		const uint32_t tileCountY = (plane.height + TILE_SIZE - 1) / TILE_SIZE;
+		const bool trilinear = (interpolation == ResliceInterpolation::TRILINEAR);
+		const float valueScale = reader.getScale();
+
+		ParallelHelper::parallelFor(uint64_t(tileCountX) * tileCountY, [&](uint64_t tileIndex)
+		{
+			const uint32_t tileX = uint32_t(tileIndex % tileCountX) * TILE_SIZE;
+			const uint32_t tileY = uint32_t(tileIndex / tileCountX) * TILE_SIZE;
+			const uint32_t count = std::min(TILE_SIZE, plane.width - tileX);
+			const uint32_t rowCount = std::min(TILE_SIZE, plane.height - tileY);
+
+			alignas(32) float coordinates[TILE_SIZE];
+			alignas(32) Index axisOffsets[3][2][TILE_SIZE];
+			alignas(32) float axisWeights[3][2][TILE_SIZE];
+			alignas(32) Index indices[TILE_SIZE];
+			alignas(32) float weights[TILE_SIZE];
+			alignas(32) float red[TILE_SIZE];
+			alignas(32) float green[TILE_SIZE];
+			alignas(32) float blue[TILE_SIZE];
+
+			for (uint32_t row = 0; row < rowCount; ++row)
+			{
+				const uint32_t y = tileY + row;
+
+				// nearest is a single neighbor with full weight, trilinear blends the two neighbors on every axis
+				// neighbors outside the volume are the black border, their offsets are clamped inside and their weights are zero
+				for (uint32_t a = 0; a < 3; ++a)
+				{
+					const float rowStart = start[a] + float(y) * stepY[a] + float(tileX) * stepX[a];
+					const int32_t limit = limits[a] - 1;
+
+					// far away coordinates are pulled in first so that they fit the integer cells
+					for (uint32_t i = 0; i < TILE_SIZE; ++i)
+						coordinates[i] = std::min(std::max(rowStart + float(i) * stepX[a] + (trilinear ? 0.0f : 0.5f), -2.0f), float(limit) + 2.0f);
+
+					for (uint32_t i = 0; i < TILE_SIZE; ++i)
+					{
+						float cell = std::floor(coordinates[i]);
+						float fraction = coordinates[i] - cell;
+						int32_t cell0 = int32_t(cell);
+						int32_t cell1 = cell0 + 1;
+
+						axisOffsets[a][0][i] = Index(std::min(std::max(cell0, 0), limit)) * strides[a];
+						axisOffsets[a][1][i] = Index(std::min(std::max(cell1, 0), limit)) * strides[a];
+						axisWeights[a][0][i] = (cell0 >= 0 && cell0 <= limit) ? (trilinear ? 1.0f - fraction : 1.0f) : 0.0f;
+						axisWeights[a][1][i] = (cell1 >= 0 && cell1 <= limit) ? fraction : 0.0f;
+					}
+				}
+
+				std::fill(red, red + TILE_SIZE, 0.0f);
+				std::fill(green, green + TILE_SIZE, 0.0f);
+				std::fill(blue, blue + TILE_SIZE, 0.0f);
+
+				const uint32_t cornerCount = trilinear ? 8 : 1;
+
+				for (uint32_t corner = 0; corner < cornerCount; ++corner)
+				{
+					const uint32_t cx = corner & 1;
+					const uint32_t cy = (corner >> 1) & 1;
+					const uint32_t cz = (corner >> 2) & 1;
+
+					for (uint32_t i = 0; i < TILE_SIZE; ++i)
+					{
+						indices[i] = axisOffsets[0][cx][i] + axisOffsets[1][cy][i] + axisOffsets[2][cz][i];
+						weights[i] = axisWeights[0][cx][i] * axisWeights[1][cy][i] * axisWeights[2][cz][i];
+					}
+
+					reader.accumulate(indices, weights, TILE_SIZE, red, green, blue);
+				}
+
+				float* output = &result.data[(uint64_t(y) * plane.width + tileX) * 3];
+
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					output[i * 3] = red[i] * valueScale;
+					output[i * 3 + 1] = green[i] * valueScale;
+					output[i * 3 + 2] = blue[i] * valueScale;
+				}
+			}
+		});
+
+		return result;
+	}
+}
+
+ResliceImage VolumeReslicer::reslice(const ImageLoaderResult& volume, const std::array<float, 3>& imageSize, const ReslicePlane& plane, ResliceInterpolation interpolation)
+{
+	PackedVoxelReader reader;
+	reader.data = volume.data.data();
+
+	if (uint64_t(volume.width) * volume.height * volume.depth <= std::numeric_limits<uint32_t>::max())
+		return resliceTiled<uint32_t>(volume.width, volume.height, volume.depth, imageSize, plane, interpolation, reader);
+	else
+		return resliceTiled<uint64_t>(volume.width, volume.height, volume.depth, imageSize, plane, interpolation, reader);
+}
+
+ResliceImage VolumeReslicer::reslice(const ImageLoaderResult16& volume, const std::array<float, 3>& imageSize, const ReslicePlane& plane, ResliceInterpolation interpolation)
+{
+	PlanarVoxelReader reader;
+
+	for (uint32_t c = 0; c < 3; ++c)
+		reader.data[c] = volume.channelData[c].empty() ? nullptr : volume.channelData[c].data();
+
+	if (uint64_t(volume.width) * volume.height * volume.depth <= std::numeric_limits<uint32_t>::max())
+		return resliceTiled<uint32_t>(volume.width, volume.height, volume.depth, imageSize, plane, interpolation, reader);
+	else
+		return resliceTiled<uint64_t>(volume.width, volume.height, volume.depth, imageSize, plane, interpolation, reader);
+}
@@ -0,0 +1,48 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "ImageLoader.h"
+
+namespace CellVision
+{
+	enum class ResliceInterpolation { NEAREST, TRILINEAR };
+
+	// positions and spacings are in the physical units of the image size (imageWidth, imageHeight, imageDepth)
+	// origin is the center of the first output pixel, the axes are unit vectors along the output rows and columns
+	struct ReslicePlane
+	{
+		std::array<float, 3> origin = { { 0.0f, 0.0f, 0.0f } };
+		std::array<float, 3> axisX = { { 1.0f, 0.0f, 0.0f } };
+		std::array<float, 3> axisY = { { 0.0f, 1.0f, 0.0f } };
+		float spacingX = 1.0f;
+		float spacingY = 1.0f;
+		uint32_t width = 0;
+		uint32_t height = 0;
+	};
+
+	// interleaved RGB with values normalized to [0, 1], the first row is the one through the plane origin
+	struct ResliceImage
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		std::vector<float> data;
+	};
+
+	class VolumeReslicer
+	{
+	public:
+
+		// samples the volume like sampleVolume in sampling.frag does on the uncompressed texture (texcoord z flipped, clamped to a black border)
+		// but always from the full resolution level
+		static ResliceImage reslice(const ImageLoaderResult& volume, const std::array<float, 3>& imageSize, const ReslicePlane& plane, ResliceInterpolation interpolation);
+		static ResliceImage reslice(const ImageLoaderResult16& volume, const std::array<float, 3>& imageSize, const ReslicePlane& plane, ResliceInterpolation interpolation);
+
+		static const uint32_t TILE_SIZE = 64;
+	};
+}
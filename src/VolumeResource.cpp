@@ -0,0 +1,736 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#include "stdafx.h"
+
+#include "VolumeResource.h"
+#include "MainWindow.h"
+#include "Log.h"
+#include "MipmapGenerator.h"
+#include "TextureCompressor.h"
+#include "BrickQuantizer.h"
+
+using namespace CellVision;
+
+namespace
+{
+	// the voxels are stored x first, then y, then z
+	template <typename T>
+	std::vector<T> cropVoxels(const std::vector<T>& voxels, uint32_t width, uint32_t height, const std::array<int, 3>& minimum, const std::array<int, 3>& maximum)
+	{
+		std::vector<T> croppedVoxels;
+
+		if (voxels.empty())
+			return croppedVoxels;
+
+		croppedVoxels.reserve(uint64_t(maximum[0] - minimum[0]) * (maximum[1] - minimum[1]) * (maximum[2] - minimum[2]));
+
+		for (int z = minimum[2]; z < maximum[2]; ++z)
+		{
+			for (int y = minimum[1]; y < maximum[1]; ++y)
+			{
+				const T* row = &voxels[(uint64_t(z) * height + y) * width];
+				croppedVoxels.insert(croppedVoxels.end(), row + minimum[0], row + maximum[0]);
+			}
+		}
+
+		return croppedVoxels;
+	}
+
+	int getProjectionKey(ProjectionAxis axis, ProjectionType type, uint32_t channel)
+	{
+		return (int(axis) * 4 + int(type)) * 3 + int(channel);
+	}
+
+	QOffscreenSurface* releaseSurface = nullptr;
+}
+
+VolumeResource::VolumeResource() : volumeTexture(QOpenGLTexture::Target3D), brickMinimumTexture(QOpenGLTexture::Target3D), brickScaleTexture(QOpenGLTexture::Target3D), macrocellMinimumTexture(QOpenGLTexture::Target3D), macrocellMaximumTexture(QOpenGLTexture::Target3D)
+{
+}
+
+VolumeResource::~VolumeResource()
+{
+	if (cropThread.joinable())
+		cropThread.join();
+
+	stopAxisProjections();
+	releaseTextures();
+}
+
+void VolumeResource::setReleaseSurface(QOffscreenSurface* surface)
+{
+	releaseSurface = surface;
+}
+
+bool VolumeResource::load(const ImageLoaderInfo& info, TextureFormat format, float imageWidth, float imageHeight, float imageDepth)
+{
+	if (format == TextureFormat::QUANTIZED_BRICKS)
+	{
+		ImageLoaderResult16 result = ImageLoader::loadFromMultipageTiff16(info);
+
+		if (result.depth == 0)
+			return false;
+
+		destroyTextures();
+		uploadQuantizedVolume(result);
+		uploadMacrocellGrid(result);
+
+		width = int(result.width);
+		height = int(result.height);
+		depth = int(result.depth);
+	}
+	else
+	{
+		ImageLoaderResult result = ImageLoader::loadFromMultipageTiff(info);
+
+		if (result.data.size() == 0)
+			return false;
+
+		spacingX = imageWidth / float(result.width);
+		spacingY = imageHeight / float(result.height);
+		spacingZ = imageDepth / float(result.depth);
+
+		destroyTextures();
+
+		if (format == TextureFormat::COMPRESSED_RGTC)
+			uploadCompressedVolume(result, info, spacingX, spacingY, spacingZ);
+		else
+			uploadVolume(result, spacingX, spacingY, spacingZ);
+
+		uploadMacrocellGrid(result);
+
+		width = int(result.width);
+		height = int(result.height);
+		depth = int(result.depth);
+	}
+
+	stopAxisProjections();
+
+	{
+		std::lock_guard<std::mutex> lock(projectionMutex);
+		projectionCache.clear();
+		projectionsStarted = false;
+		projectionsGenerated = false;
+	}
+
+	fileSize = { width, height, depth };
+	voxelMinimum = { 0, 0, 0 };
+	voxelMaximum = fileSize;
+
+	worldOrigin = QVector3D(0.0f, 0.0f, 0.0f);
+	worldExtent = QVector3D(1.0f, imageHeight / imageWidth, imageDepth / imageWidth);
+	imageSize = QVector3D(imageWidth, imageHeight, imageDepth);
+	shareGroup = QOpenGLContext::currentContext()->shareGroup();
+	imageLoaderInfo = info;
+	loaded = true;
+	cropped = false;
+
+	return true;
+}
+
+bool VolumeResource::isLoadedFrom(const ImageLoaderInfo& info, TextureFormat format, float imageWidth, float imageHeight, float imageDepth) const
+{
+	return loaded && imageLoaderInfo == info && textureFormat == format && imageSize == QVector3D(imageWidth, imageHeight, imageDepth);
+}
+
+std::shared_ptr<VolumeResource> VolumeResource::createCropped(const QVector3D& worldMinimum, const QVector3D& worldMaximum) const
+{
+	if (!loaded)
+		return nullptr;
+
+	// from world coordinates to voxels, the z axis is flipped in sampling.frag
+	const int sizes[3] = { width, height, depth };
+	std::array<int, 3> minimum;
+	std::array<int, 3> maximum;
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		float start = (worldMinimum[axis] - worldOrigin[axis]) / worldExtent[axis];
+		float end = (worldMaximum[axis] - worldOrigin[axis]) / worldExtent[axis];
+
+		if (axis == 2)
+		{
+			float flippedStart = 1.0f - end;
+			end = 1.0f - start;
+			start = flippedStart;
+		}
+
+		minimum[axis] = std::min(std::max(int(std::floor(start * sizes[axis])), 0), sizes[axis] - 1);
+		maximum[axis] = std::min(std::max(int(std::ceil(end * sizes[axis])), minimum[axis] + 1), sizes[axis]);
+	}
+
+	std::shared_ptr<VolumeResource> croppedVolume = std::make_shared<VolumeResource>();
+	VolumeResource& result = *croppedVolume;
+
+	result.width = maximum[0] - minimum[0];
+	result.height = maximum[1] - minimum[1];
+	result.depth = maximum[2] - minimum[2];
+	result.spacingX = spacingX;
+	result.spacingY = spacingY;
+	result.spacingZ = spacingZ;
+	result.imageLoaderInfo = imageLoaderInfo;
+	result.textureFormat = textureFormat;
+	result.imageSize = imageSize;
+	result.shareGroup = QOpenGLContext::currentContext()->shareGroup();
+	result.fileSize = fileSize;
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		result.voxelMinimum[axis] = voxelMinimum[axis] + minimum[axis];
+		result.voxelMaximum[axis] = voxelMinimum[axis] + maximum[axis];
+	}
+
+	result.cropped = true;
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		int start = (axis == 2) ? sizes[axis] - maximum[axis] : minimum[axis];
+		result.worldOrigin[axis] = worldOrigin[axis] + worldExtent[axis] * start / float(sizes[axis]);
+		result.worldExtent[axis] = worldExtent[axis] * (maximum[axis] - minimum[axis]) / float(sizes[axis]);
+	}
+
+	// everything the thread reads has been written above, and nothing else touches the new resource before isCropRead
+	result.cropThread = std::thread([&result]()
+	{
+		if (result.textureFormat == TextureFormat::QUANTIZED_BRICKS)
+			result.cropReadSucceeded = result.readVoxels(result.croppedData16);
+		else
+			result.cropReadSucceeded = result.readVoxels(result.croppedData);
+
+		result.cropRead = true;
+	});
+
+	return croppedVolume;
+}
+
+bool VolumeResource::isCropRead() const
+{
+	return cropRead;
+}
+
+// the compression, quantization and mipmaps of the cropped voxels are still done here, but they only cover the cropped part
+bool VolumeResource::finishCrop()
+{
+	cropThread.join();
+
+	if (!cropReadSucceeded)
+		return false;
+
+	if (textureFormat == TextureFormat::QUANTIZED_BRICKS)
+	{
+		uploadQuantizedVolume(croppedData16);
+		uploadMacrocellGrid(croppedData16);
+		croppedData16 = ImageLoaderResult16();
+	}
+	else
+	{
+		if (textureFormat == TextureFormat::COMPRESSED_RGTC)
+			uploadCompressedVolume(croppedData, imageLoaderInfo, spacingX, spacingY, spacingZ);
+		else
+			uploadVolume(croppedData, spacingX, spacingY, spacingZ);
+
+		uploadMacrocellGrid(croppedData);
+		croppedData = ImageLoaderResult();
+	}
+
+	loaded = true;
+
+	return true;
+}
+
+bool VolumeResource::isCropped() const
+{
+	return cropped;
+}
+
+const MacrocellGrid& VolumeResource::getMacrocellGrid() const
+{
+	return macrocellGrid;
+}
+
+bool VolumeResource::getAxisProjection(ProjectionAxis axis, ProjectionType type, uint32_t channel, ProjectionImage& result)
+{
+	std::lock_guard<std::mutex> lock(projectionMutex);
+
+	if (!projectionsStarted)
+		startAxisProjections();
+
+	if (!projectionsGenerated)
+		return false;
+
+	ProjectionImage& projection = projectionCache[getProjectionKey(axis, type, channel)];
+
+	// disabled channels and volumes that could not be read again are black
+	if (projection.data.empty())
+	{
+		ProjectionGenerator::getProjectionSize(width, height, depth, axis, projection.width, projection.height);
+		projection.data.resize(uint64_t(projection.width) * projection.height);
+	}
+
+	result = projection;
+
+	return true;
+}
+
+void VolumeResource::waitForAxisProjections()
+{
+	std::unique_lock<std::mutex> lock(projectionMutex);
+
+	if (!projectionsStarted)
+		startAxisProjections();
+
+	projectionCondition.wait(lock, [this]() { return projectionsGenerated; });
+}
+
+int VolumeResource::getWidth() const
+{
+	return width;
+}
+
+int VolumeResource::getHeight() const
+{
+	return height;
+}
+
+int VolumeResource::getDepth() const
+{
+	return depth;
+}
+
+QVector3D VolumeResource::getWorldOrigin() const
+{
+	return worldOrigin;
+}
+
+QVector3D VolumeResource::getWorldExtent() const
+{
+	return worldExtent;
+}
+
+// disabled channels are only left out of the compressed textures, the other formats always sample all three at once
+ShaderDefines VolumeResource::getShaderDefines() const
+{
+	ShaderDefines defines = { { "TEXTURE_FORMAT", int(textureFormat) } };
+
+	if (textureFormat == TextureFormat::COMPRESSED_RGTC)
+	{
+		defines.emplace_back("RED_CHANNEL", compressedTextures[0] != nullptr && imageLoaderInfo.redChannelEnabled ? 1 : 0);
+		defines.emplace_back("GREEN_CHANNEL", compressedTextures[1] != nullptr && imageLoaderInfo.greenChannelEnabled ? 1 : 0);
+		defines.emplace_back("BLUE_CHANNEL", compressedTextures[2] != nullptr && imageLoaderInfo.blueChannelEnabled ? 1 : 0);
+	}
+
+	return defines;
+}
+
+void VolumeResource::bind(QOpenGLShaderProgram& program)
+{
+	float layerCount = 1.0f;
+
+	if (textureFormat == TextureFormat::COMPRESSED_RGTC)
+	{
+		for (const std::unique_ptr<QOpenGLTexture>& texture : compressedTextures)
+		{
+			if (texture != nullptr)
+			{
+				layerCount = float(texture->layers());
+				break;
+			}
+		}
+	}
+
+	if (volumeTexture.isCreated())
+		volumeTexture.bind(0);
+
+	for (size_t i = 0; i < compressedTextures.size(); ++i)
+	{
+		if (compressedTextures[i] != nullptr)
+			compressedTextures[i]->bind(uint(i) + 1);
+	}
+
+	if (brickMinimumTexture.isCreated())
+	{
+		brickMinimumTexture.bind(4);
+		brickScaleTexture.bind(5);
+	}
+
+	macrocellMaximumTexture.bind(6);
+	macrocellMinimumTexture.bind(7);
+
+	program.setUniformValue("tex0", 0);
+	program.setUniformValue("tex1", 1);
+	program.setUniformValue("tex2", 2);
+	program.setUniformValue("tex3", 3);
+	program.setUniformValue("tex4", 4);
+	program.setUniformValue("tex5", 5);
+	program.setUniformValue("tex6", 6);
+	program.setUniformValue("tex7", 7);
+	program.setUniformValue("brickSize", brickSize);
+	program.setUniformValue("layerCount", layerCount);
+	program.setUniformValue("macrocellSize", int(macrocellGrid.cellSize));
+	program.setUniformValue("volumeSize", QVector3D(width, height, depth));
+	program.setUniformValue("volumeOrigin", worldOrigin);
+	program.setUniformValue("volumeExtent", worldExtent);
+	program.setUniformValue("channelMask", QVector3D(imageLoaderInfo.redChannelEnabled ? 1.0f : 0.0f, imageLoaderInfo.greenChannelEnabled ? 1.0f : 0.0f, imageLoaderInfo.blueChannelEnabled ? 1.0f : 0.0f));
+}
+
+void VolumeResource::release()
+{
+	macrocellMinimumTexture.release(7);
+	macrocellMaximumTexture.release(6);
+
+	if (brickMinimumTexture.isCreated())
+	{
+		brickScaleTexture.release(5);
+		brickMinimumTexture.release(4);
+	}
+
+	for (size_t i = 0; i < compressedTextures.size(); ++i)
+	{
+		if (compressedTextures[i] != nullptr)
+			compressedTextures[i]->release(uint(i) + 1);
+	}
+
+	if (volumeTexture.isCreated())
+		volumeTexture.release(0);
+}
+
+void VolumeResource::destroyTextures()
+{
+	volumeTexture.destroy();
+	brickMinimumTexture.destroy();
+	brickScaleTexture.destroy();
+	macrocellMinimumTexture.destroy();
+	macrocellMaximumTexture.destroy();
+
+	for (std::unique_ptr<QOpenGLTexture>& texture : compressedTextures)
+		texture.reset();
+}
+
+// the context that is current may be of another share group or there may be none, for example when a GUI thread copy of the pointer is the last one
+void VolumeResource::releaseTextures()
+{
+	QOpenGLContext* currentContext = QOpenGLContext::currentContext();
+
+	if (shareGroup == nullptr || (currentContext != nullptr && currentContext->shareGroup() == shareGroup))
+	{
+		destroyTextures();
+		return;
+	}
+
+	// the global share context is never current anywhere, so it is the safest one to share with
+	QOpenGLContext* globalShareContext = QOpenGLContext::globalShareContext();
+	QOpenGLContext releaseContext;
+
+	if (releaseSurface != nullptr && !shareGroup->shares().isEmpty())
+	{
+		releaseContext.setFormat(releaseSurface->format());
+		releaseContext.setShareContext((globalShareContext != nullptr && globalShareContext->shareGroup() == shareGroup) ? globalShareContext : shareGroup->shares().first());
+	}
+
+	if (releaseSurface == nullptr || releaseContext.shareContext() == nullptr || !releaseContext.create() || !releaseContext.makeCurrent(releaseSurface))
+	{
+		MainWindow::getLog().logWarning("Could not make a context current to free the volume textures");
+		return;
+	}
+
+	destroyTextures();
+	releaseContext.doneCurrent();
+
+	if (currentContext != nullptr)
+		currentContext->makeCurrent(currentContext->surface());
+}
+
+void VolumeResource::uploadVolume(const ImageLoaderResult& result, float spacingX, float spacingY, float spacingZ)
+{
+	textureFormat = TextureFormat::UNCOMPRESSED;
+
+	std::vector<ImageLoaderResult> mipLevels = MipmapGenerator::generateMipmaps(result, spacingX, spacingY, spacingZ);
+	MainWindow::getLog().logInfo("Generated %d mip levels for %dx%dx%d volume", mipLevels.size(), result.width, result.height, result.depth);
+
+	volumeTexture.create();
+	volumeTexture.bind();
+	volumeTexture.setFormat(QOpenGLTexture::RGBA8_UNorm);
+	volumeTexture.setMinMagFilters(QOpenGLTexture::LinearMipMapLinear, QOpenGLTexture::Linear);
+	volumeTexture.setWrapMode(QOpenGLTexture::ClampToBorder);
+	volumeTexture.setBorderColor(0.0f, 0.0f, 0.0f, 1.0f);
+	volumeTexture.setSize(result.width, result.height, result.depth);
+	volumeTexture.setMipLevels(int(mipLevels.size()) + 1);
+	volumeTexture.allocateStorage();
+	volumeTexture.setData(0, QOpenGLTexture::RGBA, QOpenGLTexture::UInt8, &result.data[0]);
+
+	for (size_t i = 0; i < mipLevels.size(); ++i)
+		volumeTexture.setData(int(i) + 1, QOpenGLTexture::RGBA, QOpenGLTexture::UInt8, &mipLevels[i].data[0]);
+
+	volumeTexture.release();
+}
+
+// the voxels are replaced by their decoded values, so the macrocell grid built from them afterwards matches what the shaders sample
+// the disabled channels get no texture at all
+void VolumeResource::uploadCompressedVolume(ImageLoaderResult& result, const ImageLoaderInfo& info, float spacingX, float spacingY, float spacingZ)
+{
+	textureFormat = TextureFormat::COMPRESSED_RGTC;
+
+	std::array<bool, 3> channelsEnabled = { info.redChannelEnabled, info.greenChannelEnabled, info.blueChannelEnabled };
+	std::vector<CompressedChannel> channels = TextureCompressor::compressVolume(result, channelsEnabled, spacingX, spacingY, spacingZ);
+	uint64_t compressedSize = 0;
+
+	for (size_t c = 0; c < channels.size(); ++c)
+	{
+		const CompressedChannel& channel = channels[c];
+
+		if (channel.levels.empty())
+			continue;
+
+		compressedTextures[c].reset(new QOpenGLTexture(QOpenGLTexture::Target2DArray));
+		QOpenGLTexture& texture = *compressedTextures[c];
+
+		texture.create();
+		texture.bind();
+		texture.setFormat(QOpenGLTexture::R_ATI1N_UNorm);
+		texture.setMinMagFilters(QOpenGLTexture::LinearMipMapLinear, QOpenGLTexture::Linear);
+		texture.setWrapMode(QOpenGLTexture::ClampToBorder);
+		texture.setBorderColor(0.0f, 0.0f, 0.0f, 1.0f);
+		texture.setSize(channel.width, channel.height);
+		texture.setLayers(channel.depth);
+		texture.setMipLevels(int(channel.levels.size()));
+		texture.allocateStorage();
+
+		for (size_t level = 0; level < channel.levels.size(); ++level)
+		{
+			uint64_t layerSize = channel.levels[level].size() / channel.depth;
+
+			for (uint32_t layer = 0; layer < channel.depth; ++layer)
+				texture.setCompressedData(int(level), int(layer), int(layerSize), &channel.levels[level][layer * layerSize]);
+
+			compressedSize += channel.levels[level].size();
+		}
+
+		texture.release();
+	}
+
+	uint64_t uncompressedSize = uint64_t(result.width) * result.height * result.depth * 4;
+	MainWindow::getLog().logInfo("Uploaded RGTC1 volume: %.1f MB (uncompressed base level %.1f MB)", compressedSize / 1048576.0, uncompressedSize / 1048576.0);
+
+	TextureCompressor::decodeVolume(channels, result);
+}
+
+void VolumeResource::uploadQuantizedVolume(const ImageLoaderResult16& result)
+{
+	textureFormat = TextureFormat::QUANTIZED_BRICKS;
+
+	QuantizedVolume quantized = BrickQuantizer::quantizeVolume(result, brickSize);
+
+	// bricks are dequantized per voxel by fetchQuantized in sampling.frag, so the hardware must not filter across brick boundaries
+	volumeTexture.create();
+	volumeTexture.bind();
+	volumeTexture.setFormat(QOpenGLTexture::RGBA8_UNorm);
+	volumeTexture.setMinMagFilters(QOpenGLTexture::Nearest, QOpenGLTexture::Nearest);
+	volumeTexture.setWrapMode(QOpenGLTexture::ClampToEdge);
+	volumeTexture.setSize(quantized.volume.width, quantized.volume.height, quantized.volume.depth);
+	volumeTexture.setMipLevels(1);
+	volumeTexture.allocateStorage();
+	volumeTexture.setData(QOpenGLTexture::RGBA, QOpenGLTexture::UInt8, &quantized.volume.data[0]);
+	volumeTexture.release();
+
+	QOpenGLTexture* brickTextures[] = { &brickMinimumTexture, &brickScaleTexture };
+	const std::vector<float>* brickData[] = { &quantized.brickMinimums, &quantized.brickScales };
+
+	for (uint32_t i = 0; i < 2; ++i)
+	{
+		brickTextures[i]->create();
+		brickTextures[i]->bind();
+		brickTextures[i]->setFormat(QOpenGLTexture::RGB32F);
+		brickTextures[i]->setMinMagFilters(QOpenGLTexture::Nearest, QOpenGLTexture::Nearest);
+		brickTextures[i]->setWrapMode(QOpenGLTexture::ClampToEdge);
+		brickTextures[i]->setSize(quantized.bricksX, quantized.bricksY, quantized.bricksZ);
+		brickTextures[i]->setMipLevels(1);
+		brickTextures[i]->allocateStorage();
+		brickTextures[i]->setData(QOpenGLTexture::RGB, QOpenGLTexture::Float32, &(*brickData[i])[0]);
+		brickTextures[i]->release();
+	}
+
+	uint64_t quantizedSize = quantized.volume.data.size() * 4 + quantized.brickMinimums.size() * 8;
+	MainWindow::getLog().logInfo("Uploaded quantized volume: %.1f MB (RGBA16 %.1f MB)", quantizedSize / 1048576.0, quantized.volume.data.size() * 8 / 1048576.0);
+}
+
+template <typename T>
+void VolumeResource::uploadMacrocellGrid(const T& result)
+{
+	QElapsedTimer timer;
+	timer.start();
+
+	macrocellGrid = MacrocellGenerator::generateGrid(result, macrocellSize);
+
+	float emptyFraction = MacrocellGenerator::getEmptyFraction(macrocellGrid, { 0.0f, 0.0f, 0.0f });
+	MainWindow::getLog().logInfo("Generated %dx%dx%d macrocell grid in %d ms (%.1f %% of the cells are empty)", macrocellGrid.cellsX, macrocellGrid.cellsY, macrocellGrid.cellsZ, timer.elapsed(), emptyFraction * 100.0f);
+
+	QOpenGLTexture* macrocellTextures[] = { &macrocellMinimumTexture, &macrocellMaximumTexture };
+	const std::vector<float>* macrocellData[] = { &macrocellGrid.minimums, &macrocellGrid.maximums };
+
+	for (uint32_t i = 0; i < 2; ++i)
+	{
+		macrocellTextures[i]->create();
+		macrocellTextures[i]->bind();
+		macrocellTextures[i]->setFormat(QOpenGLTexture::RGB32F);
+		macrocellTextures[i]->setMinMagFilters(QOpenGLTexture::Nearest, QOpenGLTexture::Nearest);
+		macrocellTextures[i]->setWrapMode(QOpenGLTexture::ClampToEdge);
+		macrocellTextures[i]->setSize(macrocellGrid.cellsX, macrocellGrid.cellsY, macrocellGrid.cellsZ);
+		macrocellTextures[i]->setMipLevels(1);
+		macrocellTextures[i]->allocateStorage();
+		macrocellTextures[i]->setData(QOpenGLTexture::RGB, QOpenGLTexture::Float32, &(*macrocellData[i])[0]);
+		macrocellTextures[i]->release();
+	}
+}
+
+// the voxels of this resource from the file, cropped like the textures
+bool VolumeResource::readVoxels(ImageLoaderResult& result) const
+{
+	ImageLoaderResult fileData = ImageLoader::loadFromMultipageTiff(imageLoaderInfo);
+
+	if (!readVoxelsMatch(fileData.width, fileData.height, fileData.depth))
+		return false;
+
+	if (!cropped)
+	{
+		result = std::move(fileData);
+		return true;
+	}
+
+	result.width = uint32_t(voxelMaximum[0] - voxelMinimum[0]);
+	result.height = uint32_t(voxelMaximum[1] - voxelMinimum[1]);
+	result.depth = uint32_t(voxelMaximum[2] - voxelMinimum[2]);
+	result.data = cropVoxels(fileData.data, fileData.width, fileData.height, voxelMinimum, voxelMaximum);
+
+	return true;
+}
+
+bool VolumeResource::readVoxels(ImageLoaderResult16& result) const
+{
+	ImageLoaderResult16 fileData = ImageLoader::loadFromMultipageTiff16(imageLoaderInfo);
+
+	if (!readVoxelsMatch(fileData.width, fileData.height, fileData.depth))
+		return false;
+
+	if (!cropped)
+	{
+		result = std::move(fileData);
+		return true;
+	}
+
+	result.width = uint32_t(voxelMaximum[0] - voxelMinimum[0]);
+	result.height = uint32_t(voxelMaximum[1] - voxelMinimum[1]);
+	result.depth = uint32_t(voxelMaximum[2] - voxelMinimum[2]);
+
+	for (size_t c = 0; c < result.channelData.size(); ++c)
+		result.channelData[c] = cropVoxels(fileData.channelData[c], fileData.width, fileData.height, voxelMinimum, voxelMaximum);
+
+	return true;
+}
+
+bool VolumeResource::readVoxelsMatch(uint32_t fileWidth, uint32_t fileHeight, uint32_t fileDepth) const
+{
+	if (fileDepth == 0)
+		return false;
+
+	if (int(fileWidth) != fileSize[0] || int(fileHeight) != fileSize[1] || int(fileDepth) != fileSize[2])
+	{
+		MainWindow::getLog().logWarning("The image file has changed since it was loaded, load it again");
+		return false;
+	}
+
+	return true;
+}
+
+// called with the projection lock held, everything the thread reads besides the cache is only written before the volume is loaded
+void VolumeResource::startAxisProjections()
+{
+	projectionsStarted = true;
+	projectionThread = std::thread([this]() { generateAxisProjections(); });
+
+	MainWindow::getLog().logInfo("Generating the axis projections in the background");
+}
+
+// the file read itself can not be interrupted, the projections after it are skipped
+void VolumeResource::stopAxisProjections()
+{
+	if (!projectionThread.joinable())
+		return;
+
+	projectionThreadExiting = true;
+	projectionThread.join();
+	projectionThreadExiting = false;
+}
+
+// the file is read only once for all the projections, so switching between them stays fast
+void VolumeResource::generateAxisProjections()
+{
+	QElapsedTimer timer;
+	timer.start();
+
+	std::map<int, ProjectionImage> projections;
+	bool generated = false;
+
+	if (textureFormat == TextureFormat::QUANTIZED_BRICKS)
+	{
+		ImageLoaderResult16 voxels;
+
+		if (readVoxels(voxels))
+		{
+			generateAxisProjections(voxels, projections);
+			generated = true;
+		}
+	}
+	else
+	{
+		ImageLoaderResult voxels;
+
+		if (readVoxels(voxels))
+		{
+			generateAxisProjections(voxels, projections);
+			generated = true;
+		}
+	}
+
+	if (projectionThreadExiting)
+		return;
+
+	if (generated)
+		MainWindow::getLog().logInfo("Generated the axis projections in %d ms", timer.elapsed());
+
+	std::lock_guard<std::mutex> lock(projectionMutex);
+	projectionCache = std::move(projections);
+	projectionsGenerated = true;
+	projectionCondition.notify_all();
+}
+
+template <typename T>
+void VolumeResource::generateAxisProjections(const T& voxels, std::map<int, ProjectionImage>& projections)
+{
+	const bool channelEnabled[3] = { imageLoaderInfo.redChannelEnabled, imageLoaderInfo.greenChannelEnabled, imageLoaderInfo.blueChannelEnabled };
+	const ProjectionAxis axes[3] = { ProjectionAxis::X, ProjectionAxis::Y, ProjectionAxis::Z };
+	const uint32_t rayLengths[3] = { voxels.width, voxels.height, voxels.depth };
+
+	for (uint32_t c = 0; c < 3; ++c)
+	{
+		if (!channelEnabled[c])
+			continue;
+
+		for (int i = 0; i < 3; ++i)
+		{
+			if (projectionThreadExiting)
+				return;
+
+			for (ProjectionType type : { ProjectionType::MAXIMUM, ProjectionType::MINIMUM, ProjectionType::SUM })
+				projections[getProjectionKey(axes[i], type, c)] = ProjectionGenerator::generateProjection(voxels, axes[i], type, c);
+
+			// means are the sums divided by the ray length, so they don't need another pass over the voxels
+			ProjectionImage mean = projections[getProjectionKey(axes[i], ProjectionType::SUM, c)];
+
+			for (float& value : mean.data)
+				value /= float(rayLengths[i]);
+
+			projections[getProjectionKey(axes[i], ProjectionType::MEAN, c)] = std::move(mean);
+		}
+	}
+}
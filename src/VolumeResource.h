@@ -0,0 +1,146 @@
+// Copyright © 2016 Mikko Ronkainen <firstname@mikkoronkainen.com>
+// License: MIT, see the LICENSE file.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLTexture>
+#include <QPointer>
+#include <QVector3D>
+
+#include "ImageLoader.h"
+#include "MacrocellGenerator.h"
+#include "ProjectionGenerator.h"
+#include "ShaderVariantCache.h"
+
+namespace CellVision
+{
+	// STREAMED_SLICES is never loaded into a VolumeResource, the render widget then only streams the z slices around the current one
+	enum class TextureFormat { UNCOMPRESSED, COMPRESSED_RGTC, QUANTIZED_BRICKS, STREAMED_SLICES };
+
+	// volume textures that several render widgets can sample at the same time
+	// requires Qt::AA_ShareOpenGLContexts and a current context whenever the textures are created
+	// the last reference can be dropped on any thread, the textures are then freed with a temporary context on the release surface if needed
+	class VolumeResource
+	{
+	public:
+
+		VolumeResource();
+		~VolumeResource();
+
+		// the surface has to be created on the GUI thread and outlive every volume
+		static void setReleaseSurface(QOffscreenSurface* surface);
+
+		bool load(const ImageLoaderInfo& info, TextureFormat format, float imageWidth, float imageHeight, float imageDepth);
+		// the world extent depends on the physical size, so a volume loaded with a different size has to be loaded again
+		bool isLoadedFrom(const ImageLoaderInfo& info, TextureFormat format, float imageWidth, float imageHeight, float imageDepth) const;
+
+		// a new resource with only the voxels inside the given world space box, snapped outwards to whole voxels
+		// the world coordinates stay the same, the textures just cover less of them
+		// the voxels are read from the file on a worker thread, and the textures are uploaded by finishCrop once isCropRead returns true
+		std::shared_ptr<VolumeResource> createCropped(const QVector3D& worldMinimum, const QVector3D& worldMaximum) const;
+		bool isCropRead() const;
+		// needs a current context, returns false if the file could not be read again
+		bool finishCrop();
+		bool isCropped() const;
+
+		const MacrocellGrid& getMacrocellGrid() const;
+
+		// exact projections along the volume axes, all of them are generated on a worker thread on first use from the voxels read again from the file
+		// returns false until they are ready, the widgets sharing the volume render on their own threads so the result is a copy
+		bool getAxisProjection(ProjectionAxis axis, ProjectionType type, uint32_t channel, ProjectionImage& result);
+		// for offscreen rendering, which can not show the projections a few frames later
+		void waitForAxisProjections();
+
+		int getWidth() const;
+		int getHeight() const;
+		int getDepth() const;
+
+		// the part of the world that the textures cover, the whole box (1, height / width, depth / width) unless cropped
+		QVector3D getWorldOrigin() const;
+		QVector3D getWorldExtent() const;
+
+		// the definitions that select the sampling path of this volume in sampling.frag
+		ShaderDefines getShaderDefines() const;
+
+		void bind(QOpenGLShaderProgram& program);
+		void release();
+
+	private:
+
+		void destroyTextures();
+		void releaseTextures();
+		void uploadVolume(const ImageLoaderResult& result, float spacingX, float spacingY, float spacingZ);
+		void uploadCompressedVolume(ImageLoaderResult& result, const ImageLoaderInfo& info, float spacingX, float spacingY, float spacingZ);
+		void uploadQuantizedVolume(const ImageLoaderResult16& result);
+
+		template <typename T>
+		void uploadMacrocellGrid(const T& result);
+
+		bool readVoxels(ImageLoaderResult& result) const;
+		bool readVoxels(ImageLoaderResult16& result) const;
+		bool readVoxelsMatch(uint32_t fileWidth, uint32_t fileHeight, uint32_t fileDepth) const;
+		void startAxisProjections();
+		void stopAxisProjections();
+		void generateAxisProjections();
+
+		template <typename T>
+		void generateAxisProjections(const T& voxels, std::map<int, ProjectionImage>& projections);
+
+		ImageLoaderInfo imageLoaderInfo;
+		TextureFormat textureFormat = TextureFormat::UNCOMPRESSED;
+		bool loaded = false;
+		bool cropped = false;
+		int brickSize = 16;
+		uint32_t macrocellSize = 16;
+		int width = 0;
+		int height = 0;
+		int depth = 0;
+		float spacingX = 1.0f;
+		float spacingY = 1.0f;
+		float spacingZ = 1.0f;
+		QVector3D imageSize;
+		QPointer<QOpenGLContextGroup> shareGroup;
+		QVector3D worldOrigin;
+		QVector3D worldExtent = QVector3D(1.0f, 1.0f, 1.0f);
+
+		// the voxels of the file that the textures hold, the whole file unless cropped
+		std::array<int, 3> fileSize;
+		std::array<int, 3> voxelMinimum;
+		std::array<int, 3> voxelMaximum;
+
+		QOpenGLTexture volumeTexture;
+		std::array<std::unique_ptr<QOpenGLTexture>, 3> compressedTextures;
+		QOpenGLTexture brickMinimumTexture;
+		QOpenGLTexture brickScaleTexture;
+		QOpenGLTexture macrocellMinimumTexture;
+		QOpenGLTexture macrocellMaximumTexture;
+		MacrocellGrid macrocellGrid;
+
+		// the cropped voxels until finishCrop uploads them, only one of the results is used depending on the format
+		std::thread cropThread;
+		std::atomic<bool> cropRead{ false };
+		bool cropReadSucceeded = false;
+		ImageLoaderResult croppedData;
+		ImageLoaderResult16 croppedData16;
+
+		// the voxels are not kept after the upload, so the CPU side paths read them from the file again on the projection thread
+		std::thread projectionThread;
+		std::atomic<bool> projectionThreadExiting{ false };
+		std::mutex projectionMutex;
+		std::condition_variable projectionCondition;
+		std::map<int, ProjectionImage> projectionCache;
+		bool projectionsStarted = false;
+		bool projectionsGenerated = false;
+	};
+}